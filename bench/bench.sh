@@ -0,0 +1,121 @@
+#!/bin/sh
+# Banco de pruebas de rendimiento del simulador.
+#
+# Ejecuta cada carga de trabajo varias veces en modo por lotes (sistema -c ...),
+# toma el resumen JSON que imprime el sistema al terminar y escribe por carga la
+# media y la varianza de instrucciones/s y cambios de contexto/s, y los ciclos por
+# proceso. Se ejecuta desde la raiz del repositorio (make bench).
+#
+# Uso: sh bench/bench.sh [-n repeticiones] [-o salida.json] [-b binario] [-p procesos] [-c comando]...
+#   -c agrega un comando de consola antes de cada carga (ej. -c "rafaga 100")
+#   -p procesos de la carga "procesos" (def. 20: entran en la memoria por defecto sin
+#      intercambio, asi la carga mide despachos y cambios de contexto y no el disco)
+
+REPETICIONES=5
+SALIDA=bench/resultados.json
+BINARIO=./sistema
+PREVIOS=""
+PROCESOS=20
+
+while getopts "n:o:b:p:c:" opcion; do
+    case $opcion in
+        n) REPETICIONES=$OPTARG ;;
+        o) SALIDA=$OPTARG ;;
+        b) BINARIO=$OPTARG ;;
+        p) PROCESOS=$OPTARG ;;
+        c) PREVIOS="$PREVIOS$OPTARG;" ;;
+        *) echo "Uso: $0 [-n repeticiones] [-o salida.json] [-b binario] [-p procesos] [-c comando]..." >&2; exit 2 ;;
+    esac
+done
+
+if [ ! -x "$BINARIO" ]; then
+    echo "Error: no se encontro el binario $BINARIO (ejecute make)" >&2
+    exit 2
+fi
+
+# Cargas de trabajo: nombre y comando de consola que la ejecuta
+CARGAS="aritmetica llamadas indexado procesos dormir consola"
+
+comando_carga() {
+    case $1 in
+        aritmetica) echo "ejecutar bench/aritmetica.prog" ;;
+        llamadas)   echo "ejecutar bench/llamadas.prog" ;;
+        indexado)   echo "ejecutar bench/indexado.prog" ;;
+        procesos)   # Muchos procesos cortos: la tabla de procesos crece lo que haga falta
+                    echo "ejecutar bench/corto.prog:$PROCESOS" ;;
+        dormir)     echo "ejecutar bench/dormilon.prog bench/dormilon.prog bench/dormilon.prog bench/dormilon.prog bench/aritmetica.prog bench/indexado.prog" ;;
+        consola)    echo "ejecutar bench/consola.prog bench/consola.prog bench/consola.prog" ;;
+    esac
+}
+
+# Ejecuta una carga con los comandos previos y deja en stdout la linea JSON del resumen
+ejecutar_carga() {
+    set --
+    antiguo_ifs=$IFS
+    IFS=';'
+    for c in $PREVIOS; do
+        [ -n "$c" ] && set -- "$@" -c "$c"
+    done
+    IFS=$antiguo_ifs
+    "$BINARIO" "$@" -c "$(comando_carga "$carga")" | grep '^{' | tail -n 1
+}
+
+# Valor numerico de un campo del resumen JSON
+campo() {
+    echo "$1" | sed -n "s/.*\"$2\": *\([-0-9.e+]*\).*/\1/p"
+}
+
+temporal=$(mktemp)
+trap 'rm -f "$temporal"' EXIT
+
+{
+    printf '{\n'
+    printf '  "binario": "%s",\n' "$BINARIO"
+    printf '  "repeticiones": %d,\n' "$REPETICIONES"
+    printf '  "comandos_previos": "%s",\n' "$PREVIOS"
+    printf '  "cargas": ['
+} > "$temporal"
+
+separador=""
+for carga in $CARGAS; do
+    printf 'Carga %-12s' "$carga" >&2
+    muestras=""
+    r=0
+    while [ $r -lt "$REPETICIONES" ]; do
+        resumen=$(ejecutar_carga)
+        if [ -z "$resumen" ]; then
+            echo " error: el sistema no produjo resumen" >&2
+            exit 1
+        fi
+        muestras="$muestras$(campo "$resumen" ciclos) $(campo "$resumen" instrucciones) $(campo "$resumen" cambios_contexto) $(campo "$resumen" procesos) $(campo "$resumen" segundos)
+"
+        printf '.' >&2
+        r=$((r + 1))
+    done
+
+    # Media y varianza muestral de las tasas por repeticion
+    printf '%s' "$muestras" | awk -v nombre="$carga" -v sep="$separador" '
+        NF == 5 {
+            n++
+            ciclos += $1; instrucciones += $2; cambios += $3; procesos += $4; segundos += $5
+            ips[n] = ($5 > 0) ? $2 / $5 : 0
+            cps[n] = ($5 > 0) ? $3 / $5 : 0
+        }
+        function media(v,    i, s) { s = 0; for (i = 1; i <= n; i++) s += v[i]; return s / n }
+        function varianza(v, m,    i, s) { if (n < 2) return 0; s = 0; for (i = 1; i <= n; i++) s += (v[i] - m) ^ 2; return s / (n - 1) }
+        END {
+            mi = media(ips); mc = media(cps)
+            printf "%s\n    {\"nombre\": \"%s\", \"procesos\": %d, \"ciclos\": %d, \"instrucciones\": %d, \"cambios_contexto\": %d,\n", sep, nombre, procesos / n, ciclos / n, instrucciones / n, cambios / n
+            printf "     \"segundos_media\": %.6f, \"ciclos_por_proceso\": %.1f,\n", segundos / n, (procesos > 0) ? ciclos / procesos : 0
+            printf "     \"instrucciones_por_s\": %.1f, \"instrucciones_por_s_varianza\": %.1f,\n", mi, varianza(ips, mi)
+            printf "     \"cambios_contexto_por_s\": %.1f, \"cambios_contexto_por_s_varianza\": %.1f}", mc, varianza(cps, mc)
+        }' >> "$temporal"
+
+    # Resumen legible en stderr
+    printf '%s' "$muestras" | awk '{ s += $5; i += $2 } END { printf " %.0f instr/s\n", (s > 0) ? i / s : 0 }' >&2
+    separador=","
+done
+
+printf '\n  ]\n}\n' >> "$temporal"
+cp "$temporal" "$SALIDA"
+echo "Resultados en $SALIDA" >&2
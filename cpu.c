@@ -3,8 +3,19 @@
 #include "logger.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
 
-extern int g_modo_debug;
+
+// Las funciones que reciben el modo de la CPU como parametro se expanden siempre en linea.
+// Llamadas con MODO_USUARIO o MODO_KERNEL constante, el compilador elimina la comparacion
+// de modo y cada motor especializado queda solo con la variante de acceso que le toca.
+#if defined(__GNUC__)
+#define CPU_EN_LINEA static inline __attribute__((always_inline))
+#else
+#define CPU_EN_LINEA static inline
+#endif
 
 
 // Convierte de Signo-Magnitud a un entero estándar de C
@@ -37,31 +48,111 @@ palabra_t nativo_a_sm(int valor) {
 }
 
 //Inicializa la CPU a 0 
-void cpu_inicializar(CPU_t *cpu) {
+void cpu_inicializar(CPU_t *cpu, const Memoria_t *mem) {
     cpu->AC = 0;
     cpu->MAR = 0;
     cpu->MDR = 0;
     cpu->IR = 0;
-    cpu->RB = MEM_SO;  //Lo primero que se ejecuta al iniciar el sistema es el SO, el registro base se igual a el, ya que contiene la pos de mem del proceso en ejecucion
+    cpu->RB = mem->mem_so;  //Lo primero que se ejecuta al iniciar el sistema es el SO, el registro base se igual a el, ya que contiene la pos de mem del proceso en ejecucion
     cpu->RX = 0;
     cpu->SP = 0;
     cpu->PSW.codigo_condicion = 0;     //El codigo de condicion del PSW se inicializa a 0
     cpu->PSW.modo = MODO_KERNEL;       //La CPU siempre debe incializarse en modo kernel
     cpu->PSW.interrupciones = INT_HABILITADAS;  //La CPU reacciona a señales externas
-    cpu->PSW.pc = MEM_SO;              //Comienza a leer donde se carga el SO
+    cpu->PSW.pc = mem->mem_so;         //Comienza a leer donde se carga el SO
+    cpu->paginas = NULL;               //Sin tabla de paginas: direcciones fisicas con RB y RL
+    atomic_init(&cpu->interrupciones_pendientes, 0);
+    cpu->modo_debug = 0;
+    cpu->dir_fallo = 0;
+    cpu_tlb_vaciar(cpu);
+    cpu->tlb.aciertos = 0;
+    cpu->tlb.fallos = 0;
     
-    log_mensaje("CPU inicializada");
+    LOG_INFO(LOG_CAT_CPU, "CPU inicializada");
+}
+
+//Carga en la CPU los registros de un contexto guardado. Las interrupciones pendientes y el
+//modo debug son de la CPU, no del proceso: estan al final de CPU_t y no se copian (asi
+//tampoco se pisa una interrupcion que un dispositivo publique mientras tanto)
+void cpu_cargar_contexto(CPU_t *cpu, const CPU_t *contexto) {
+    memcpy(cpu, contexto, offsetof(CPU_t, interrupciones_pendientes));
+    cpu_tlb_vaciar(cpu); // Las entradas no llevan el proceso: eran del anterior
+}
+
+//------------------------------------------------------TRADUCCION DE DIRECCIONES----------------------------------------------------------------------------------
+
+void cpu_tlb_vaciar(CPU_t *cpu) {
+    for (int i = 0; i < TAM_TLB; i++) {
+        cpu->tlb.entradas[i].pagina = -1;
+    }
+}
+
+void cpu_tlb_invalidar(CPU_t *cpu, int pagina) {
+    EntradaTLB_t *entrada = &cpu->tlb.entradas[pagina % TAM_TLB];
+    if (entrada->pagina == pagina) entrada->pagina = -1;
+}
+
+// Traduce una direccion de modo usuario ya verificada contra RB y RL. Sin tabla de paginas
+// la direccion ya es fisica. Con paginacion se busca primero en la TLB y despues en la
+// tabla; si la pagina no esta cargada se lanza INT_FALLO_PAGINA y se retorna -1.
+CPU_EN_LINEA int cpu_traducir(CPU_t *cpu, int direccion) {
+    TablaPaginas_t *tabla = cpu->paginas;
+    if (tabla == NULL) return direccion;
+
+    int pagina = direccion / TAM_PAGINA;
+    EntradaTLB_t *entrada = &cpu->tlb.entradas[pagina % TAM_TLB];
+    if (entrada->pagina == pagina) {
+        cpu->tlb.aciertos++;
+    } else {
+        cpu->tlb.fallos++;
+        if (pagina >= tabla->cant_paginas) {
+            // RL se movio mas alla de la tabla (STRRL)
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
+            return -1;
+        }
+        if (tabla->marcos[pagina] < 0) {
+            cpu->dir_fallo = direccion;
+            lanzar_interrupcion(cpu, INT_FALLO_PAGINA);
+            return -1;
+        }
+        entrada->pagina = pagina;
+        entrada->marco = tabla->marcos[pagina];
+    }
+    return entrada->marco + direccion % TAM_PAGINA;
+}
+
+// Traduce un operando de la instruccion en curso. Si su pagina falta, el PC vuelve a la
+// instruccion (todas ocupan una palabra) para repetirla cuando el sistema cargue la pagina.
+// Las operaciones traducen antes de modificar registros, asi la repeticion es exacta.
+CPU_EN_LINEA int cpu_traducir_dato(CPU_t *cpu, int direccion) {
+    int fisica = cpu_traducir(cpu, direccion);
+    if (fisica < 0) cpu->PSW.pc--;
+    return fisica;
+}
+
+// Traduce el destino de una escritura (STR, PSH). Las paginas de codigo compartido son de
+// solo lectura: la escritura lanza INT_FALLO_PAGINA, el sistema le da al proceso su propia
+// copia de la pagina y la instruccion se repite.
+CPU_EN_LINEA int cpu_traducir_escritura(CPU_t *cpu, int direccion) {
+    int fisica = cpu_traducir_dato(cpu, direccion);
+    if (fisica >= 0 && cpu->paginas != NULL && cpu->paginas->compartida[direccion / TAM_PAGINA]) {
+        cpu->dir_fallo = direccion;
+        lanzar_interrupcion(cpu, INT_FALLO_PAGINA);
+        cpu->PSW.pc--;
+        return -1;
+    }
+    return fisica;
 }
 
 //------------------------------------------------------CICLOS DE INSTRUCCION DE LA CPU----------------------------------------------------------------------------------
 
 
-void cpu_busqueda(CPU_t *cpu, palabra_t *memoria) {  //Indica lo primero que debe hacer la CPU
+CPU_EN_LINEA void cpu_busqueda_modo(CPU_t *cpu, Memoria_t *mem, int modo) {  //Indica lo primero que debe hacer la CPU
     // Verificar proteccion de memoria (si estamos en modo usuario)
-    if (cpu->PSW.modo == MODO_USUARIO) {
+    if (modo == MODO_USUARIO) {
         // Verificar si la direccion de la instruccion esta protegida
         if (cpu->PSW.pc > cpu->RL || cpu->PSW.pc < cpu->RB) {
-            lanzar_interrupcion(INT_DIR_INVALIDA); // Arrojar excepcion codigo 6
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA); // Arrojar excepcion codigo 6
             return;
         }
 
@@ -70,17 +161,21 @@ void cpu_busqueda(CPU_t *cpu, palabra_t *memoria) {  //Indica lo primero que deb
         if (cpu->PSW.pc >= cpu->RX) {
             // Se considera una violacion de acceso o instruccion invalida.
             // Usamos INT_DIR_INVALIDA porque estamos accediendo a una zona de memoria prohibida para ejecucion.
-            log_error("Intento de ejecucion en la pila", cpu->PSW.pc);
-            lanzar_interrupcion(INT_DIR_INVALIDA);
+            log_error(LOG_CAT_CPU, "Intento de ejecucion en la pila", cpu->PSW.pc);
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
             return;
         }
-    }
 
-    // MAR obtiene PC
-    cpu->MAR = cpu->PSW.pc;
+        // MAR obtiene la direccion fisica del PC (si la pagina falta, el PC no avanza)
+        cpu->MAR = cpu_traducir(cpu, cpu->PSW.pc);
+        if (cpu->MAR < 0) return;
+    } else {
+        // MAR obtiene PC
+        cpu->MAR = cpu->PSW.pc;
+    }
     
     // MDR obtiene contenido de memoria[MAR]
-    cpu->MDR = memoria[cpu->MAR];
+    cpu->MDR = mem->datos[cpu->MAR];
     
     // IR obtiene MDR
     cpu->IR = cpu->MDR;
@@ -90,6 +185,10 @@ void cpu_busqueda(CPU_t *cpu, palabra_t *memoria) {  //Indica lo primero que deb
     
 }
 
+void cpu_busqueda(CPU_t *cpu, Memoria_t *mem) {
+    cpu_busqueda_modo(cpu, mem, cpu->PSW.modo);
+}
+
 Instruccion_t cpu_decodificar_instruccion(palabra_t instruccion_raw) {
     Instruccion_t inst;
     
@@ -112,25 +211,28 @@ int cpu_calcular_direccion(CPU_t *cpu, Instruccion_t inst) {     //Calcula la di
             direccion = -1; // No aplica ya que la direccion es el dato directamente
             break;
         case DIR_INDEXADO:
-            direccion = cpu->AC + inst.valor;   //Suma el contenido del registro AC + el valor de la instruccion.
+            direccion = palabra_a_sm(cpu->AC) + inst.valor;   //Suma el contenido del registro AC + el valor de la instruccion.
             break;
     }
     
     return direccion;
 }
 
-palabra_t cpu_obtener_operando(CPU_t *cpu, Instruccion_t inst, palabra_t *memoria) {
+CPU_EN_LINEA palabra_t cpu_obtener_operando_modo(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int modo) {
+    palabra_t *memoria = mem->datos;
     palabra_t operando = 0;
     
     switch(inst.direccionamiento) {  //Dependiento del tipo de direccionamiento actuara
 
         case DIR_DIRECTO:
-            if (cpu->PSW.modo == MODO_USUARIO) {
+            if (modo == MODO_USUARIO) {
                 int dir_fisica = cpu->RB + inst.valor;
                 if (!cpu_verificar_memoria(cpu, dir_fisica)) {  // Si el programa intenta acceder a una direccion fuera de limite
-                    lanzar_interrupcion(INT_DIR_INVALIDA);
+                    lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
                     return 0;
                 }
+                dir_fisica = cpu_traducir_dato(cpu, dir_fisica);
+                if (dir_fisica < 0) return 0;
                 operando = memoria[dir_fisica];
             } else {
                 operando = memoria[inst.valor];
@@ -140,15 +242,17 @@ palabra_t cpu_obtener_operando(CPU_t *cpu, Instruccion_t inst, palabra_t *memori
             operando = inst.valor;
             break;
         case DIR_INDEXADO:
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                int dir_fisica = cpu->RB + cpu->AC + inst.valor;
+            if (modo == MODO_USUARIO) {
+                int dir_fisica = cpu->RB + palabra_a_sm(cpu->AC) + inst.valor;
                 if (!cpu_verificar_memoria(cpu, dir_fisica)) {
-                    lanzar_interrupcion(INT_DIR_INVALIDA);
+                    lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
                     return 0;
                 }
+                dir_fisica = cpu_traducir_dato(cpu, dir_fisica);
+                if (dir_fisica < 0) return 0;
                 operando = memoria[dir_fisica];
             } else {
-                operando = memoria[cpu->AC + inst.valor];
+                operando = memoria[palabra_a_sm(cpu->AC) + inst.valor];
             }
             break;
     }
@@ -156,15 +260,19 @@ palabra_t cpu_obtener_operando(CPU_t *cpu, Instruccion_t inst, palabra_t *memori
     return operando;
 }
 
-void cpu_saltar(CPU_t *cpu, int direccion_destino_relativa) {
+palabra_t cpu_obtener_operando(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem) {
+    return cpu_obtener_operando_modo(cpu, inst, mem, cpu->PSW.modo);
+}
+
+CPU_EN_LINEA void cpu_saltar_modo(CPU_t *cpu, int direccion_destino_relativa, int modo) {
     int dir_fisica = direccion_destino_relativa;
 
     // Verificar proteccion de memoria para Modo Usuario
-    if (cpu->PSW.modo == MODO_USUARIO) {
+    if (modo == MODO_USUARIO) {
         dir_fisica = cpu->RB + direccion_destino_relativa;
 
         if (!cpu_verificar_memoria(cpu, dir_fisica)) {
-            lanzar_interrupcion(INT_DIR_INVALIDA);
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
             return;
         }
     }
@@ -172,6 +280,10 @@ void cpu_saltar(CPU_t *cpu, int direccion_destino_relativa) {
     cpu->PSW.pc = dir_fisica;
 }
 
+void cpu_saltar(CPU_t *cpu, int direccion_destino_relativa) {
+    cpu_saltar_modo(cpu, direccion_destino_relativa, cpu->PSW.modo);
+}
+
 int cpu_verificar_memoria(CPU_t *cpu, int direccion) {   //Recibe el estado de la CPU y la direccion fisica que ya calculamos
     return (direccion >= cpu->RB && direccion <= cpu->RL);  //verifica que la direccion este entre RB y RL
 }
@@ -180,7 +292,7 @@ void cpu_actualizar_cc(CPU_t *cpu, int res_nativo) {
     // Detectar overflow (mas de 7 digitos de magnitud)
     if (abs(res_nativo) > 9999999) {
         cpu->PSW.codigo_condicion = CC_OVERFLOW;   //Detecta un desbordamiento 
-        lanzar_interrupcion(INT_OVERFLOW);
+        lanzar_interrupcion(cpu, INT_OVERFLOW);
     } else if (res_nativo == 0) {              
         cpu->PSW.codigo_condicion = CC_IGUAL;     //El res de la operacion fue 0, el cod de condicion es 0
     } else if (res_nativo < 0) {
@@ -190,491 +302,695 @@ void cpu_actualizar_cc(CPU_t *cpu, int res_nativo) {
     }
 }
 
-void cpu_ejecutar(CPU_t *cpu, Instruccion_t inst, palabra_t *memoria, ControladorDMA_t *dma) {
-    palabra_t operando;
-    palabra_t res;
-    int direccion;
-    int dir_fisica;
-    
-    if (g_modo_debug) {
-        printf("EXECUTE: OP=%02d, DIR=%d, VAL=%05d\n", 
-               inst.codigo_op, inst.direccionamiento, inst.valor);
+//------------------------------------------------------SEMANTICA DE LAS INSTRUCCIONES-------------------------------------------------------------------------------
+// Cada instruccion vive en su propia funcion inline para que los dos motores de despacho
+// (switch y hilado) compartan exactamente la misma semantica. Las que dependen del modo
+// lo reciben como parametro: los motores las instancian una vez por modo.
+
+// Operacion aritmetica comun a SUM, RES y MULT
+CPU_EN_LINEA void cpu_op_aritmetica(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int codigo_op, const char *nombre, int modo) {
+    palabra_t operando = cpu_obtener_operando_modo(cpu, inst, mem, modo); //Trae el dato (segun el direccionamiento)
+
+    int ac_nat = palabra_a_valor(cpu->AC); // Traducir a enteros nativos en C para hacer la operacion
+    int op_nat = palabra_a_valor(operando);
+
+    int res_nat;
+    if (codigo_op == 0) {
+        res_nat = ac_nat + op_nat; // Hace la suma
+    } else if (codigo_op == 1) {
+        res_nat = ac_nat - op_nat; // Hace la resta
+    } else {
+        res_nat = ac_nat * op_nat; // Hace la multiplicacion
     }
-    
-    switch(inst.codigo_op) {
-        case 0: {// sum
-            operando = cpu_obtener_operando(cpu, inst, memoria); //Trae el dato (segun el direccionamiento)
-            
-            int ac_nat = sm_a_nativo(cpu->AC); // Traducir a enteros nativos en C para hacer la operacion
-            int op_nat = sm_a_nativo(operando);
-            
-            int res_nat = ac_nat + op_nat; // Hace la suma
-            cpu_actualizar_cc(cpu, res_nat); // Actualiza el codigo de condicion
-            
-            res = nativo_a_sm(res_nat); // Transforma a Signo-Magnitud
-            cpu->AC = res; // Guarda el res en AC
-            
-            log_operacion("SUM", cpu->AC, operando, res); // Registra la actividad en el log
-            break;
-        }   
-        case 1: { // res
-            operando = cpu_obtener_operando(cpu, inst, memoria); //Trae el dato (segun el direccionamiento)
-            
-            int ac_nat = sm_a_nativo(cpu->AC); // Traducir a enteros nativos en C para hacer la operacion
-            int op_nat = sm_a_nativo(operando);
-            
-            int res_nat = ac_nat - op_nat; // Hace la resta
-            cpu_actualizar_cc(cpu, res_nat); // Actualiza el codigo de condicion
-            
-            res = nativo_a_sm(res_nat); // Transforma a Signo-Magnitud
-            cpu->AC = res; // Guarda el res en AC
-            
-            log_operacion("RES", cpu->AC, operando, res); // Registra la actividad en el log
-            break;
-        }   
-        case 2: {// mult
-            operando = cpu_obtener_operando(cpu, inst, memoria); //Trae el dato (segun el direccionamiento)
-            
-            int ac_nat = sm_a_nativo(cpu->AC); // Traducir a enteros nativos en C para hacer la operacion
-            int op_nat = sm_a_nativo(operando);
-            
-            int res_nat = ac_nat * op_nat; // Hace la multiplicacion
-            cpu_actualizar_cc(cpu, res_nat); // Actualiza el codigo de condicion
-            
-            res = nativo_a_sm(res_nat); // Transforma a Signo-Magnitud
-            cpu->AC = res; // Guarda el res en AC
-            
-            log_operacion("MULT", cpu->AC, operando, res); // Registra la actividad en el log
-            break;
-        }   
-        case 3: // divi
-            operando = cpu_obtener_operando(cpu, inst, memoria);
-            int op_nat_divi = sm_a_nativo(operando);
-            
-            if (op_nat_divi == 0) {
-                log_operacion("DIVI", cpu->AC, operando, 0);
-                lanzar_interrupcion(INT_OVERFLOW);
-            } else {
-                int ac_nat_divi = sm_a_nativo(cpu->AC);
-                int res_nat_divi = ac_nat_divi / op_nat_divi;
-                
-                cpu_actualizar_cc(cpu, res_nat_divi);
-                res = nativo_a_sm(res_nat_divi);
-                cpu->AC = res;
-                
-                log_operacion("DIVI", cpu->AC, operando, res);
-            }
-            break;
-            
-        case 4: // load
-            operando = cpu_obtener_operando(cpu, inst, memoria);  // Copia un dato de la RAM al registro AC.
-            cpu->AC = operando;
-            log_operacion("LOAD", cpu->AC, operando, cpu->AC);
-            break;
-            
-        case 5: // str copia el valor de AC a la RAM.
-            direccion = cpu_calcular_direccion(cpu, inst);
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                dir_fisica = cpu->RB + direccion;
-                if (!cpu_verificar_memoria(cpu, dir_fisica)) {
-                    lanzar_interrupcion(INT_DIR_INVALIDA);
-                    break;
-                }
-                memoria[dir_fisica] = cpu->AC;
-            } else {
-                memoria[direccion] = cpu->AC;
-            }
-            log_operacion("STR", cpu->AC, direccion, memoria[direccion]);
-            break;
-            
-        case 6: // loadrx
-            cpu->AC = cpu->RX;
-            log_operacion("LOADRX", cpu->AC, cpu->RX, cpu->AC);
-            break;
-            
-        case 7: // strrx
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Si el usuario intenta cambiar la base de su pila.
-                // Verificamos que la nueva direccion base (contenido de AC) 
-                // caiga dentro de su particion de memoria asignada (RB a RL).
-                if (!cpu_verificar_memoria(cpu, cpu->AC)) {
-                    // Si intenta apuntar fuera de su memoria, lanzamos error y abortamos
-                    lanzar_interrupcion(INT_DIR_INVALIDA);
-                    break;
-                }
-            }
-            cpu->RX = cpu->AC;
-            log_operacion("STRRX", cpu->AC, cpu->RX, cpu->RX);
-            break;
-            
-        case 8: // comp
-            operando = cpu_obtener_operando(cpu, inst, memoria);
-            
-            // La comparación también debe hacerse con números nativos de C
-            int ac_nat_comp = sm_a_nativo(cpu->AC);
-            int op_nat_comp = sm_a_nativo(operando);
-            
-            int res_nat_comp = ac_nat_comp - op_nat_comp;
-            cpu_actualizar_cc(cpu, res_nat_comp); // Actualiza los códigos de condición
-            log_operacion("COMP", cpu->AC, operando, nativo_a_sm(res_nat_comp));
-            break;
-            
-        case 9: // jmpe (Salta si AC == M[SP])
-            if (cpu->SP <= 0) { // Verificar que la pila no esté vacía (Underflow)
-                lanzar_interrupcion(INT_UNDERFLOW);
-                break;
-            }
-            
-            dir_fisica = cpu->RX + cpu->SP; // Calcular la dirección física del tope de la pila
-            
-            // Verificar límites de memoria si está en modo usuario
-            if (cpu->PSW.modo == MODO_USUARIO && !cpu_verificar_memoria(cpu, dir_fisica)) {
-                lanzar_interrupcion(INT_DIR_INVALIDA);
-                break;
-            }
+    cpu_actualizar_cc(cpu, res_nat); // Actualiza el codigo de condicion
 
-            // Comparar utilizando las conversiones a enteros nativos
-            if (sm_a_nativo(cpu->AC) == sm_a_nativo(memoria[dir_fisica])) {
-                operando = cpu_obtener_operando(cpu, inst, memoria);
-                
-                if (!interrupcion_pendiente) {
-                    // Ejecutar el salto
-                    cpu_saltar(cpu, operando);
-                    log_operacion("JMPE", cpu->AC, operando, cpu->PSW.pc);
-                }
-            }
-            break;
-            
-        case 10: // jmpne (Salta si AC != M[SP])
-            if (cpu->SP <= 0) {
-                lanzar_interrupcion(INT_UNDERFLOW);
-                break;
-            }
-            
-            dir_fisica = cpu->RX + cpu->SP;
-            
-            if (cpu->PSW.modo == MODO_USUARIO && !cpu_verificar_memoria(cpu, dir_fisica)) {
-                lanzar_interrupcion(INT_DIR_INVALIDA);
-                break;
-            }
+    palabra_t res = valor_a_palabra(res_nat); // Transforma al formato de palabra
+    cpu->AC = res; // Guarda el res en AC
 
-            if (sm_a_nativo(cpu->AC) != sm_a_nativo(memoria[dir_fisica])) {
-                operando = cpu_obtener_operando(cpu, inst, memoria);
-                if (!interrupcion_pendiente) {
-                    cpu_saltar(cpu, operando);
-                    log_operacion("JMPNE", cpu->AC, operando, cpu->PSW.pc);
-                }
-            }
-            break;
-            
-        case 11: // jmplt (Salta si AC < M[SP])
-            if (cpu->SP <= 0) {
-                lanzar_interrupcion(INT_UNDERFLOW);
-                break;
-            }
-            
-            dir_fisica = cpu->RX + cpu->SP;
-            
-            if (cpu->PSW.modo == MODO_USUARIO && !cpu_verificar_memoria(cpu, dir_fisica)) {
-                lanzar_interrupcion(INT_DIR_INVALIDA);
-                break;
-            }
+    LOG_OPERACION(nombre, palabra_a_sm(cpu->AC), palabra_a_sm(operando), palabra_a_sm(res)); // Registra la actividad en el log
+}
 
-            if (sm_a_nativo(cpu->AC) < sm_a_nativo(memoria[dir_fisica])) {
-                operando = cpu_obtener_operando(cpu, inst, memoria);
-                if (!interrupcion_pendiente) {
-                    cpu_saltar(cpu, operando);
-                    log_operacion("JMPLT", cpu->AC, operando, cpu->PSW.pc);
-                }
-            }
-            break;
-            
-        case 12: // jmpgt (Salta si AC > M[SP])
-            if (cpu->SP <= 0) {
-                lanzar_interrupcion(INT_UNDERFLOW);
-                break;
-            }
-            
-            dir_fisica = cpu->RX + cpu->SP;
-            
-            if (cpu->PSW.modo == MODO_USUARIO && !cpu_verificar_memoria(cpu, dir_fisica)) {
-                lanzar_interrupcion(INT_DIR_INVALIDA);
-                break;
-            }
+CPU_EN_LINEA void cpu_op_divi(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int modo) {
+    palabra_t operando = cpu_obtener_operando_modo(cpu, inst, mem, modo);
+    int op_nat_divi = palabra_a_valor(operando);
 
-            if (sm_a_nativo(cpu->AC) > sm_a_nativo(memoria[dir_fisica])) {
-                operando = cpu_obtener_operando(cpu, inst, memoria);
-                if (!interrupcion_pendiente) {
-                    cpu_saltar(cpu, operando);
-                    log_operacion("JMPGT", cpu->AC, operando, cpu->PSW.pc);
-                }
-            }
-            break;
-            
-        case 13: // svc
-            log_operacion("SVC", cpu->AC, 0, 0);
-            lanzar_interrupcion(INT_SYSCALL);
-            break;
-            
-        case 14: // retrn
-            // Validar Underflow
-            if (cpu->SP <= 0) {
-                lanzar_interrupcion(INT_UNDERFLOW);
-                break;
-            }
+    if (op_nat_divi == 0) {
+        LOG_OPERACION("DIVI", palabra_a_sm(cpu->AC), palabra_a_sm(operando), 0);
+        lanzar_interrupcion(cpu, INT_OVERFLOW);
+    } else {
+        int ac_nat_divi = palabra_a_valor(cpu->AC);
+        int res_nat_divi = ac_nat_divi / op_nat_divi;
 
-            int dir_stack = cpu->RX + cpu->SP;
-            
-            // Verificacion de limites fisicos
-            if (dir_stack < 0 || dir_stack >= TAM_MEMORIA) {
-                 lanzar_interrupcion(INT_DIR_INVALIDA); 
-                 break;
-            }
+        cpu_actualizar_cc(cpu, res_nat_divi);
+        palabra_t res = valor_a_palabra(res_nat_divi);
+        cpu->AC = res;
 
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                if (!cpu_verificar_memoria(cpu, dir_stack)) {
-                    lanzar_interrupcion(INT_DIR_INVALIDA);
-                    break;
-                }
-            }
+        LOG_OPERACION("DIVI", palabra_a_sm(cpu->AC), palabra_a_sm(operando), palabra_a_sm(res));
+    }
+}
 
-            cpu->PSW.pc = memoria[dir_stack];
-            cpu->SP--;
-            
-            log_operacion("RETRN", cpu->PSW.pc, cpu->SP, cpu->PSW.pc);
-            break;
-            
-        case 15: // hab
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede habilitar las interrupciones
-                lanzar_interrupcion(INT_INST_INVALIDA); 
-                break;
-            }
-            cpu->PSW.interrupciones = INT_HABILITADAS;
-            log_mensaje("Interrupciones habilitadas");
-            break;
-            
-        case 16: // dhab
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede desabilitar las interrupciones
-                lanzar_interrupcion(INT_INST_INVALIDA); 
-                break;
-            }
-            cpu->PSW.interrupciones = INT_DESHABILITADAS;
-            log_mensaje("Interrupciones deshabilitadas");
-            break;
-            
-        case 17: // tti - establecer tiempo de reloj
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede establecer el tiempo de reloj
-                lanzar_interrupcion(INT_INST_INVALIDA); 
-                break;
-            }
-            // Se maneja en el sistema principal
-            log_operacion("TTI", inst.valor, 0, 0);
-            break;
-            
-        case 18: // chmod
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede cambiar su propio modo
-                lanzar_interrupcion(INT_INST_INVALIDA);
-                break;
-            }
-            cpu->PSW.modo = inst.valor;
-            log_operacion("CHMOD", cpu->PSW.modo, 0, 0);
-            break;
-            
-        case 19: // loadrb
-            cpu->AC = cpu->RB;
-            log_operacion("LOADRB", cpu->AC, cpu->RB, cpu->AC);
-            break;
-            
-        case 20: // strrb
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                    // Un usuario NO puede cambiar su propio registro base
-                    lanzar_interrupcion(INT_INST_INVALIDA); 
-                    break;
-            }
-            cpu->RB = cpu->AC;
-            log_operacion("STRRB", cpu->AC, cpu->RB, cpu->RB);
-            break;
-            
-        case 21: // loadrl
-            cpu->AC = cpu->RL;
-            log_operacion("LOADRL", cpu->AC, cpu->RL, cpu->AC);
-            break;
-            
-        case 22: // strrl
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede cambiar su propio registro limite
-                lanzar_interrupcion(INT_INST_INVALIDA); 
-                break;
-            }
-            cpu->RL = cpu->AC;
-            log_operacion("STRRL", cpu->AC, cpu->RL, cpu->RL);
-            break;
-            
-        case 23: // loadsp
-            cpu->AC = cpu->SP;
-            log_operacion("LOADSP", cpu->AC, cpu->SP, cpu->AC);
-            break;
-            
-        case 24: // strsp
-
-            // Verificar si estamos en MODO USUARIO
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Calculamos donde caeria fisicamente ese puntero
-                int dir_fisica_nueva = cpu->RX + cpu->AC;
-                
-                // Verificamos "las direcciones": ¿Esta entre RB y RL?
-                if (!cpu_verificar_memoria(cpu, dir_fisica_nueva)) {
-                    // Si el usuario intenta poner el SP fuera de su memoria asignada
-                    lanzar_interrupcion(INT_DIR_INVALIDA); 
-                    break; // No actualizamos el SP
-                }
-            }
-            cpu->SP = cpu->AC;
-            log_operacion("STRSP", cpu->AC, cpu->SP, cpu->SP);
-            break;
-            
-        case 25: // psh
-            // Calcular la proxima posicion del SP
-            int proximo_sp = cpu->SP + 1;
-            dir_fisica = cpu->RX + proximo_sp;
+CPU_EN_LINEA void cpu_op_load(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int modo) {
+    palabra_t operando = cpu_obtener_operando_modo(cpu, inst, mem, modo);  // Copia un dato de la RAM al registro AC.
+    cpu->AC = operando;
+    LOG_OPERACION("LOAD", palabra_a_sm(cpu->AC), palabra_a_sm(operando), palabra_a_sm(cpu->AC));
+}
 
-            // Verificar si estamos en MODO USUARIO
-            if (cpu->PSW.modo == MODO_USUARIO) {
+// str copia el valor de AC a la RAM.
+CPU_EN_LINEA void cpu_op_str(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int modo) {
+    palabra_t *memoria = mem->datos;
+    int direccion = cpu_calcular_direccion(cpu, inst);
+    if (modo == MODO_USUARIO) {
+        int dir_fisica = cpu->RB + direccion;
+        if (!cpu_verificar_memoria(cpu, dir_fisica)) {
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
+            return;
+        }
+        dir_fisica = cpu_traducir_escritura(cpu, dir_fisica);
+        if (dir_fisica < 0) return;
+        memoria[dir_fisica] = cpu->AC;
+        memoria_invalidar_decodificada(mem, dir_fisica);
+    } else {
+        memoria[direccion] = cpu->AC;
+        memoria_invalidar_decodificada(mem, direccion);
+    }
+    LOG_OPERACION("STR", palabra_a_sm(cpu->AC), direccion, palabra_a_sm(memoria[direccion]));
+}
 
-                // Verificar si esa direccion fisica es valida para este proceso
-                if (!cpu_verificar_memoria(cpu, dir_fisica)) {
-                    // Si la direccion fisica es mayor del RL (Registro Limite), es un error de direccionamiento
-                    lanzar_interrupcion(INT_DIR_INVALIDA); 
-                    break; 
-                }
-            } else {
-                // En MODO KERNEL, solo se verifica si la direccion fisica es mayor que la memoria
-                if (dir_fisica >= TAM_MEMORIA) {
-                    lanzar_interrupcion(INT_OVERFLOW); // O INT_DIR_INVALIDA segun prefieras
-                    break;
-                }
-            }
+// loadrx, loadrb, loadrl y loadsp copian un registro en el AC
+static inline void cpu_op_leer_registro(CPU_t *cpu, palabra_t registro, const char *nombre) {
+    cpu->AC = sm_a_palabra(registro);
+    LOG_OPERACION(nombre, palabra_a_sm(cpu->AC), registro, palabra_a_sm(cpu->AC));
+}
 
-            //  Ejecutar la operacion 
-            cpu->SP++; // Actualizar el registro SP
-            memoria[dir_fisica] = cpu->AC; // Guardar el AC en la memoria
-            
-            log_operacion("PSH", cpu->AC, cpu->SP, memoria[dir_fisica]);
-            break;
-            
-        case 26: // pop
-            // Verificar Underflow (Pila vacia)
-            if (cpu->SP <= 0) {
-                lanzar_interrupcion(INT_UNDERFLOW);
-                break;
-            }
+CPU_EN_LINEA void cpu_op_strrx(CPU_t *cpu, int modo) {
+    palabra_t nuevo_rx = palabra_a_sm(cpu->AC);
+    if (modo == MODO_USUARIO) {
+        // Si el usuario intenta cambiar la base de su pila.
+        // Verificamos que la nueva direccion base (contenido de AC)
+        // caiga dentro de su particion de memoria asignada (RB a RL).
+        if (!cpu_verificar_memoria(cpu, nuevo_rx)) {
+            // Si intenta apuntar fuera de su memoria, lanzamos error y abortamos
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
+            return;
+        }
+    }
+    cpu->RX = nuevo_rx;
+    LOG_OPERACION("STRRX", palabra_a_sm(cpu->AC), cpu->RX, cpu->RX);
+}
 
-            dir_fisica = cpu->RX + cpu->SP;
+CPU_EN_LINEA void cpu_op_comp(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int modo) {
+    palabra_t operando = cpu_obtener_operando_modo(cpu, inst, mem, modo);
 
-            // Verificar si estamos en MODO USUARIO
-            if (cpu->PSW.modo == MODO_USUARIO) {
+    // La comparación también debe hacerse con números nativos de C
+    int ac_nat_comp = palabra_a_valor(cpu->AC);
+    int op_nat_comp = palabra_a_valor(operando);
 
-                // Verificar si la direccion fisica es valida
-                if (!cpu_verificar_memoria(cpu, dir_fisica)) {
-                    lanzar_interrupcion(INT_DIR_INVALIDA);
-                    break;
-                }
-            } else {
-                if (dir_fisica >= TAM_MEMORIA) {
-                    lanzar_interrupcion(INT_OVERFLOW);
-                    break;
-                }
-            }
+    int res_nat_comp = ac_nat_comp - op_nat_comp;
+    cpu_actualizar_cc(cpu, res_nat_comp); // Actualiza los códigos de condición
+    LOG_OPERACION("COMP", palabra_a_sm(cpu->AC), palabra_a_sm(operando), nativo_a_sm(res_nat_comp));
+}
 
+// Valida y lee el tope de la pila para los saltos condicionales. Retorna 0 si hubo interrupcion.
+CPU_EN_LINEA int cpu_leer_tope_pila(CPU_t *cpu, Memoria_t *mem, palabra_t *tope, int modo) {
+    if (cpu->SP <= 0) { // Verificar que la pila no esté vacía (Underflow)
+        lanzar_interrupcion(cpu, INT_UNDERFLOW);
+        return 0;
+    }
 
-            // 3. Ejecutar la operacion
-            cpu->AC = memoria[dir_fisica]; // Leemos de la direccion fisica
-            cpu->SP--; // Bajamos el puntero
-            
-            log_operacion("POP", cpu->AC, cpu->SP, cpu->AC);
-            break;
-            
-        case 27: // j - salto incondicional
-            operando = cpu_obtener_operando(cpu, inst, memoria);
-            if (!interrupcion_pendiente) {
-                cpu_saltar(cpu, operando);
-                log_operacion("J", 0, operando, cpu->PSW.pc);
-            }
-            break;
-            
+    int dir_fisica = cpu->RX + cpu->SP; // Calcular la dirección física del tope de la pila
+
+    // Verificar límites de memoria si está en modo usuario
+    if (modo == MODO_USUARIO) {
+        if (!cpu_verificar_memoria(cpu, dir_fisica)) {
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
+            return 0;
+        }
+        dir_fisica = cpu_traducir_dato(cpu, dir_fisica);
+        if (dir_fisica < 0) return 0;
+    }
+
+    *tope = mem->datos[dir_fisica];
+    return 1;
+}
+
+// jmpe, jmpne, jmplt y jmpgt: comparan AC con M[SP] (como enteros nativos) y saltan si se cumple
+CPU_EN_LINEA void cpu_op_salto_condicional(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int codigo_op, const char *nombre, int modo) {
+    palabra_t tope;
+    if (!cpu_leer_tope_pila(cpu, mem, &tope, modo)) return;
+
+    int ac_nat = palabra_a_valor(cpu->AC);
+    int tope_nat = palabra_a_valor(tope);
+    int cumple;
+    switch (codigo_op) {
+        case 9:  cumple = (ac_nat == tope_nat); break;
+        case 10: cumple = (ac_nat != tope_nat); break;
+        case 11: cumple = (ac_nat < tope_nat);  break;
+        default: cumple = (ac_nat > tope_nat);  break;
+    }
+
+    if (cumple) {
+        palabra_t operando = cpu_obtener_operando_modo(cpu, inst, mem, modo);
+
+        if (!(cpu->interrupciones_pendientes & INT_MASCARA_SINCRONAS)) { // El operando no fallo
+            // Ejecutar el salto
+            cpu_saltar_modo(cpu, palabra_a_sm(operando), modo);
+            LOG_OPERACION(nombre, palabra_a_sm(cpu->AC), palabra_a_sm(operando), cpu->PSW.pc);
+        }
+    }
+}
+
+static inline void cpu_op_svc(CPU_t *cpu) {
+    LOG_OPERACION("SVC", palabra_a_sm(cpu->AC), 0, 0);
+    lanzar_interrupcion(cpu, INT_SYSCALL);
+}
+
+CPU_EN_LINEA void cpu_op_retrn(CPU_t *cpu, Memoria_t *mem, int modo) {
+    // Validar Underflow
+    if (cpu->SP <= 0) {
+        lanzar_interrupcion(cpu, INT_UNDERFLOW);
+        return;
+    }
+
+    int dir_stack = cpu->RX + cpu->SP;
+
+    // Verificacion de limites fisicos
+    if (dir_stack < 0 || dir_stack >= mem->tam_memoria) {
+         lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
+         return;
+    }
+
+    if (modo == MODO_USUARIO) {
+        if (!cpu_verificar_memoria(cpu, dir_stack)) {
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
+            return;
+        }
+        dir_stack = cpu_traducir_dato(cpu, dir_stack);
+        if (dir_stack < 0) return;
+    }
+
+    cpu->PSW.pc = palabra_a_sm(mem->datos[dir_stack]);
+    cpu->SP--;
+
+    LOG_OPERACION("RETRN", cpu->PSW.pc, cpu->SP, cpu->PSW.pc);
+}
+
+// Las instrucciones privilegiadas lanzan INT_INST_INVALIDA en modo usuario. Retorna 1 si se puede continuar.
+CPU_EN_LINEA int cpu_verificar_privilegio(CPU_t *cpu, int modo) {
+    (void)cpu; // El modo llega resuelto por el motor; se conserva la firma de las demas operaciones
+    if (modo == MODO_USUARIO) {
+        lanzar_interrupcion(cpu, INT_INST_INVALIDA);
+        return 0;
+    }
+    return 1;
+}
+
+CPU_EN_LINEA void cpu_op_hab(CPU_t *cpu, int modo) {
+    // Un usuario NO puede habilitar las interrupciones
+    if (!cpu_verificar_privilegio(cpu, modo)) return;
+    cpu->PSW.interrupciones = INT_HABILITADAS;
+    LOG_DEBUG(LOG_CAT_CPU, "Interrupciones habilitadas");
+}
+
+CPU_EN_LINEA void cpu_op_dhab(CPU_t *cpu, int modo) {
+    // Un usuario NO puede desabilitar las interrupciones
+    if (!cpu_verificar_privilegio(cpu, modo)) return;
+    cpu->PSW.interrupciones = INT_DESHABILITADAS;
+    LOG_DEBUG(LOG_CAT_CPU, "Interrupciones deshabilitadas");
+}
+
+// tti - establecer tiempo de reloj
+CPU_EN_LINEA void cpu_op_tti(CPU_t *cpu, Instruccion_t inst, int modo) {
+    // Un usuario NO puede establecer el tiempo de reloj
+    if (!cpu_verificar_privilegio(cpu, modo)) return;
+    // Se maneja en el sistema principal
+    LOG_OPERACION("TTI", inst.valor, 0, 0);
+}
+
+CPU_EN_LINEA void cpu_op_chmod(CPU_t *cpu, Instruccion_t inst, int modo) {
+    // Un usuario NO puede cambiar su propio modo
+    if (!cpu_verificar_privilegio(cpu, modo)) return;
+    cpu->PSW.modo = inst.valor;
+    LOG_OPERACION("CHMOD", cpu->PSW.modo, 0, 0);
+}
+
+// strrb y strrl: un usuario NO puede cambiar sus registros base y limite
+CPU_EN_LINEA void cpu_op_strrb(CPU_t *cpu, int modo) {
+    if (!cpu_verificar_privilegio(cpu, modo)) return;
+    cpu->RB = palabra_a_sm(cpu->AC);
+    LOG_OPERACION("STRRB", palabra_a_sm(cpu->AC), cpu->RB, cpu->RB);
+}
+
+CPU_EN_LINEA void cpu_op_strrl(CPU_t *cpu, int modo) {
+    if (!cpu_verificar_privilegio(cpu, modo)) return;
+    cpu->RL = palabra_a_sm(cpu->AC);
+    LOG_OPERACION("STRRL", palabra_a_sm(cpu->AC), cpu->RL, cpu->RL);
+}
+
+CPU_EN_LINEA void cpu_op_strsp(CPU_t *cpu, int modo) {
+    // Verificar si estamos en MODO USUARIO
+    if (modo == MODO_USUARIO) {
+        // Calculamos donde caeria fisicamente ese puntero
+        int dir_fisica_nueva = cpu->RX + palabra_a_sm(cpu->AC);
+
+        // Verificamos "las direcciones": ¿Esta entre RB y RL?
+        if (!cpu_verificar_memoria(cpu, dir_fisica_nueva)) {
+            // Si el usuario intenta poner el SP fuera de su memoria asignada
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
+            return; // No actualizamos el SP
+        }
+    }
+    cpu->SP = palabra_a_sm(cpu->AC);
+    LOG_OPERACION("STRSP", palabra_a_sm(cpu->AC), cpu->SP, cpu->SP);
+}
+
+CPU_EN_LINEA void cpu_op_psh(CPU_t *cpu, Memoria_t *mem, int modo) {
+    // Calcular la proxima posicion del SP
+    int proximo_sp = cpu->SP + 1;
+    int dir_fisica = cpu->RX + proximo_sp;
+
+    // Verificar si estamos en MODO USUARIO
+    if (modo == MODO_USUARIO) {
+
+        // Verificar si esa direccion fisica es valida para este proceso
+        if (!cpu_verificar_memoria(cpu, dir_fisica)) {
+            // Si la direccion fisica es mayor del RL (Registro Limite), es un error de direccionamiento
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
+            return;
+        }
+        dir_fisica = cpu_traducir_escritura(cpu, dir_fisica);
+        if (dir_fisica < 0) return;
+    } else {
+        // En MODO KERNEL, solo se verifica si la direccion fisica es mayor que la memoria
+        if (dir_fisica >= mem->tam_memoria) {
+            lanzar_interrupcion(cpu, INT_OVERFLOW); // O INT_DIR_INVALIDA segun prefieras
+            return;
+        }
+    }
+
+    //  Ejecutar la operacion
+    cpu->SP++; // Actualizar el registro SP
+    mem->datos[dir_fisica] = cpu->AC; // Guardar el AC en la memoria
+    memoria_invalidar_decodificada(mem, dir_fisica);
+
+    LOG_OPERACION("PSH", palabra_a_sm(cpu->AC), cpu->SP, palabra_a_sm(mem->datos[dir_fisica]));
+}
+
+CPU_EN_LINEA void cpu_op_pop(CPU_t *cpu, Memoria_t *mem, int modo) {
+    // Verificar Underflow (Pila vacia)
+    if (cpu->SP <= 0) {
+        lanzar_interrupcion(cpu, INT_UNDERFLOW);
+        return;
+    }
+
+    int dir_fisica = cpu->RX + cpu->SP;
+
+    // Verificar si estamos en MODO USUARIO
+    if (modo == MODO_USUARIO) {
+
+        // Verificar si la direccion fisica es valida
+        if (!cpu_verificar_memoria(cpu, dir_fisica)) {
+            lanzar_interrupcion(cpu, INT_DIR_INVALIDA);
+            return;
+        }
+        dir_fisica = cpu_traducir_dato(cpu, dir_fisica);
+        if (dir_fisica < 0) return;
+    } else {
+        if (dir_fisica >= mem->tam_memoria) {
+            lanzar_interrupcion(cpu, INT_OVERFLOW);
+            return;
+        }
+    }
+
+    // 3. Ejecutar la operacion
+    cpu->AC = mem->datos[dir_fisica]; // Leemos de la direccion fisica
+    cpu->SP--; // Bajamos el puntero
+
+    LOG_OPERACION("POP", palabra_a_sm(cpu->AC), cpu->SP, palabra_a_sm(cpu->AC));
+}
+
+// j - salto incondicional
+CPU_EN_LINEA void cpu_op_j(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int modo) {
+    palabra_t operando = cpu_obtener_operando_modo(cpu, inst, mem, modo);
+    if (!(cpu->interrupciones_pendientes & INT_MASCARA_SINCRONAS)) { // El operando no fallo
+        cpu_saltar_modo(cpu, palabra_a_sm(operando), modo);
+        LOG_OPERACION("J", 0, palabra_a_sm(operando), cpu->PSW.pc);
+    }
+}
+
+// sdmap, sdmac, sdmas, sdmaio y sdmam: programan los registros del DMA (solo en modo kernel)
+CPU_EN_LINEA void cpu_op_dma_registro(CPU_t *cpu, Instruccion_t inst, ControladorDMA_t *dma, int modo) {
+    // Un usuario NO puede programar el DMA
+    if (!cpu_verificar_privilegio(cpu, modo)) return;
+
+    switch (inst.codigo_op) {
         case 28: // sdmap - establecer pista
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede establecer la pista del DMA
-                lanzar_interrupcion(INT_INST_INVALIDA); 
-                break;
-            }
             dma_set_pista(dma, inst.valor);
-            log_operacion("SDMAP", 0, inst.valor, 0);
+            LOG_OPERACION("SDMAP", 0, inst.valor, 0);
             break;
-            
         case 29: // sdmac - establecer cilindro
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede establecer el cilindro del DMA
-                lanzar_interrupcion(INT_INST_INVALIDA); 
-                break;
-            }
             dma_set_cilindro(dma, inst.valor);
-            log_operacion("SDMAC", 0, inst.valor, 0);
+            LOG_OPERACION("SDMAC", 0, inst.valor, 0);
             break;
-            
         case 30: // sdmas - establecer sector
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede establecer el sector del DMA
-                lanzar_interrupcion(INT_INST_INVALIDA); 
-                break;
-            }
             dma_set_sector(dma, inst.valor);
-            log_operacion("SDMAS", 0, inst.valor, 0);
+            LOG_OPERACION("SDMAS", 0, inst.valor, 0);
             break;
-            
         case 31: // sdmaio - establecer operacion (0=Leer, 1=Escribir)
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede establecer la operacion del DMA
-                lanzar_interrupcion(INT_INST_INVALIDA); 
-                break;
-            }
             dma_set_operacion(dma, inst.valor);
-            log_operacion("SDMAIO", 0, inst.valor, 0);
+            LOG_OPERACION("SDMAIO", 0, inst.valor, 0);
             break;
-            
-        case 32: // sdmam - establecer direccion memoria
-            int dir_dma = inst.valor;
-
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede establecer la direccion del DMA
-                lanzar_interrupcion(INT_INST_INVALIDA); 
-                break;
-            }
-            
-            // Configurar el DMA con la direccion
-            dma_set_direccion(dma, dir_dma);
-            log_operacion("SDMAM", 0, inst.valor, 0);
+        default: // sdmam - establecer direccion memoria
+            dma_set_direccion(dma, inst.valor);
+            LOG_OPERACION("SDMAM", 0, inst.valor, 0);
             break;
-            
-        case 33: // sdmaon - iniciar DMA
-            if (cpu->PSW.modo == MODO_USUARIO) {
-                // Un usuario NO puede iniciar el DMA
-                lanzar_interrupcion(INT_INST_INVALIDA); 
-                break;
-            }
-            dma_iniciar(dma);
-            log_operacion("SDMAON", 0, 0, 0);
-            break;
-            
-        default:
-            lanzar_interrupcion(INT_INST_INVALIDA);
-            log_error("Instruccion invalida", inst.codigo_op);
+    }
+}
+
+// sdmaon - iniciar DMA
+CPU_EN_LINEA void cpu_op_sdmaon(CPU_t *cpu, ControladorDMA_t *dma, int modo) {
+    // Un usuario NO puede iniciar el DMA
+    if (!cpu_verificar_privilegio(cpu, modo)) return;
+    dma_iniciar(dma, cpu);
+    LOG_OPERACION("SDMAON", 0, 0, 0);
+}
+
+static inline void cpu_op_invalida(CPU_t *cpu, Instruccion_t inst) {
+    lanzar_interrupcion(cpu, INT_INST_INVALIDA);
+    log_error(LOG_CAT_CPU, "Instruccion invalida", inst.codigo_op);
+}
+
+static void cpu_mostrar_depuracion(Instruccion_t inst) {
+    printf("EXECUTE: OP=%02d, DIR=%d, VAL=%05d\n",
+           inst.codigo_op, inst.direccionamiento, inst.valor);
+}
+
+CPU_EN_LINEA void cpu_ejecutar_modo(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, ControladorDMA_t *dma, int modo) {
+    switch(inst.codigo_op) {
+        case 0:  cpu_op_aritmetica(cpu, inst, mem, 0, "SUM", modo); break;   // sum
+        case 1:  cpu_op_aritmetica(cpu, inst, mem, 1, "RES", modo); break;   // res
+        case 2:  cpu_op_aritmetica(cpu, inst, mem, 2, "MULT", modo); break;   // mult
+        case 3:  cpu_op_divi(cpu, inst, mem, modo);            break;   // divi
+        case 4:  cpu_op_load(cpu, inst, mem, modo);            break;   // load
+        case 5:  cpu_op_str(cpu, inst, mem, modo);             break;   // str
+        case 6:  cpu_op_leer_registro(cpu, cpu->RX, "LOADRX"); break;  // loadrx
+        case 7:  cpu_op_strrx(cpu, modo);                      break;   // strrx
+        case 8:  cpu_op_comp(cpu, inst, mem, modo);            break;   // comp
+        case 9:  cpu_op_salto_condicional(cpu, inst, mem, 9, "JMPE", modo); break; // jmpe (Salta si AC == M[SP])
+        case 10: cpu_op_salto_condicional(cpu, inst, mem, 10, "JMPNE", modo); break; // jmpne (Salta si AC != M[SP])
+        case 11: cpu_op_salto_condicional(cpu, inst, mem, 11, "JMPLT", modo); break; // jmplt (Salta si AC < M[SP])
+        case 12: cpu_op_salto_condicional(cpu, inst, mem, 12, "JMPGT", modo); break; // jmpgt (Salta si AC > M[SP])
+        case 13: cpu_op_svc(cpu);                              break;   // svc
+        case 14: cpu_op_retrn(cpu, mem, modo);                 break;   // retrn
+        case 15: cpu_op_hab(cpu, modo);                        break;   // hab
+        case 16: cpu_op_dhab(cpu, modo);                       break;   // dhab
+        case 17: cpu_op_tti(cpu, inst, modo);                  break;   // tti
+        case 18: cpu_op_chmod(cpu, inst, modo);                break;   // chmod
+        case 19: cpu_op_leer_registro(cpu, cpu->RB, "LOADRB"); break;  // loadrb
+        case 20: cpu_op_strrb(cpu, modo);                      break;   // strrb
+        case 21: cpu_op_leer_registro(cpu, cpu->RL, "LOADRL"); break;  // loadrl
+        case 22: cpu_op_strrl(cpu, modo);                      break;   // strrl
+        case 23: cpu_op_leer_registro(cpu, cpu->SP, "LOADSP"); break;  // loadsp
+        case 24: cpu_op_strsp(cpu, modo);                      break;   // strsp
+        case 25: cpu_op_psh(cpu, mem, modo);                   break;   // psh
+        case 26: cpu_op_pop(cpu, mem, modo);                   break;   // pop
+        case 27: cpu_op_j(cpu, inst, mem, modo);               break;   // j - salto incondicional
+        case 28: case 29: case 30: case 31: case 32:                    // sdmap, sdmac, sdmas, sdmaio, sdmam
+            cpu_op_dma_registro(cpu, inst, dma, modo);
             break;
+        case 33: cpu_op_sdmaon(cpu, dma, modo);                break;   // sdmaon - iniciar DMA
+        default: cpu_op_invalida(cpu, inst);                   break;
+    }
+}
+
+void cpu_ejecutar(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, ControladorDMA_t *dma) {
+    if (cpu->modo_debug) {
+        cpu_mostrar_depuracion(inst);
+    }
+    cpu_ejecutar_modo(cpu, inst, mem, dma, cpu->PSW.modo);
+}
+
+// Manejadores individuales con firma uniforme, para quien llama a una instruccion
+// concreta sin pasar por el switch (el JIT emite llamadas directas a ellos).
+#define CPU_MANEJADOR(nombre, llamada)                                                          \
+    static void cpu_manejador_##nombre(CPU_t *cpu, const Instruccion_t *inst, Memoria_t *mem,   \
+                                       ControladorDMA_t *dma) {                                 \
+        (void)cpu; (void)inst; (void)mem; (void)dma;                                            \
+        llamada;                                                                                \
+    }
+
+CPU_MANEJADOR(sum,          cpu_op_aritmetica(cpu, *inst, mem, 0, "SUM", cpu->PSW.modo))
+CPU_MANEJADOR(res,          cpu_op_aritmetica(cpu, *inst, mem, 1, "RES", cpu->PSW.modo))
+CPU_MANEJADOR(mult,         cpu_op_aritmetica(cpu, *inst, mem, 2, "MULT", cpu->PSW.modo))
+CPU_MANEJADOR(divi,         cpu_op_divi(cpu, *inst, mem, cpu->PSW.modo))
+CPU_MANEJADOR(load,         cpu_op_load(cpu, *inst, mem, cpu->PSW.modo))
+CPU_MANEJADOR(str,          cpu_op_str(cpu, *inst, mem, cpu->PSW.modo))
+CPU_MANEJADOR(loadrx,       cpu_op_leer_registro(cpu, cpu->RX, "LOADRX"))
+CPU_MANEJADOR(strrx,        cpu_op_strrx(cpu, cpu->PSW.modo))
+CPU_MANEJADOR(comp,         cpu_op_comp(cpu, *inst, mem, cpu->PSW.modo))
+CPU_MANEJADOR(jmpe,         cpu_op_salto_condicional(cpu, *inst, mem, 9, "JMPE", cpu->PSW.modo))
+CPU_MANEJADOR(jmpne,        cpu_op_salto_condicional(cpu, *inst, mem, 10, "JMPNE", cpu->PSW.modo))
+CPU_MANEJADOR(jmplt,        cpu_op_salto_condicional(cpu, *inst, mem, 11, "JMPLT", cpu->PSW.modo))
+CPU_MANEJADOR(jmpgt,        cpu_op_salto_condicional(cpu, *inst, mem, 12, "JMPGT", cpu->PSW.modo))
+CPU_MANEJADOR(svc,          cpu_op_svc(cpu))
+CPU_MANEJADOR(retrn,        cpu_op_retrn(cpu, mem, cpu->PSW.modo))
+CPU_MANEJADOR(hab,          cpu_op_hab(cpu, cpu->PSW.modo))
+CPU_MANEJADOR(dhab,         cpu_op_dhab(cpu, cpu->PSW.modo))
+CPU_MANEJADOR(tti,          cpu_op_tti(cpu, *inst, cpu->PSW.modo))
+CPU_MANEJADOR(chmod,        cpu_op_chmod(cpu, *inst, cpu->PSW.modo))
+CPU_MANEJADOR(loadrb,       cpu_op_leer_registro(cpu, cpu->RB, "LOADRB"))
+CPU_MANEJADOR(strrb,        cpu_op_strrb(cpu, cpu->PSW.modo))
+CPU_MANEJADOR(loadrl,       cpu_op_leer_registro(cpu, cpu->RL, "LOADRL"))
+CPU_MANEJADOR(strrl,        cpu_op_strrl(cpu, cpu->PSW.modo))
+CPU_MANEJADOR(loadsp,       cpu_op_leer_registro(cpu, cpu->SP, "LOADSP"))
+CPU_MANEJADOR(strsp,        cpu_op_strsp(cpu, cpu->PSW.modo))
+CPU_MANEJADOR(psh,          cpu_op_psh(cpu, mem, cpu->PSW.modo))
+CPU_MANEJADOR(pop,          cpu_op_pop(cpu, mem, cpu->PSW.modo))
+CPU_MANEJADOR(j,            cpu_op_j(cpu, *inst, mem, cpu->PSW.modo))
+CPU_MANEJADOR(dma_registro, cpu_op_dma_registro(cpu, *inst, dma, cpu->PSW.modo))
+CPU_MANEJADOR(sdmaon,       cpu_op_sdmaon(cpu, dma, cpu->PSW.modo))
+CPU_MANEJADOR(invalida,     cpu_op_invalida(cpu, *inst))
+
+#undef CPU_MANEJADOR
+
+static const ManejadorInstruccion_t tabla_manejadores[CANT_OPCODES] = {
+    cpu_manejador_sum, cpu_manejador_res, cpu_manejador_mult, cpu_manejador_divi,
+    cpu_manejador_load, cpu_manejador_str, cpu_manejador_loadrx, cpu_manejador_strrx,
+    cpu_manejador_comp, cpu_manejador_jmpe, cpu_manejador_jmpne, cpu_manejador_jmplt,
+    cpu_manejador_jmpgt, cpu_manejador_svc, cpu_manejador_retrn, cpu_manejador_hab,
+    cpu_manejador_dhab, cpu_manejador_tti, cpu_manejador_chmod, cpu_manejador_loadrb,
+    cpu_manejador_strrb, cpu_manejador_loadrl, cpu_manejador_strrl, cpu_manejador_loadsp,
+    cpu_manejador_strsp, cpu_manejador_psh, cpu_manejador_pop, cpu_manejador_j,
+    cpu_manejador_dma_registro, cpu_manejador_dma_registro, cpu_manejador_dma_registro,
+    cpu_manejador_dma_registro, cpu_manejador_dma_registro, cpu_manejador_sdmaon
+};
+
+ManejadorInstruccion_t cpu_manejador_instruccion(int codigo_op) {
+    if (codigo_op < 0 || codigo_op >= CANT_OPCODES) {
+        return cpu_manejador_invalida;
+    }
+    return tabla_manejadores[codigo_op];
+}
+
+//------------------------------------------------------PERFIL DE EJECUCION----------------------------------------------------------------------------------------
+
+__thread PerfilCPU_t perfil_cpu = { .hasta_muestra = PERFIL_PERIODO_MUESTREO, .clase_muestra = -1 };
+
+static const char *const nombres_opcode[CANT_OPCODES + 1] = {
+    "SUM", "RES", "MULT", "DIVI", "LOAD", "STR", "LOADRX", "STRRX", "COMP", "JMPE", "JMPNE",
+    "JMPLT", "JMPGT", "SVC", "RETRN", "HAB", "DHAB", "TTI", "CHMOD", "LOADRB", "STRRB", "LOADRL",
+    "STRRL", "LOADSP", "STRSP", "PSH", "POP", "J", "SDMAP", "SDMAC", "SDMAS", "SDMAIO", "SDMAM",
+    "SDMAON", "INVALIDA"
+};
+
+static const unsigned char clase_opcode[CANT_OPCODES + 1] = {
+    CLASE_ARITMETICA, CLASE_ARITMETICA, CLASE_ARITMETICA, CLASE_ARITMETICA,
+    CLASE_MEMORIA, CLASE_MEMORIA, CLASE_REGISTROS, CLASE_REGISTROS,
+    CLASE_SALTOS, CLASE_SALTOS, CLASE_SALTOS, CLASE_SALTOS, CLASE_SALTOS,
+    CLASE_SISTEMA, CLASE_PILA, CLASE_SISTEMA, CLASE_SISTEMA, CLASE_SISTEMA, CLASE_SISTEMA,
+    CLASE_REGISTROS, CLASE_REGISTROS, CLASE_REGISTROS, CLASE_REGISTROS, CLASE_REGISTROS, CLASE_REGISTROS,
+    CLASE_PILA, CLASE_PILA, CLASE_SALTOS,
+    CLASE_DMA, CLASE_DMA, CLASE_DMA, CLASE_DMA, CLASE_DMA, CLASE_DMA,
+    CLASE_SISTEMA
+};
+
+static const char *const nombres_clase[CANT_CLASES] = {
+    "aritmetica", "memoria", "registros", "saltos", "pila", "sistema", "dma"
+};
+
+const char *cpu_nombre_opcode(int codigo_op) {
+    if (codigo_op < 0 || codigo_op >= CANT_OPCODES) return nombres_opcode[CANT_OPCODES];
+    return nombres_opcode[codigo_op];
+}
+
+const char *cpu_nombre_clase(int clase) {
+    return (clase >= 0 && clase < CANT_CLASES) ? nombres_clase[clase] : "?";
+}
+
+void cpu_perfil_reiniciar(void) {
+    int activo = perfil_cpu.activo;
+    memset(&perfil_cpu, 0, sizeof(PerfilCPU_t));
+    perfil_cpu.activo = activo;
+    perfil_cpu.hasta_muestra = PERFIL_PERIODO_MUESTREO;
+    perfil_cpu.clase_muestra = -1;
+}
+
+void cpu_perfil_acumular(PerfilCPU_t *destino, const PerfilCPU_t *origen) {
+    for (int i = 0; i <= CANT_OPCODES; i++) destino->por_opcode[i] += origen->por_opcode[i];
+    for (int i = 0; i < 4; i++) destino->por_direccionamiento[i] += origen->por_direccionamiento[i];
+    for (int i = 0; i < CANT_INTERRUPCIONES; i++) destino->interrupciones[i] += origen->interrupciones[i];
+    for (int c = 0; c < CANT_CLASES; c++) {
+        destino->muestras[c] += origen->muestras[c];
+        destino->ns[c] += origen->ns[c];
+    }
+}
+
+static long long cpu_perfil_reloj_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// Indice de opcode con los codigos fuera de rango en la ultima posicion
+static int cpu_perfil_indice(int codigo_op) {
+    return (codigo_op < 0 || codigo_op >= CANT_OPCODES) ? CANT_OPCODES : codigo_op;
+}
+
+void cpu_perfil_contar(const Instruccion_t *inst) {
+    perfil_cpu.por_opcode[cpu_perfil_indice(inst->codigo_op)]++;
+    perfil_cpu.por_direccionamiento[inst->direccionamiento <= DIR_INDEXADO ? inst->direccionamiento : 3]++;
+}
+
+// Los motores llaman a estas dos funciones solo con el perfil activo: iniciar al despachar
+// (cuenta y quizas empieza una muestra) y terminar al volver del manejador
+static void cpu_perfil_iniciar(const Instruccion_t *inst) {
+    cpu_perfil_contar(inst);
+    if (--perfil_cpu.hasta_muestra <= 0) {
+        // Intervalo entre PERIODO/2 y 3*PERIODO/2 con un generador congruencial
+        perfil_cpu.semilla = perfil_cpu.semilla * 1103515245u + 12345u;
+        perfil_cpu.hasta_muestra = PERFIL_PERIODO_MUESTREO / 2 + (perfil_cpu.semilla >> 16) % PERFIL_PERIODO_MUESTREO;
+        perfil_cpu.clase_muestra = clase_opcode[cpu_perfil_indice(inst->codigo_op)];
+        perfil_cpu.inicio_muestra = cpu_perfil_reloj_ns();
+    }
+}
+
+static void cpu_perfil_terminar(void) {
+    if (perfil_cpu.clase_muestra < 0) return;
+    perfil_cpu.ns[perfil_cpu.clase_muestra] += cpu_perfil_reloj_ns() - perfil_cpu.inicio_muestra;
+    perfil_cpu.muestras[perfil_cpu.clase_muestra]++;
+    perfil_cpu.clase_muestra = -1;
+}
+
+//------------------------------------------------------SUPERINSTRUCCIONES-----------------------------------------------------------------------------------------
+// Secuencias frecuentes de opcodes detectadas al cargar el programa que se ejecutan con un
+// solo despacho. Cada parte sigue contando como un ciclo y pasa por su propia busqueda, asi
+// que PSW.pc, MAR/MDR/IR y las interrupciones quedan exactamente donde quedarian sin fusion.
+
+// Cantidad de instrucciones que cubre cada tipo de superinstruccion
+static const int largo_fusion[CANT_FUSIONES] = {
+    [FUSION_NINGUNA] = 1,
+    [FUSION_LOADI_PSH] = 2,
+    [FUSION_LOAD_ARIT_STR] = 3,
+    [FUSION_COMP_SALTO] = 2,
+    [FUSION_PSH_SALTO] = 2
+};
+
+static const char *const nombres_aritmetica[] = {"SUM", "RES", "MULT"};
+static const char *const nombres_salto[] = {"JMPE", "JMPNE", "JMPLT", "JMPGT"};
+
+static int es_salto_condicional(int codigo_op) {
+    return codigo_op >= 9 && codigo_op <= 12;
+}
+
+int cpu_detectar_fusion(const Instruccion_t *seq, int disponibles) {
+    if (disponibles >= 3 && seq[0].codigo_op == 4 &&
+        seq[1].codigo_op >= 0 && seq[1].codigo_op <= 2 && seq[2].codigo_op == 5) {
+        return FUSION_LOAD_ARIT_STR;
     }
+    if (disponibles >= 2) {
+        if (seq[0].codigo_op == 4 && seq[0].direccionamiento == DIR_INMEDIATO && seq[1].codigo_op == 25) {
+            return FUSION_LOADI_PSH;
+        }
+        if (seq[0].codigo_op == 8 && es_salto_condicional(seq[1].codigo_op)) {
+            return FUSION_COMP_SALTO;
+        }
+        if (seq[0].codigo_op == 25 && (seq[1].codigo_op == 27 || es_salto_condicional(seq[1].codigo_op))) {
+            return FUSION_PSH_SALTO;
+        }
+    }
+    return FUSION_NINGUNA;
+}
+
+// Busca la siguiente parte de una superinstruccion. Retorna 0 si hay que cortar la secuencia:
+// la parte anterior dejo una interrupcion pendiente, una escritura invalido la fusion, o la
+// busqueda fallo (ese ciclo ya queda contado en *ciclos).
+CPU_EN_LINEA int cpu_siguiente_parte(CPU_t *cpu, Memoria_t *mem, int cabeza, int tipo, Instruccion_t *inst, int *ciclos, int modo) {
+    if (cpu->interrupciones_pendientes || mem->fusion[cabeza] != tipo) return 0;
+
+    cpu_busqueda_modo(cpu, mem, modo);
+    (*ciclos)++;
+    if (cpu->interrupciones_pendientes) return 0;
+
+    *inst = mem->decodificadas[cpu->MAR];
+    if (perfil_cpu.activo) cpu_perfil_contar(inst);
+    return 1;
+}
+
+// Cada funcion recibe la primera parte ya buscada y retorna los ciclos consumidos
+CPU_EN_LINEA int cpu_fusion_loadi_psh(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int modo) {
+    int cabeza = cpu->MAR, ciclos = 1;
+    cpu_op_load(cpu, inst, mem, modo);
+    if (!cpu_siguiente_parte(cpu, mem, cabeza, FUSION_LOADI_PSH, &inst, &ciclos, modo)) return ciclos;
+    cpu_op_psh(cpu, mem, modo);
+    return ciclos;
+}
+
+CPU_EN_LINEA int cpu_fusion_load_arit_str(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int modo) {
+    int cabeza = cpu->MAR, ciclos = 1;
+    cpu_op_load(cpu, inst, mem, modo);
+    if (!cpu_siguiente_parte(cpu, mem, cabeza, FUSION_LOAD_ARIT_STR, &inst, &ciclos, modo)) return ciclos;
+    cpu_op_aritmetica(cpu, inst, mem, inst.codigo_op, nombres_aritmetica[inst.codigo_op], modo);
+    if (!cpu_siguiente_parte(cpu, mem, cabeza, FUSION_LOAD_ARIT_STR, &inst, &ciclos, modo)) return ciclos;
+    cpu_op_str(cpu, inst, mem, modo);
+    return ciclos;
+}
+
+CPU_EN_LINEA int cpu_fusion_comp_salto(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int modo) {
+    int cabeza = cpu->MAR, ciclos = 1;
+    cpu_op_comp(cpu, inst, mem, modo);
+    if (!cpu_siguiente_parte(cpu, mem, cabeza, FUSION_COMP_SALTO, &inst, &ciclos, modo)) return ciclos;
+    cpu_op_salto_condicional(cpu, inst, mem, inst.codigo_op, nombres_salto[inst.codigo_op - 9], modo);
+    return ciclos;
+}
+
+CPU_EN_LINEA int cpu_fusion_psh_salto(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int modo) {
+    int cabeza = cpu->MAR, ciclos = 1;
+    cpu_op_psh(cpu, mem, modo);
+    if (!cpu_siguiente_parte(cpu, mem, cabeza, FUSION_PSH_SALTO, &inst, &ciclos, modo)) return ciclos;
+    if (inst.codigo_op == 27) {
+        cpu_op_j(cpu, inst, mem, modo);
+    } else {
+        cpu_op_salto_condicional(cpu, inst, mem, inst.codigo_op, nombres_salto[inst.codigo_op - 9], modo);
+    }
+    return ciclos;
+}
+
+CPU_EN_LINEA int cpu_ejecutar_fusion(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, int tipo, int modo) {
+    switch (tipo) {
+        case FUSION_LOADI_PSH:     return cpu_fusion_loadi_psh(cpu, inst, mem, modo);
+        case FUSION_LOAD_ARIT_STR: return cpu_fusion_load_arit_str(cpu, inst, mem, modo);
+        case FUSION_COMP_SALTO:    return cpu_fusion_comp_salto(cpu, inst, mem, modo);
+        default:                   return cpu_fusion_psh_salto(cpu, inst, mem, modo);
+    }
+}
+
+// Se fusiona solo si la rafaga tiene ciclos para la secuencia completa. El modo debug
+// imprime cada instruccion desde cpu_ejecutar, asi que ahi no se fusiona.
+CPU_EN_LINEA int cpu_fusion_aplicable(CPU_t *cpu, Memoria_t *mem, int ciclos_restantes) {
+    int tipo = mem->fusion[cpu->MAR];
+    if (tipo == FUSION_NINGUNA || cpu->modo_debug || ciclos_restantes < largo_fusion[tipo]) {
+        return FUSION_NINGUNA;
+    }
+    return tipo;
 }
 
  //Guarda los datos del PSW en la RAM
@@ -694,63 +1010,186 @@ PSW_t cpu_palabra_a_psw(palabra_t palabra) {
     return psw;
 }
 
+// Direccion fisica de una palabra de la pila al salvar o restaurar el contexto. Con
+// paginacion las paginas de la pila se cargan al crear el proceso, asi que no fallan; fuera
+// del espacio del proceso se obtiene -1 y esa palabra no se toca.
+static int cpu_direccion_pila(CPU_t *cpu, int direccion) {
+    return memoria_traducir(cpu->paginas, direccion);
+}
+
+// Igual para escribir: si SP quedo dentro del codigo compartido tampoco se toca
+static int cpu_direccion_pila_escritura(CPU_t *cpu, int direccion) {
+    int fisica = cpu_direccion_pila(cpu, direccion);
+    if (fisica >= 0 && cpu->paginas != NULL && cpu->paginas->compartida[direccion / TAM_PAGINA]) return -1;
+    return fisica;
+}
+
  //Se usa cuando ocurre una interrupcion, guardamos todo para que el SO pueda retomar
-void cpu_salvar_contexto(CPU_t *cpu, palabra_t *memoria) {
+void cpu_salvar_contexto(CPU_t *cpu, Memoria_t *mem) {
+    palabra_t *memoria = mem->datos;
+
     // Determinamos si el SP es relativo (Usuario) o absoluto (Kernel)
-    
     int base = cpu->RX;
 
     // Sube el puntero de pila y guarda el AC
     cpu->SP++;
-    int dir_fisica = base + cpu->SP;
-    memoria[dir_fisica] = cpu->AC;
+    int dir_fisica = cpu_direccion_pila_escritura(cpu, base + cpu->SP);
+    if (dir_fisica >= 0) {
+        memoria[dir_fisica] = cpu->AC;
+        memoria_invalidar_decodificada(mem, dir_fisica);
+    }
     
     // Sube el puntero y guarda el RX
     cpu->SP++;
-    dir_fisica = base + cpu->SP;
-    memoria[dir_fisica] = cpu->RX;
+    dir_fisica = cpu_direccion_pila_escritura(cpu, base + cpu->SP);
+    if (dir_fisica >= 0) {
+        memoria[dir_fisica] = sm_a_palabra(cpu->RX);
+        memoria_invalidar_decodificada(mem, dir_fisica);
+    }
     
-    // Guardar PSW
+    // Guardar PSW (empaquetado en Signo-Magnitud, el CC ocupa el digito de signo)
     cpu->SP++;
-    dir_fisica = base + cpu->SP;
-    memoria[dir_fisica] = cpu_psw_a_palabra(cpu->PSW);
+    dir_fisica = cpu_direccion_pila_escritura(cpu, base + cpu->SP);
+    if (dir_fisica >= 0) {
+        memoria[dir_fisica] = sm_a_palabra(cpu_psw_a_palabra(cpu->PSW));
+        memoria_invalidar_decodificada(mem, dir_fisica);
+    }
 }
 
 //saca los valores de la pila para que la CPU siga exactamente donde se quedo
-void cpu_restaurar_contexto(CPU_t *cpu, palabra_t *memoria) {
+void cpu_restaurar_contexto(CPU_t *cpu, Memoria_t *mem) {
+    palabra_t *memoria = mem->datos;
     int base = cpu->RX;
 
     // Recuperar PSW
-    int dir_fisica = base + cpu->SP;
-    palabra_t psw_raw = memoria[dir_fisica];
+    int dir_fisica = cpu_direccion_pila(cpu, base + cpu->SP);
+    palabra_t psw_raw = dir_fisica >= 0 ? palabra_a_sm(memoria[dir_fisica]) : 0;
 
     // Recupera y desglosa el PSW, luego baja la pila
     cpu->PSW = cpu_palabra_a_psw(psw_raw);
     cpu->SP--;
     
     // Recuperar RX
-    dir_fisica = base + cpu->SP;
-    cpu->RX = memoria[dir_fisica];
+    dir_fisica = cpu_direccion_pila(cpu, base + cpu->SP);
+    cpu->RX = dir_fisica >= 0 ? palabra_a_sm(memoria[dir_fisica]) : cpu->RX;
     cpu->SP--;
     
     // Recuperar AC
-    dir_fisica = base + cpu->SP;
-    cpu->AC = memoria[dir_fisica];
+    dir_fisica = cpu_direccion_pila(cpu, base + cpu->SP);
+    cpu->AC = dir_fisica >= 0 ? memoria[dir_fisica] : 0;
     cpu->SP--;
 }
 
-void cpu_ciclo_instruccion(CPU_t *cpu, palabra_t *memoria, ControladorDMA_t *dma) {
+// Decodificacion: se toma de la cache predecodificada si la palabra no ha sido
+// modificada desde la carga; si no, se decodifica y se vuelve a guardar.
+CPU_EN_LINEA Instruccion_t cpu_instruccion_actual(CPU_t *cpu, Memoria_t *mem) {
+    if (!mem->decodificada_valida[cpu->MAR]) {
+        mem->decodificadas[cpu->MAR] = cpu_decodificar_instruccion(palabra_a_sm(cpu->IR));
+        mem->decodificada_valida[cpu->MAR] = 1;
+    }
+    return mem->decodificadas[cpu->MAR];
+}
+
+void cpu_ciclo_instruccion(CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma) {
     // Fase de busqueda
-    cpu_busqueda(cpu, memoria);
+    cpu_busqueda(cpu, mem);
 
     // Si la busqueda lanzo una interrupcion (ej. fuera de limites), abortamos el ciclo
-    if (interrupcion_pendiente) {
+    if (cpu->interrupciones_pendientes) {
         return; 
     }
     
     // Fase de decodificacion
-    Instruccion_t inst = cpu_decodificar_instruccion(cpu->IR);
+    Instruccion_t inst = cpu_instruccion_actual(cpu, mem);
     
     // Fase de ejecucion
-    cpu_ejecutar(cpu, inst, memoria, dma);
-}
\ No newline at end of file
+    cpu_ejecutar(cpu, inst, mem, dma);
+}
+
+//------------------------------------------------------MOTORES DE DESPACHO----------------------------------------------------------------------------------------
+// Cada motor se instancia dos veces: una para modo usuario (con reubicacion y verificacion
+// de limites) y otra para modo kernel (acceso fisico directo). La rafaga de un modo termina
+// cuando CHMOD cambia el modo; las interrupciones ya cortan la rafaga por si mismas.
+
+// Una rafaga termina al consumir max_ciclos, al quedar una interrupcion pendiente
+// o cuando el PC sale de la memoria (el sistema termina el proceso en ese caso).
+#define CPU_RAFAGA_DEBE_PARAR(cpu, mem, ciclos, max_ciclos) \
+    (cpu->interrupciones_pendientes || (ciclos) >= (max_ciclos) || \
+     (cpu)->PSW.pc < 0 || (cpu)->PSW.pc >= (mem)->tam_memoria)
+
+// Motor switch: un despacho central por instruccion a traves de cpu_ejecutar_modo
+CPU_EN_LINEA int cpu_rafaga_switch(CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma, int max_ciclos, EstadisticasCPU_t *est, int modo) {
+    int ciclos = 0;
+    do {
+        cpu_busqueda_modo(cpu, mem, modo);
+        if (cpu->interrupciones_pendientes) {
+            ciclos++;
+            break;
+        }
+
+        Instruccion_t inst = cpu_instruccion_actual(cpu, mem);
+        if (perfil_cpu.activo) cpu_perfil_iniciar(&inst);
+        int tipo = cpu_fusion_aplicable(cpu, mem, max_ciclos - ciclos);
+        if (tipo != FUSION_NINGUNA) {
+            ciclos += cpu_ejecutar_fusion(cpu, inst, mem, tipo, modo);
+            est->despachos_fusionados++;
+        } else {
+            if (cpu->modo_debug) {
+                cpu_mostrar_depuracion(inst);
+            }
+            cpu_ejecutar_modo(cpu, inst, mem, dma, modo);
+            ciclos++;
+            est->despachos_simples++;
+        }
+        if (perfil_cpu.activo) cpu_perfil_terminar();
+        if (tipo == FUSION_NINGUNA && inst.codigo_op == 18) break; // CHMOD: el resto de la rafaga puede ser de otro modo
+    } while (!CPU_RAFAGA_DEBE_PARAR(cpu, mem, ciclos, max_ciclos));
+    return ciclos;
+}
+
+static int cpu_rafaga_switch_usuario(CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma, int max_ciclos, EstadisticasCPU_t *est) {
+    return cpu_rafaga_switch(cpu, mem, dma, max_ciclos, est, MODO_USUARIO);
+}
+
+static int cpu_rafaga_switch_kernel(CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma, int max_ciclos, EstadisticasCPU_t *est) {
+    return cpu_rafaga_switch(cpu, mem, dma, max_ciclos, est, MODO_KERNEL);
+}
+
+#if defined(CPU_DESPACHO_HILADO) && defined(__GNUC__)
+
+// El motor hilado usa goto computado y GCC no expande en linea funciones con etiquetas
+// tomadas por direccion, asi que sus dos instancias se generan incluyendo la plantilla
+#define CPU_RAFAGA_HILADA_NOMBRE cpu_rafaga_hilada_usuario
+#define CPU_RAFAGA_HILADA_MODO MODO_USUARIO
+#include "cpu_rafaga_hilada.h"
+#undef CPU_RAFAGA_HILADA_NOMBRE
+#undef CPU_RAFAGA_HILADA_MODO
+
+#define CPU_RAFAGA_HILADA_NOMBRE cpu_rafaga_hilada_kernel
+#define CPU_RAFAGA_HILADA_MODO MODO_KERNEL
+#include "cpu_rafaga_hilada.h"
+#undef CPU_RAFAGA_HILADA_NOMBRE
+#undef CPU_RAFAGA_HILADA_MODO
+
+#endif
+
+// Elige el motor del modo actual y lo vuelve a elegir solo si la rafaga cambio de modo
+int cpu_ejecutar_rafaga(CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma, int max_ciclos, EstadisticasCPU_t *est) {
+    int ciclos = 0;
+    do {
+        int restantes = max_ciclos - ciclos;
+#if defined(CPU_DESPACHO_HILADO) && defined(__GNUC__)
+        // El modo debug imprime cada instruccion, asi que usa el motor switch
+        if (!cpu->modo_debug) {
+            ciclos += (cpu->PSW.modo == MODO_USUARIO)
+                ? cpu_rafaga_hilada_usuario(cpu, mem, dma, restantes, est)
+                : cpu_rafaga_hilada_kernel(cpu, mem, dma, restantes, est);
+            continue;
+        }
+#endif
+        ciclos += (cpu->PSW.modo == MODO_USUARIO)
+            ? cpu_rafaga_switch_usuario(cpu, mem, dma, restantes, est)
+            : cpu_rafaga_switch_kernel(cpu, mem, dma, restantes, est);
+    } while (!CPU_RAFAGA_DEBE_PARAR(cpu, mem, ciclos, max_ciclos));
+    return ciclos;
+}
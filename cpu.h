@@ -2,31 +2,144 @@
 #define CPU_H
 
 #include "tipos.h"
+#include "memoria.h"
 #include "dma.h"
 
 
 int sm_a_nativo(palabra_t sm);
 palabra_t nativo_a_sm(int valor);
-// Inicializa la CPU
-void cpu_inicializar(CPU_t *cpu);
+
+// Representacion interna de las palabras en memoria y registros.
+// Por defecto se guardan en Signo-Magnitud tal como las ve el programa. Con
+// "make PALABRA=nativa" toda palabra con digito de signo 1 se guarda como entero
+// negativo de C, asi la aritmetica no tiene que dividir en cada instruccion. Eso
+// incluye las instrucciones de codigo de operacion 10 a 19 (JMPNE..LOADRB), por lo
+// que todo decodificador debe pasar la palabra por palabra_a_sm antes de separarla.
+// La conversion a Signo-Magnitud solo ocurre donde el formato es visible: carga de
+// programas, memestat, sectores del DMA, PSW en la pila y el log.
+#ifdef CPU_PALABRA_NATIVA
+
+// Palabra en Signo-Magnitud -> representacion interna
+static inline palabra_t sm_a_palabra(palabra_t sm) {
+    return (sm > 10000000 && sm < 20000000) ? 10000000 - sm : sm;
+}
+
+// Representacion interna -> palabra en Signo-Magnitud
+static inline palabra_t palabra_a_sm(palabra_t palabra) {
+    return palabra < 0 ? 10000000 - palabra : palabra;
+}
+
+// Valor aritmetico de una palabra (igual que sm_a_nativo sobre su forma Signo-Magnitud)
+static inline int palabra_a_valor(palabra_t palabra) {
+    return palabra >= 10000000 ? palabra % 10000000 : palabra;
+}
+
+// Resultado aritmetico -> palabra, saturando la magnitud a 7 digitos como nativo_a_sm
+static inline palabra_t valor_a_palabra(int valor) {
+    if (valor > 9999999) return 9999999;
+    if (valor < -9999999) return -9999999;
+    return valor;
+}
+
+#else
+
+static inline palabra_t sm_a_palabra(palabra_t sm) { return sm; }
+static inline palabra_t palabra_a_sm(palabra_t palabra) { return palabra; }
+static inline int palabra_a_valor(palabra_t palabra) { return sm_a_nativo(palabra); }
+static inline palabra_t valor_a_palabra(int valor) { return nativo_a_sm(valor); }
+
+#endif
+
+// Inicializa la CPU en modo kernel al comienzo del area del SO de la memoria
+void cpu_inicializar(CPU_t *cpu, const Memoria_t *mem);
+
+// Carga los registros de un contexto guardado, conservando el estado propio de la CPU
+// (interrupcion pendiente, modo debug y contadores de la TLB). Vacia la TLB.
+void cpu_cargar_contexto(CPU_t *cpu, const CPU_t *contexto);
+
+// Invalida todas las entradas de la TLB
+void cpu_tlb_vaciar(CPU_t *cpu);
+
+// Invalida la entrada de la TLB de una pagina (cambio su marco)
+void cpu_tlb_invalidar(CPU_t *cpu, int pagina);
 
 // Ciclo de instruccion
-void cpu_ciclo_instruccion(CPU_t *cpu, palabra_t *memoria, ControladorDMA_t *dma);
+void cpu_ciclo_instruccion(CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma);
+
+// Ejecuta hasta max_ciclos ciclos de instruccion seguidos con el motor de despacho
+// elegido al compilar (switch o hilado). Se detiene antes si queda una interrupcion
+// pendiente. Retorna la cantidad de ciclos consumidos y acumula los despachos en est.
+int cpu_ejecutar_rafaga(CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma, int max_ciclos, EstadisticasCPU_t *est);
 
 // Fase de busqueda
-void cpu_busqueda(CPU_t *cpu, palabra_t *memoria);
+void cpu_busqueda(CPU_t *cpu, Memoria_t *mem);
 
 // Fase de decodificacion
 Instruccion_t cpu_decodificar_instruccion(palabra_t instruccion_raw);
 
 // Fase de ejecucion
-void cpu_ejecutar(CPU_t *cpu, Instruccion_t inst, palabra_t *memoria, ControladorDMA_t *dma);
+void cpu_ejecutar(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem, ControladorDMA_t *dma);
+
+// Detecta si la secuencia que comienza en seq[0] forma una superinstruccion.
+// disponibles es la cantidad de instrucciones cargadas a partir de seq[0].
+int cpu_detectar_fusion(const Instruccion_t *seq, int disponibles);
+
+// Manejador de una sola instruccion, sin despacho. Nunca retorna NULL: los codigos
+// fuera de rango reciben el manejador de instruccion invalida
+typedef void (*ManejadorInstruccion_t)(CPU_t *cpu, const Instruccion_t *inst, Memoria_t *mem, ControladorDMA_t *dma);
+ManejadorInstruccion_t cpu_manejador_instruccion(int codigo_op);
+
+// Perfil de ejecucion (comando "perfil"). Desactivado, cada instruccion solo paga una
+// comparacion con perfil_cpu.activo. Activado, cada instruccion incrementa sus contadores
+// y en promedio una de cada PERFIL_PERIODO_MUESTREO se cronometra en el host con
+// clock_gettime. El intervalo entre muestras varia para no sincronizarse con los bucles.
+#define PERFIL_PERIODO_MUESTREO 64
+
+// Clases de opcodes para el tiempo del host
+#define CLASE_ARITMETICA 0  // sum, res, mult, divi
+#define CLASE_MEMORIA 1     // load, str
+#define CLASE_REGISTROS 2   // loadrx/strrx, loadrb/strrb, loadrl/strrl, loadsp/strsp
+#define CLASE_SALTOS 3      // comp, jmpe, jmpne, jmplt, jmpgt, j
+#define CLASE_PILA 4        // psh, pop, retrn
+#define CLASE_SISTEMA 5     // svc, hab, dhab, tti, chmod y codigos invalidos
+#define CLASE_DMA 6         // sdmap, sdmac, sdmas, sdmaio, sdmam, sdmaon
+#define CANT_CLASES 7
+
+typedef struct {
+    int activo;
+    long por_opcode[CANT_OPCODES + 1];  // La ultima posicion cuenta los codigos invalidos
+    long por_direccionamiento[4];       // Directo, inmediato, indexado y otros digitos
+    long interrupciones[CANT_INTERRUPCIONES];             // Interrupciones lanzadas por codigo
+    long muestras[CANT_CLASES];         // Despachos cronometrados por clase
+    long long ns[CANT_CLASES];          // Nanosegundos del host acumulados en esas muestras
+    int hasta_muestra;                  // Despachos que faltan para la proxima muestra
+    int clase_muestra;                  // Clase de la muestra en curso (-1: ninguna)
+    long long inicio_muestra;
+    unsigned int semilla;               // Generador del intervalo entre muestras
+} PerfilCPU_t;
+
+// Cada hilo cuenta en su propia copia; los nucleos del modo SMP suman la suya a la del
+// hilo principal al terminar con cpu_perfil_acumular
+extern __thread PerfilCPU_t perfil_cpu;
+
+// Pone los contadores en cero sin cambiar si el perfil esta activo
+void cpu_perfil_reiniciar(void);
+
+// Suma los contadores de origen en destino
+void cpu_perfil_acumular(PerfilCPU_t *destino, const PerfilCPU_t *origen);
+
+// Cuenta una instruccion ejecutada (el JIT la usa para los bloques nativos)
+void cpu_perfil_contar(const Instruccion_t *inst);
+
+// Nombres para mostrar el perfil
+const char *cpu_nombre_opcode(int codigo_op);
+const char *cpu_nombre_clase(int clase);
 
 // Calcula direccion efectiva
 int cpu_calcular_direccion(CPU_t *cpu, Instruccion_t inst);
 
 // Obtiene operando segun modo de direccionamiento
-palabra_t cpu_obtener_operando(CPU_t *cpu, Instruccion_t inst, palabra_t *memoria);
+palabra_t cpu_obtener_operando(CPU_t *cpu, Instruccion_t inst, Memoria_t *mem);
 
 // Salta a la direccion indicada
 void cpu_saltar(CPU_t *cpu, int direccion_destino_relativa);
@@ -44,9 +157,9 @@ palabra_t cpu_psw_a_palabra(PSW_t psw);
 PSW_t cpu_palabra_a_psw(palabra_t palabra);
 
 // Salvaguarda registros en pila
-void cpu_salvar_contexto(CPU_t *cpu, palabra_t *memoria);
+void cpu_salvar_contexto(CPU_t *cpu, Memoria_t *mem);
 
 // Restaura registros desde pila
-void cpu_restaurar_contexto(CPU_t *cpu, palabra_t *memoria);
+void cpu_restaurar_contexto(CPU_t *cpu, Memoria_t *mem);
 
 #endif
\ No newline at end of file
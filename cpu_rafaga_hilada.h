@@ -0,0 +1,93 @@
+// Plantilla del motor hilado (direct threading). No tiene guardas: cpu.c la incluye una
+// vez por modo definiendo antes CPU_RAFAGA_HILADA_NOMBRE y CPU_RAFAGA_HILADA_MODO.
+//
+// Cada manejador termina buscando la siguiente instruccion predecodificada y salta
+// directamente a su etiqueta con goto computado, asi cada opcode tiene su propio salto
+// indirecto en lugar de un unico switch central.
+
+static int CPU_RAFAGA_HILADA_NOMBRE(CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma, int max_ciclos, EstadisticasCPU_t *est) {
+    static void *const tabla_despacho[CANT_OPCODES] = {
+        &&op_sum, &&op_res, &&op_mult, &&op_divi, &&op_load, &&op_str, &&op_loadrx, &&op_strrx,
+        &&op_comp, &&op_jmpe, &&op_jmpne, &&op_jmplt, &&op_jmpgt, &&op_svc, &&op_retrn, &&op_hab,
+        &&op_dhab, &&op_tti, &&op_chmod, &&op_loadrb, &&op_strrb, &&op_loadrl, &&op_strrl, &&op_loadsp,
+        &&op_strsp, &&op_psh, &&op_pop, &&op_j, &&op_dma_registro, &&op_dma_registro, &&op_dma_registro,
+        &&op_dma_registro, &&op_dma_registro, &&op_sdmaon
+    };
+    static void *const tabla_fusion[CANT_FUSIONES] = {
+        [FUSION_LOADI_PSH] = &&fus_loadi_psh, [FUSION_LOAD_ARIT_STR] = &&fus_load_arit_str,
+        [FUSION_COMP_SALTO] = &&fus_comp_salto, [FUSION_PSH_SALTO] = &&fus_psh_salto
+    };
+    const int modo = CPU_RAFAGA_HILADA_MODO;
+    int ciclos = 0;
+    int tipo;
+    Instruccion_t inst;
+
+// Busqueda + decodificacion + salto al manejador, replicado al final de cada manejador
+#define BUSCAR_Y_DESPACHAR()                                                \
+    do {                                                                    \
+        cpu_busqueda_modo(cpu, mem, modo);                                  \
+        if (cpu->interrupciones_pendientes) { ciclos++; goto fin; }                 \
+        inst = cpu_instruccion_actual(cpu, mem);                            \
+        if (perfil_cpu.activo) cpu_perfil_iniciar(&inst);                   \
+        tipo = cpu_fusion_aplicable(cpu, mem, max_ciclos - ciclos);         \
+        if (tipo != FUSION_NINGUNA) goto *tabla_fusion[tipo];               \
+        est->despachos_simples++;                                           \
+        if ((unsigned)inst.codigo_op >= CANT_OPCODES) goto op_invalida;     \
+        goto *tabla_despacho[inst.codigo_op];                               \
+    } while (0)
+
+#define SIGUIENTE()                                                         \
+    do {                                                                    \
+        ciclos++;                                                           \
+        if (perfil_cpu.activo) cpu_perfil_terminar();                       \
+        if (CPU_RAFAGA_DEBE_PARAR(cpu, mem, ciclos, max_ciclos)) goto fin;       \
+        BUSCAR_Y_DESPACHAR();                                               \
+    } while (0)
+
+    BUSCAR_Y_DESPACHAR();
+
+op_sum:          cpu_op_aritmetica(cpu, inst, mem, 0, "SUM", modo);           SIGUIENTE();
+op_res:          cpu_op_aritmetica(cpu, inst, mem, 1, "RES", modo);           SIGUIENTE();
+op_mult:         cpu_op_aritmetica(cpu, inst, mem, 2, "MULT", modo);          SIGUIENTE();
+op_divi:         cpu_op_divi(cpu, inst, mem, modo);                           SIGUIENTE();
+op_load:         cpu_op_load(cpu, inst, mem, modo);                           SIGUIENTE();
+op_str:          cpu_op_str(cpu, inst, mem, modo);                            SIGUIENTE();
+op_loadrx:       cpu_op_leer_registro(cpu, cpu->RX, "LOADRX");                SIGUIENTE();
+op_strrx:        cpu_op_strrx(cpu, modo);                                     SIGUIENTE();
+op_comp:         cpu_op_comp(cpu, inst, mem, modo);                           SIGUIENTE();
+op_jmpe:         cpu_op_salto_condicional(cpu, inst, mem, 9, "JMPE", modo);   SIGUIENTE();
+op_jmpne:        cpu_op_salto_condicional(cpu, inst, mem, 10, "JMPNE", modo); SIGUIENTE();
+op_jmplt:        cpu_op_salto_condicional(cpu, inst, mem, 11, "JMPLT", modo); SIGUIENTE();
+op_jmpgt:        cpu_op_salto_condicional(cpu, inst, mem, 12, "JMPGT", modo); SIGUIENTE();
+op_svc:          cpu_op_svc(cpu);                                             SIGUIENTE();
+op_retrn:        cpu_op_retrn(cpu, mem, modo);                                SIGUIENTE();
+op_hab:          cpu_op_hab(cpu, modo);                                       SIGUIENTE();
+op_dhab:         cpu_op_dhab(cpu, modo);                                      SIGUIENTE();
+op_tti:          cpu_op_tti(cpu, inst, modo);                                 SIGUIENTE();
+op_chmod:        cpu_op_chmod(cpu, inst, modo);        ciclos++;              goto fin; // Puede cambiar de modo
+op_loadrb:       cpu_op_leer_registro(cpu, cpu->RB, "LOADRB");                SIGUIENTE();
+op_strrb:        cpu_op_strrb(cpu, modo);                                     SIGUIENTE();
+op_loadrl:       cpu_op_leer_registro(cpu, cpu->RL, "LOADRL");                SIGUIENTE();
+op_strrl:        cpu_op_strrl(cpu, modo);                                     SIGUIENTE();
+op_loadsp:       cpu_op_leer_registro(cpu, cpu->SP, "LOADSP");                SIGUIENTE();
+op_strsp:        cpu_op_strsp(cpu, modo);                                     SIGUIENTE();
+op_psh:          cpu_op_psh(cpu, mem, modo);                                  SIGUIENTE();
+op_pop:          cpu_op_pop(cpu, mem, modo);                                  SIGUIENTE();
+op_j:            cpu_op_j(cpu, inst, mem, modo);                              SIGUIENTE();
+op_dma_registro: cpu_op_dma_registro(cpu, inst, dma, modo);                   SIGUIENTE();
+op_sdmaon:       cpu_op_sdmaon(cpu, dma, modo);                               SIGUIENTE();
+op_invalida:     cpu_op_invalida(cpu, inst);                                  SIGUIENTE();
+
+// Superinstrucciones: SIGUIENTE() suma el ultimo ciclo de la secuencia
+fus_loadi_psh:     ciclos += cpu_fusion_loadi_psh(cpu, inst, mem, modo) - 1;     est->despachos_fusionados++; SIGUIENTE();
+fus_load_arit_str: ciclos += cpu_fusion_load_arit_str(cpu, inst, mem, modo) - 1; est->despachos_fusionados++; SIGUIENTE();
+fus_comp_salto:    ciclos += cpu_fusion_comp_salto(cpu, inst, mem, modo) - 1;    est->despachos_fusionados++; SIGUIENTE();
+fus_psh_salto:     ciclos += cpu_fusion_psh_salto(cpu, inst, mem, modo) - 1;     est->despachos_fusionados++; SIGUIENTE();
+
+#undef SIGUIENTE
+#undef BUSCAR_Y_DESPACHAR
+
+fin:
+    if (perfil_cpu.activo) cpu_perfil_terminar(); // CHMOD sale sin pasar por SIGUIENTE()
+    return ciclos;
+}
@@ -7,21 +7,19 @@
 
 void disco_inicializar(SimuladorDisco_t *disco) {
     disco->cantidad_programas = 0;
-    for (int i = 0; i < MAX_PROCESOS; i++) {
+    for (int i = 0; i < MAX_PROGRAMAS; i++) {
         disco->sectores[i].ocupado = 0;
         disco->sectores[i].cant_palabras = 0;
         memset(disco->sectores[i].nombre_programa, 0, 50);
     }
-    log_mensaje("Disco inicializado");
+    LOG_INFO(LOG_CAT_DMA, "Disco inicializado");
 }
 
 int disco_cargar_programa(SimuladorDisco_t *disco, const char *archivo, int *cant_palabras) {
     // Verificar si ya está en caché del disco
-    for (int i = 0; i < MAX_PROCESOS; i++) {
+    for (int i = 0; i < MAX_PROGRAMAS; i++) {
         if (disco->sectores[i].ocupado && strcmp(disco->sectores[i].nombre_programa, archivo) == 0) {
-            char msg[200];
-            sprintf(msg, "Programa %s cargado desde cache de disco.", archivo);
-            log_mensaje(msg);
+            LOG_INFO(LOG_CAT_DMA, "Programa %s cargado desde cache de disco.", archivo);
             if (cant_palabras) *cant_palabras = disco->sectores[i].cant_palabras;
             return i;
         }
@@ -29,7 +27,7 @@ int disco_cargar_programa(SimuladorDisco_t *disco, const char *archivo, int *can
 
     // Buscar espacio libre
     int indice_libre = -1;
-    for (int i = 0; i < MAX_PROCESOS; i++) {
+    for (int i = 0; i < MAX_PROGRAMAS; i++) {
         if (!disco->sectores[i].ocupado) {
             indice_libre = i;
             break;
@@ -37,14 +35,14 @@ int disco_cargar_programa(SimuladorDisco_t *disco, const char *archivo, int *can
     }
 
     if (indice_libre == -1) {
-        log_error("Disco lleno, no se pueden almacenar mas programas", 0);
+        log_error(LOG_CAT_DMA, "Disco lleno, no se pueden almacenar mas programas", 0);
         return -1;
     }
 
     // Leer el archivo local
     FILE *fp = fopen(archivo, "r");
     if (!fp) {
-        log_error("No se pudo abrir archivo para cargar al disco", 0);
+        log_error(LOG_CAT_DMA, "No se pudo abrir archivo para cargar al disco", 0);
         return -1;
     }
 
@@ -78,7 +76,7 @@ int disco_cargar_programa(SimuladorDisco_t *disco, const char *archivo, int *can
             palabra_t instruccion = (palabra_t)strtol(ptr, NULL, 10);
 
             if (sector->cant_palabras >= MAX_CODE_SIZE) {
-                log_error("Programa excede el limite del sector de disco", MAX_CODE_SIZE);
+                log_error(LOG_CAT_DMA, "Programa excede el limite del sector de disco", MAX_CODE_SIZE);
                 fclose(fp);
                 sector->ocupado = 0;
                 return -1;
@@ -92,16 +90,14 @@ int disco_cargar_programa(SimuladorDisco_t *disco, const char *archivo, int *can
     sector->ocupado = 1;
     disco->cantidad_programas++;
 
-    char msg[256];
-    sprintf(msg, "Programa '%s' cargado al disco (Sector: %d, Palabras: %d)", archivo, indice_libre, sector->cant_palabras);
-    log_mensaje(msg);
+    LOG_INFO(LOG_CAT_DMA, "Programa '%s' cargado al disco (Sector: %d, Palabras: %d)", archivo, indice_libre, sector->cant_palabras);
 
     if (cant_palabras) *cant_palabras = sector->cant_palabras;
     return indice_libre;
 }
 
 int disco_leer_programa(SimuladorDisco_t *disco, int indice_sector, palabra_t *buffer, int *cant_palabras) {
-    if (indice_sector < 0 || indice_sector >= MAX_PROCESOS || !disco->sectores[indice_sector].ocupado) {
+    if (indice_sector < 0 || indice_sector >= MAX_PROGRAMAS || !disco->sectores[indice_sector].ocupado) {
         return -1;
     }
 
@@ -5,6 +5,7 @@
 
 // Abstracción simplificada del disco para almacenar los programas
 #define MAX_CODE_SIZE 500
+#define MAX_PROGRAMAS 20 // Programas distintos en la cache del disco
 
 typedef struct {
     int ocupado;
@@ -14,7 +15,7 @@ typedef struct {
 } SectorDisco_t;
 
 typedef struct {
-    SectorDisco_t sectores[MAX_PROCESOS];
+    SectorDisco_t sectores[MAX_PROGRAMAS];
     int cantidad_programas;
 } SimuladorDisco_t;
 
@@ -1,11 +1,12 @@
 #include "dma.h"
+#include "cpu.h"
 #include "interrupciones.h"
 #include "logger.h"
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
-void dma_inicializar(ControladorDMA_t *controlador_dma, palabra_t *memoria, pthread_mutex_t *mutex_bus) {
+void dma_inicializar(ControladorDMA_t *controlador_dma, Memoria_t *memoria, pthread_rwlock_t *cerrojo_bus) {
     //Inicializacion de registros 
     controlador_dma->dma.pista = 0;
     controlador_dma->dma.cilindro = 0;
@@ -15,64 +16,57 @@ void dma_inicializar(ControladorDMA_t *controlador_dma, palabra_t *memoria, pthr
     controlador_dma->dma.estado = DMA_EXITO;             //Estado inicial
     controlador_dma->dma.activo = 0;
     controlador_dma->memoria = memoria;                  //Guarda la direccion de memoria dentro de la estructura del DMA
-    controlador_dma->mutex_bus = mutex_bus;
+    controlador_dma->cerrojo_bus = cerrojo_bus;
+    controlador_dma->cpu_destino = NULL;
+    controlador_dma->log = NULL;
     controlador_dma->ejecutando = 0;
     
     // Simula un disco duro nuevo 
     memset(&controlador_dma->disco, 0, sizeof(Disco_t));
     
-    log_mensaje("DMA y Disco inicializados");   //Escribe en el archivo de registro que el componente se inicio correctamente.
+    LOG_INFO(LOG_CAT_DMA, "DMA y Disco inicializados");   //Escribe en el archivo de registro que el componente se inicio correctamente.
 }
 
 //Esta funcion se encarga de seleccionar en que anillo del disco se va a leer o escribir.
 void dma_set_pista(ControladorDMA_t *controlador_dma, int pista) {
     controlador_dma->dma.pista = pista;
-    char msg[100];
-    sprintf(msg, "DMA: Pista establecida = %d", pista);
-    log_mensaje(msg);
+    LOG_DEBUG(LOG_CAT_DMA, "DMA: Pista establecida = %d", pista);
 }
 //Esta funcion selecciona el cilindro
 void dma_set_cilindro(ControladorDMA_t *controlador_dma, int cilindro) {
     controlador_dma->dma.cilindro = cilindro;            //Guarda el valor del cilindro en la estructura interna.
-    char msg[100];
-    sprintf(msg, "DMA: Cilindro establecido = %d", cilindro);  
-    log_mensaje(msg);
+    LOG_DEBUG(LOG_CAT_DMA, "DMA: Cilindro establecido = %d", cilindro);
 }
 //Esta funcion especifica dentro de la pista donde esta el dato.
 void dma_set_sector(ControladorDMA_t *controlador_dma, int sector) {
     controlador_dma->dma.sector = sector;
-    char msg[100];
-    sprintf(msg, "DMA: Sector establecido = %d", sector);
-    log_mensaje(msg);
+    LOG_DEBUG(LOG_CAT_DMA, "DMA: Sector establecido = %d", sector);
 }
 //Indica al DMA si debe sacar datos del disco o escribir en el 
 void dma_set_operacion(ControladorDMA_t *controlador_dma, int operacion) {
     controlador_dma->dma.operacion = operacion;
-    char msg[100];
-    sprintf(msg, "DMA: Operacion establecida = %s", 
-            operacion == DMA_LEER ? "LEER" : "ESCRIBIR");
-    log_mensaje(msg);
+    LOG_DEBUG(LOG_CAT_DMA, "DMA: Operacion establecida = %s",
+              operacion == DMA_LEER ? "LEER" : "ESCRIBIR");
 }
 //Guarda la direccion de memoria fisica donde se va a realizar la transferencia.
 void dma_set_direccion(ControladorDMA_t *controlador_dma, int direccion) {
     controlador_dma->dma.dir_memoria = direccion;
-    char msg[100];
-    sprintf(msg, "DMA: Direccion memoria = %d", direccion);
-    log_mensaje(msg);
+    LOG_DEBUG(LOG_CAT_DMA, "DMA: Direccion memoria = %d", direccion);
 }
 
 void* dma_thread_func(void *arg) {
     ControladorDMA_t *controlador_dma = (ControladorDMA_t*)arg;
+    log_usar(controlador_dma->log);
     
-    log_mensaje("DMA: Iniciando operacion de E/S");
+    LOG_DEBUG(LOG_CAT_DMA, "DMA: Iniciando operacion de E/S");
     
-    // Validar parametros
-    if (controlador_dma->dma.pista >= DISCO_PISTAS || 
+    // Validar parametros (las pistas de intercambio son del SO)
+    if (controlador_dma->dma.pista >= DISCO_PISTA_INTERCAMBIO || 
         controlador_dma->dma.cilindro >= DISCO_CILINDROS ||
         controlador_dma->dma.sector >= DISCO_SECTORES) {
         controlador_dma->dma.estado = DMA_ERROR;
-        log_error("DMA: Parametros de disco invalidos", 0);
-        lanzar_interrupcion(INT_IO_FINALIZADA);
+        log_error(LOG_CAT_DMA, "DMA: Parametros de disco invalidos", 0);
+        lanzar_interrupcion(controlador_dma->cpu_destino, INT_IO_FINALIZADA);
         controlador_dma->dma.activo = 0;
         return NULL;
     }
@@ -81,7 +75,7 @@ void* dma_thread_func(void *arg) {
     usleep(100000); // 100ms
     
     // Arbitraje del bus
-    pthread_mutex_lock(controlador_dma->mutex_bus);
+    pthread_rwlock_wrlock(controlador_dma->cerrojo_bus);
     
     if (controlador_dma->dma.operacion == DMA_LEER) {
         // Leer del disco a memoria
@@ -93,12 +87,15 @@ void* dma_thread_func(void *arg) {
         sscanf(sector_data, "%d", &dato);
 
         // Guardar en memoria RAM el dato leido del disco
-        controlador_dma->memoria[controlador_dma->dma.dir_memoria] = dato;
+        controlador_dma->memoria->datos[controlador_dma->dma.dir_memoria] = sm_a_palabra(dato);
+
+        // Si la lectura cae sobre codigo ya predecodificado, hay que descartarlo
+        memoria_invalidar_decodificada(controlador_dma->memoria, controlador_dma->dma.dir_memoria);
         
-        log_mensaje("DMA: Lectura de disco completada");
+        LOG_DEBUG(LOG_CAT_DMA, "DMA: Lectura de disco completada");
     } else {
         // Extrae el dato de memoria RAM y lo escribe en el disco
-        palabra_t dato = controlador_dma->memoria[controlador_dma->dma.dir_memoria];
+        palabra_t dato = palabra_a_sm(controlador_dma->memoria->datos[controlador_dma->dma.dir_memoria]);
 
         // Escribir en el disco
         sprintf(controlador_dma->disco.datos[controlador_dma->dma.pista]
@@ -106,39 +103,71 @@ void* dma_thread_func(void *arg) {
                                  [controlador_dma->dma.sector], 
                 "%08d", dato);
         
-        log_mensaje("DMA: Escritura a disco completada");
+        LOG_DEBUG(LOG_CAT_DMA, "DMA: Escritura a disco completada");
     }
     
-    pthread_mutex_unlock(controlador_dma->mutex_bus);
+    pthread_rwlock_unlock(controlador_dma->cerrojo_bus);
     
     // Operacion exitosa
     controlador_dma->dma.estado = DMA_EXITO;
     controlador_dma->dma.activo = 0;
     
-    // Lanzar interrupcion de finalizacion
-    lanzar_interrupcion(INT_IO_FINALIZADA);
+    // Lanzar interrupcion de finalizacion en el nucleo que inicio la operacion
+    lanzar_interrupcion(controlador_dma->cpu_destino, INT_IO_FINALIZADA);
     
     return NULL;
 }
 
-void dma_iniciar(ControladorDMA_t *controlador_dma) {
+int dma_transferir_bloque(ControladorDMA_t *controlador_dma, int operacion, int dir_memoria, int sector, int cant) {
+    if (sector < 0 || cant < 0 || sector + cant > DISCO_SECTORES_INTERCAMBIO ||
+        dir_memoria < 0 || dir_memoria + cant > controlador_dma->memoria->tam_memoria) {
+        log_error(LOG_CAT_DMA, "DMA: Bloque fuera del area de intercambio", sector);
+        return DMA_ERROR;
+    }
+
+    for (int i = 0; i < cant; i++) {
+        // Sector lineal del area -> pista, cilindro y sector
+        int lineal = sector + i;
+        char *sector_data = controlador_dma->disco.datos[DISCO_PISTA_INTERCAMBIO + lineal / (DISCO_CILINDROS * DISCO_SECTORES)]
+                                                        [lineal / DISCO_SECTORES % DISCO_CILINDROS]
+                                                        [lineal % DISCO_SECTORES];
+        int direccion = dir_memoria + i;
+
+        if (operacion == DMA_LEER) {
+            palabra_t dato = 0;
+            sscanf(sector_data, "%d", &dato);
+            controlador_dma->memoria->datos[direccion] = sm_a_palabra(dato);
+            memoria_invalidar_decodificada(controlador_dma->memoria, direccion);
+        } else {
+            sprintf(sector_data, "%08d", palabra_a_sm(controlador_dma->memoria->datos[direccion]));
+        }
+    }
+
+    LOG_DEBUG(LOG_CAT_DMA, "DMA: Bloque de %d palabras %s el sector de intercambio %d", cant,
+              operacion == DMA_LEER ? "leido desde" : "escrito en", sector);
+    return DMA_EXITO;
+}
+
+void dma_iniciar(ControladorDMA_t *controlador_dma, CPU_t *cpu) {
     if (controlador_dma->dma.activo) {
-        log_error("DMA ya esta en operacion", 0);
+        log_error(LOG_CAT_DMA, "DMA ya esta en operacion", 0);
         return;
     }
     
     controlador_dma->dma.activo = 1;
     controlador_dma->ejecutando = 1;
+    controlador_dma->cpu_destino = cpu;
+    controlador_dma->log = log_actual();
     
     // Crear thread para la operacion DMA
     if (pthread_create(&controlador_dma->thread, NULL, dma_thread_func, controlador_dma) != 0) {
-        log_error("Error al crear thread DMA", 0);
+        log_error(LOG_CAT_DMA, "Error al crear thread DMA", 0);
         controlador_dma->dma.activo = 0;
         controlador_dma->ejecutando = 0;
         return;
     }
     
-    log_mensaje("DMA: Thread de E/S creado");
+    LOG_DEBUG(LOG_CAT_DMA, "DMA: Thread de E/S creado");
 }
 
 void dma_terminar(ControladorDMA_t *controlador_dma) {
@@ -2,20 +2,24 @@
 #define DMA_H
 
 #include "tipos.h"
+#include "memoria.h"
+#include "logger.h"
 #include <pthread.h>
 
 // Estructura del controlador DMA
 typedef struct {
     DMA_t dma;
     Disco_t disco;
-    palabra_t *memoria;
-    pthread_mutex_t *mutex_bus;
+    Memoria_t *memoria;
+    pthread_rwlock_t *cerrojo_bus;       // El DMA lo toma como escritor (excluye a las CPUs)
     pthread_t thread;
     int ejecutando;
+    CPU_t *cpu_destino;                  // CPU que recibe la interrupcion de fin de E/S
+    Logger_t *log;                       // Log de la instancia que inicio la operacion
 } ControladorDMA_t;
 
 // Inicializa el DMA
-void dma_inicializar(ControladorDMA_t *ctrl, palabra_t *memoria, pthread_mutex_t *mutex_bus);
+void dma_inicializar(ControladorDMA_t *ctrl, Memoria_t *memoria, pthread_rwlock_t *cerrojo_bus);
 
 // Establece parametros del DMA
 void dma_set_pista(ControladorDMA_t *ctrl, int pista);
@@ -24,8 +28,14 @@ void dma_set_sector(ControladorDMA_t *ctrl, int sector);
 void dma_set_operacion(ControladorDMA_t *ctrl, int operacion);
 void dma_set_direccion(ControladorDMA_t *ctrl, int direccion);
 
-// Inicia operacion DMA
-void dma_iniciar(ControladorDMA_t *ctrl);
+// Inicia operacion DMA; al terminar interrumpe a la CPU que la inicio
+void dma_iniciar(ControladorDMA_t *ctrl, CPU_t *cpu);
+
+// Copia cant palabras entre la memoria (desde dir_memoria) y los sectores consecutivos del
+// area de intercambio que empiezan en 'sector', con el mismo formato que una operacion del
+// thread DMA pero sin su demora ni su interrupcion (la usa el intercambio de procesos).
+// Quien llama debe tener el bus. Retorna DMA_EXITO o DMA_ERROR si se sale del area.
+int dma_transferir_bloque(ControladorDMA_t *ctrl, int operacion, int dir_memoria, int sector, int cant);
 
 // Funcion del thread DMA
 void* dma_thread_func(void *arg);
@@ -0,0 +1,241 @@
+#include "granja.h"
+#include "sistema.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// Una simulacion del archivo de trabajos
+typedef struct {
+    char *comandos;     // Linea del archivo, comandos separados por ';'
+    char *resumen;      // Linea JSON de sistema_imprimir_totales (NULL si no se ejecuto)
+    int fallo;          // Algun comando fallo o algun proceso fue abortado
+    double segundos;    // Tiempo de host de la simulacion completa
+} TrabajoGranja_t;
+
+typedef struct {
+    TrabajoGranja_t *trabajos;
+    int cant_trabajos;
+    int siguiente;              // Proximo trabajo sin asignar
+    pthread_mutex_t mutex;      // Protege siguiente
+    const char *dir_logs;
+} Granja_t;
+
+static double granja_reloj(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+//------------------------------------------------------ARCHIVO DE TRABAJOS-------------------------------------------------------------------------------------------
+
+// Lee una simulacion por linea. Retorna la cantidad o -1 si no se pudo abrir
+static int granja_leer_trabajos(const char *archivo, TrabajoGranja_t **trabajos) {
+    FILE *f = fopen(archivo, "r");
+    if (!f) return -1;
+
+    int capacidad = 64, cantidad = 0;
+    *trabajos = malloc(capacidad * sizeof(TrabajoGranja_t));
+
+    char linea[TAM_LINEA_COMANDO];
+    while (fgets(linea, sizeof(linea), f) != NULL) {
+        linea[strcspn(linea, "#\r\n")] = 0;
+        if (strspn(linea, " \t;") == strlen(linea)) continue; // Linea sin comandos
+
+        if (cantidad == capacidad) {
+            capacidad *= 2;
+            *trabajos = realloc(*trabajos, capacidad * sizeof(TrabajoGranja_t));
+        }
+        TrabajoGranja_t *t = &(*trabajos)[cantidad++];
+        t->comandos = strdup(linea);
+        t->resumen = NULL;
+        t->fallo = 0;
+        t->segundos = 0.0;
+    }
+    fclose(f);
+    return cantidad;
+}
+
+//------------------------------------------------------SIMULACIONES------------------------------------------------------------------------------------------------
+
+// Ejecuta la simulacion i en una instancia nueva del sistema
+static void granja_simular(Granja_t *granja, int i) {
+    TrabajoGranja_t *t = &granja->trabajos[i];
+    double inicio = granja_reloj();
+
+    Sistema_t *sys = malloc(sizeof(Sistema_t));
+    if (!sys) {
+        t->fallo = 1;
+        return;
+    }
+
+    char ruta_log[512];
+    if (granja->dir_logs) {
+        snprintf(ruta_log, sizeof(ruta_log), "%s/sim_%d.log", granja->dir_logs, i + 1);
+    }
+    if (sistema_inicializar(sys, granja->dir_logs ? ruta_log : NULL) != 0) {
+        free(sys);
+        t->fallo = 1;
+        return;
+    }
+
+    char linea[TAM_LINEA_COMANDO];
+    snprintf(linea, sizeof(linea), "%s", t->comandos);
+
+    char *resto;
+    for (char *comando = strtok_r(linea, ";", &resto); comando != NULL; comando = strtok_r(NULL, ";", &resto)) {
+        int r = sistema_ejecutar_comando(sys, comando);
+        if (r == CONSOLA_ERROR) t->fallo = 1;
+        if (r == CONSOLA_APAGAR) break;
+    }
+    if (sys->totales.procesos_abortados > 0) t->fallo = 1;
+
+    size_t largo = 0;
+    FILE *resumen = open_memstream(&t->resumen, &largo);
+    if (resumen) {
+        sistema_imprimir_totales(sys, resumen);
+        fclose(resumen);
+        t->resumen[strcspn(t->resumen, "\n")] = 0;
+    }
+
+    sistema_limpiar(sys);
+    free(sys);
+    t->segundos = granja_reloj() - inicio;
+}
+
+// Hilo del conjunto: toma simulaciones hasta que no queden
+static void *granja_trabajador(void *arg) {
+    Granja_t *granja = (Granja_t *)arg;
+
+    while (1) {
+        pthread_mutex_lock(&granja->mutex);
+        int i = granja->siguiente++;
+        pthread_mutex_unlock(&granja->mutex);
+
+        if (i >= granja->cant_trabajos) break;
+        granja_simular(granja, i);
+    }
+    return NULL;
+}
+
+//------------------------------------------------------REPORTE-----------------------------------------------------------------------------------------------------
+
+// Cadena JSON con comillas y barras escapadas
+static void granja_escribir_cadena(FILE *salida, const char *cadena) {
+    fputc('"', salida);
+    for (const char *c = cadena; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', salida);
+        if (*c == '\t') {
+            fputs("\\t", salida);
+            continue;
+        }
+        fputc(*c, salida);
+    }
+    fputc('"', salida);
+}
+
+static void granja_escribir_reporte(Granja_t *granja, int cant_hilos, int fallidas, double segundos, FILE *reporte) {
+    fprintf(reporte, "{\n");
+    fprintf(reporte, "  \"simulaciones\": %d,\n", granja->cant_trabajos);
+    fprintf(reporte, "  \"hilos\": %d,\n", cant_hilos);
+    fprintf(reporte, "  \"fallidas\": %d,\n", fallidas);
+    fprintf(reporte, "  \"segundos\": %.6f,\n", segundos);
+    fprintf(reporte, "  \"resultados\": [");
+
+    for (int i = 0; i < granja->cant_trabajos; i++) {
+        TrabajoGranja_t *t = &granja->trabajos[i];
+        fprintf(reporte, "%s\n    {\"id\": %d, \"comandos\": ", i > 0 ? "," : "", i + 1);
+        granja_escribir_cadena(reporte, t->comandos);
+        if (granja->dir_logs) {
+            fprintf(reporte, ", \"log\": \"%s/sim_%d.log\"", granja->dir_logs, i + 1);
+        }
+        fprintf(reporte, ", \"fallo\": %d, \"segundos_host\": %.6f,\n     \"resumen\": %s}",
+                t->fallo, t->segundos, t->resumen ? t->resumen : "null");
+    }
+    fprintf(reporte, "\n  ]\n}\n");
+}
+
+//------------------------------------------------------EJECUCION---------------------------------------------------------------------------------------------------
+
+int granja_ejecutar(const char *archivo_trabajos, int cant_hilos, const char *dir_logs, FILE *reporte) {
+    Granja_t granja;
+    granja.cant_trabajos = granja_leer_trabajos(archivo_trabajos, &granja.trabajos);
+    if (granja.cant_trabajos < 0) {
+        fprintf(stderr, "Error: No se pudo abrir el archivo de trabajos %s\n", archivo_trabajos);
+        return GRANJA_ERROR;
+    }
+    granja.siguiente = 0;
+    granja.dir_logs = dir_logs;
+    pthread_mutex_init(&granja.mutex, NULL);
+
+    if (dir_logs && mkdir(dir_logs, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Aviso: No se pudo crear %s, las simulaciones no tendran log\n", dir_logs);
+        granja.dir_logs = NULL;
+    }
+
+    if (cant_hilos < 1) cant_hilos = 1;
+    if (cant_hilos > GRANJA_MAX_HILOS) cant_hilos = GRANJA_MAX_HILOS;
+    if (cant_hilos > granja.cant_trabajos) cant_hilos = granja.cant_trabajos > 0 ? granja.cant_trabajos : 1;
+
+    // Las simulaciones imprimen por consola desde varios hilos a la vez: su salida se
+    // descarta y leen EOF si piden entrada. Se restauran antes de escribir el reporte.
+    fflush(stdout);
+    int salida_original = dup(STDOUT_FILENO);
+    int entrada_original = dup(STDIN_FILENO);
+    int nulo = open("/dev/null", O_RDWR);
+    if (nulo >= 0) {
+        dup2(nulo, STDOUT_FILENO);
+        dup2(nulo, STDIN_FILENO);
+        close(nulo);
+    }
+
+    double inicio = granja_reloj();
+    pthread_t hilos[GRANJA_MAX_HILOS];
+    int creados = 0;
+    for (int i = 0; i < cant_hilos; i++) {
+        if (pthread_create(&hilos[i], NULL, granja_trabajador, &granja) != 0) break;
+        creados++;
+    }
+    if (creados == 0) {
+        granja_trabajador(&granja); // Sin hilos: se simula todo en este
+    }
+    for (int i = 0; i < creados; i++) {
+        pthread_join(hilos[i], NULL);
+    }
+    double segundos = granja_reloj() - inicio;
+
+    fflush(stdout);
+    if (salida_original >= 0) {
+        dup2(salida_original, STDOUT_FILENO);
+        close(salida_original);
+    }
+    if (entrada_original >= 0) {
+        dup2(entrada_original, STDIN_FILENO);
+        close(entrada_original);
+    }
+    clearerr(stdin);
+
+    int fallidas = 0;
+    for (int i = 0; i < granja.cant_trabajos; i++) {
+        if (granja.trabajos[i].fallo) fallidas++;
+    }
+
+    granja_escribir_reporte(&granja, creados > 0 ? creados : 1, fallidas, segundos, reporte);
+    fprintf(stderr, "Granja: %d simulaciones en %d hilos, %d fallidas (%.3f s)\n",
+            granja.cant_trabajos, creados > 0 ? creados : 1, fallidas, segundos);
+
+    for (int i = 0; i < granja.cant_trabajos; i++) {
+        free(granja.trabajos[i].comandos);
+        free(granja.trabajos[i].resumen);
+    }
+    free(granja.trabajos);
+    pthread_mutex_destroy(&granja.mutex);
+
+    return fallidas > 0 ? GRANJA_FALLO : GRANJA_OK;
+}
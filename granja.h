@@ -0,0 +1,24 @@
+#ifndef GRANJA_H
+#define GRANJA_H
+
+#include <stdio.h>
+
+// Granja de simulaciones: ejecuta muchas instancias independientes del sistema en
+// paralelo sobre un conjunto de hilos del host. Cada linea del archivo de trabajos es
+// una simulacion: comandos de consola separados por ';' ('#' inicia un comentario).
+// Cada simulacion tiene su propio Sistema_t y su propio log (<dir_logs>/sim_<n>.log).
+// La salida de consola de las simulaciones se descarta; al terminar se escribe en
+// reporte un unico JSON con el resumen de cada una.
+
+#define GRANJA_MAX_HILOS 64
+#define GRANJA_DIR_LOGS "granja_logs"
+
+// Codigos de retorno de granja_ejecutar
+#define GRANJA_OK 0          // Todas las simulaciones terminaron sin errores
+#define GRANJA_FALLO 1       // Algun comando fallo o algun proceso fue abortado
+#define GRANJA_ERROR -1      // No se pudo leer el archivo de trabajos
+
+// Ejecuta las simulaciones del archivo de trabajos con cant_hilos hilos
+int granja_ejecutar(const char *archivo_trabajos, int cant_hilos, const char *dir_logs, FILE *reporte);
+
+#endif
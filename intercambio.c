@@ -0,0 +1,204 @@
+#include "sistema.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Intercambio de procesos (swapping, comando "intercambio").
+// Cuando no hay un hueco para un proceso nuevo se lleva al disco el bloque entero de una
+// victima LISTO o DORMIDO (codigo, datos y pila) por el camino del DMA, y se devuelve su
+// espacio a la lista de huecos. El proceso sigue en su cola o dormido; al despacharlo se
+// trae de vuelta a la misma base, porque CALL y el salvado de contexto apilan el PC y RX
+// como direcciones fisicas.
+
+static const char *nombres_intercambio[] = {"desactivado", "lru", "sueno"};
+
+const char *sistema_nombre_intercambio(int politica) {
+    return nombres_intercambio[politica];
+}
+
+static double intercambio_segundos(const struct timespec *inicio) {
+    struct timespec fin;
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+    return (fin.tv_sec - inicio->tv_sec) + (fin.tv_nsec - inicio->tv_nsec) / 1e9;
+}
+
+// El bus se toma como escritor para excluir a los nucleos SMP y al hilo del DMA. Con un
+// solo nucleo el despachador corre dentro de sistema_ciclo, que ya lo tiene como lector, y
+// eso basta para excluir al DMA (el cerrojo por defecto prefiere lectores: no se bloquea).
+static void intercambio_tomar_bus(Sistema_t *sys) {
+    if (sys->cant_nucleos > 1) pthread_rwlock_wrlock(&sys->cerrojo_bus);
+    else pthread_rwlock_rdlock(&sys->cerrojo_bus);
+}
+
+//------------------------------------------------------AREA DE INTERCAMBIO-----------------------------------------------------------------------------------------
+
+// Primer ajuste sobre los sectores del area. Retorna el primer sector o -1 si no hay lugar.
+static int intercambio_reservar_sectores(Intercambio_t *area, int cant) {
+    int corrida = 0;
+    for (int s = 0; s < DISCO_SECTORES_INTERCAMBIO; s++) {
+        corrida = area->ocupado[s] ? 0 : corrida + 1;
+        if (corrida == cant) {
+            memset(&area->ocupado[s - cant + 1], 1, cant);
+            return s - cant + 1;
+        }
+    }
+    return -1;
+}
+
+static void intercambio_liberar_sectores(Intercambio_t *area, int sector, int cant) {
+    memset(&area->ocupado[sector], 0, cant);
+}
+
+//------------------------------------------------------VICTIMAS----------------------------------------------------------------------------------------------------
+
+static int intercambio_es_candidato(const BCP_t *p) {
+    return p->pid != 0 && (p->estado == LISTO || p->estado == DORMIDO) &&
+           !p->en_disco && p->contexto.paginas == NULL;
+}
+
+// Ciclos que le faltan para despertar a un proceso dormido
+static int intercambio_falta_despertar(Sistema_t *sys, const BCP_t *p) {
+    long reloj = sys->cant_nucleos > 1 ? sys->nucleos[p->nucleo].ciclos : sys->ciclos_reloj;
+    return p->ciclo_despertar - reloj;
+}
+
+// Si a es mejor victima que b segun la politica
+static int intercambio_antes(Sistema_t *sys, const BCP_t *a, const BCP_t *b) {
+    if (sys->intercambio.politica == INTERCAMBIO_SUENO) {
+        int a_duerme = a->estado == DORMIDO;
+        int b_duerme = b->estado == DORMIDO;
+        if (a_duerme != b_duerme) return a_duerme;
+        if (a_duerme) {
+            int falta_a = intercambio_falta_despertar(sys, a);
+            int falta_b = intercambio_falta_despertar(sys, b);
+            if (falta_a != falta_b) return falta_a > falta_b;
+        }
+    }
+    return a->ultimo_uso < b->ultimo_uso;
+}
+
+static int intercambio_elegir_victima(Sistema_t *sys) {
+    int victima = -1;
+    for (int i = 0; i < sys->tabla_procesos.usados; i++) {
+        BCP_t *p = sistema_bcp(sys, i);
+        if (intercambio_es_candidato(p) &&
+            (victima == -1 || intercambio_antes(sys, p, sistema_bcp(sys, victima)))) {
+            victima = i;
+        }
+    }
+    return victima;
+}
+
+//------------------------------------------------------SALIDA Y ENTRADA--------------------------------------------------------------------------------------------
+
+// Lleva al disco el bloque del proceso y libera su memoria. Retorna 0 o -1 si el area de
+// intercambio esta llena.
+static int intercambio_sacar(Sistema_t *sys, int indice) {
+    BCP_t *p = sistema_bcp(sys, indice);
+    Intercambio_t *area = &sys->intercambio;
+    struct timespec inicio;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+
+    int sector = intercambio_reservar_sectores(area, p->tam_asignado);
+    if (sector == -1) {
+        LOG_DEBUG(LOG_CAT_MEM, "Intercambio: sin lugar en el disco para el PID %d (%d pal)", p->pid, p->tam_asignado);
+        return -1;
+    }
+
+    intercambio_tomar_bus(sys);
+    dma_transferir_bloque(&sys->dma, DMA_ESCRIBIR, p->base_memoria, sector, p->tam_asignado);
+    pthread_rwlock_unlock(&sys->cerrojo_bus);
+
+    pthread_mutex_lock(&sys->mutex_memoria);
+    memoria_desalojar_espacio(&sys->memoria, p->base_memoria, p->base_memoria + p->tam_asignado - 1);
+    pthread_mutex_unlock(&sys->mutex_memoria);
+
+    p->en_disco = 1;
+    p->sector_intercambio = sector;
+    area->salidas++;
+    area->palabras_salida += p->tam_asignado;
+    if (++area->en_disco > area->pico_en_disco) area->pico_en_disco = area->en_disco;
+    area->segundos_salida += intercambio_segundos(&inicio);
+
+    LOG_INFO(LOG_CAT_MEM, "Intercambio: PID %d sale a disco (RAM[%d] a RAM[%d], sector %d)", p->pid,
+             p->base_memoria, p->base_memoria + p->tam_asignado - 1, sector);
+    return 0;
+}
+
+int sistema_asignar_con_intercambio(Sistema_t *sys, int tam_requerido, int *tam_asignado) {
+    int tope = memoria_tope_contiguo(&sys->memoria);
+    if (sys->intercambio.politica != INTERCAMBIO_NO && tam_requerido <= tope - sys->memoria.mem_so) {
+        // Cada victima devuelve su bloque (fusionado con los huecos vecinos) hasta que haya
+        // un hueco que alcance. Solo se mira la lista: el pedido se cuenta una vez, abajo.
+        pthread_mutex_lock(&sys->mutex_memoria);
+        int hay = memoria_hay_espacio(&sys->memoria, tam_requerido, tope);
+        pthread_mutex_unlock(&sys->mutex_memoria);
+        int victima;
+        while (!hay && (victima = intercambio_elegir_victima(sys)) != -1) {
+            if (intercambio_sacar(sys, victima) != 0) break;
+            pthread_mutex_lock(&sys->mutex_memoria);
+            hay = memoria_hay_espacio(&sys->memoria, tam_requerido, tope);
+            pthread_mutex_unlock(&sys->mutex_memoria);
+        }
+    }
+
+    pthread_mutex_lock(&sys->mutex_memoria);
+    int base = memoria_asignar_espacio(&sys->memoria, tam_requerido, tope, tam_asignado);
+    pthread_mutex_unlock(&sys->mutex_memoria);
+    return base;
+}
+
+int sistema_traer_de_disco(Sistema_t *sys, int indice) {
+    BCP_t *p = sistema_bcp(sys, indice);
+    Intercambio_t *area = &sys->intercambio;
+    int base = p->base_memoria;
+    int fin = base + p->tam_asignado;
+    struct timespec inicio;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+
+    pthread_mutex_lock(&sys->mutex_memoria);
+    int libre = memoria_asignar_en(&sys->memoria, base, p->tam_asignado) == 0;
+    pthread_mutex_unlock(&sys->mutex_memoria);
+
+    if (!libre) {
+        // Los residentes que pisan el rango tienen que poder salir todos; si alguno esta en
+        // ejecucion (en otro nucleo) se reintenta en otro despacho
+        for (int i = 0; i < sys->tabla_procesos.usados; i++) {
+            BCP_t *otro = sistema_bcp(sys, i);
+            if (i != indice && otro->pid != 0 && otro->estado != TERMINADO && !otro->en_disco &&
+                otro->contexto.paginas == NULL && otro->base_memoria < fin &&
+                base < otro->base_memoria + otro->tam_asignado && !intercambio_es_candidato(otro)) {
+                return -1;
+            }
+        }
+        for (int i = 0; i < sys->tabla_procesos.usados; i++) {
+            BCP_t *otro = sistema_bcp(sys, i);
+            if (i != indice && intercambio_es_candidato(otro) && otro->base_memoria < fin &&
+                base < otro->base_memoria + otro->tam_asignado && intercambio_sacar(sys, i) != 0) {
+                return -1;
+            }
+        }
+
+        // Lo que queda ocupado es de marcos de procesos paginados
+        pthread_mutex_lock(&sys->mutex_memoria);
+        libre = memoria_asignar_en(&sys->memoria, base, p->tam_asignado) == 0;
+        pthread_mutex_unlock(&sys->mutex_memoria);
+        if (!libre) return -1;
+    }
+
+    intercambio_tomar_bus(sys);
+    dma_transferir_bloque(&sys->dma, DMA_LEER, base, p->sector_intercambio, p->tam_asignado);
+    memoria_predecodificar(&sys->memoria, base, p->tamano_real - TAM_PILA);
+    pthread_rwlock_unlock(&sys->cerrojo_bus);
+
+    intercambio_liberar_sectores(area, p->sector_intercambio, p->tam_asignado);
+    p->en_disco = 0;
+    area->entradas++;
+    area->palabras_entrada += p->tam_asignado;
+    area->en_disco--;
+    area->segundos_entrada += intercambio_segundos(&inicio);
+
+    LOG_INFO(LOG_CAT_MEM, "Intercambio: PID %d vuelve del disco a RAM[%d] a RAM[%d]", p->pid, base, fin - 1);
+    return 0;
+}
@@ -3,34 +3,46 @@
 #include "logger.h"
 #include <stdio.h>
 
-int interrupcion_pendiente = 0;
-int codigo_interrupcion = 0;
-
 void interrupciones_inicializar(VectorInterrupciones_t *vec) {
     int i;
-    for (i = 0; i < 9; i++) {
+    for (i = 0; i < CANT_INTERRUPCIONES; i++) {
         vec->manejadores[i] = 0; // Direcciones por defecto
     }
-    interrupcion_pendiente = 0;
-    codigo_interrupcion = 0;
-    log_mensaje("Vector de interrupciones inicializado");
+    LOG_INFO(LOG_CAT_INT, "Vector de interrupciones inicializado");
 }
 
-void lanzar_interrupcion(int codigo) {
+void lanzar_interrupcion(CPU_t *cpu, int codigo) {
     // Verificar que el codigo de interrupcion sea valido
-    if (codigo < 0 || codigo > 8) {
-        lanzar_interrupcion(INT_COD_INVALIDO);
+    if (codigo < 0 || codigo >= CANT_INTERRUPCIONES) {
+        lanzar_interrupcion(cpu, INT_COD_INVALIDO);
         return;
     }
     
-    interrupcion_pendiente = 1;
-    codigo_interrupcion = codigo;
+    atomic_fetch_or_explicit(&cpu->interrupciones_pendientes, INT_BIT(codigo), memory_order_release);
+    if (perfil_cpu.activo) perfil_cpu.interrupciones[codigo]++;
     
-    char msg[200];
-sprintf(msg, "INTERRUPCION ARROJADA: Codigo %d - %s", 
-            codigo, obtener_nombre_interrupcion(codigo));
-    log_mensaje(msg);
-    printf("Interrupcion: %s\n", msg);
+    LOG_INFO(LOG_CAT_INT, "INTERRUPCION ARROJADA: Codigo %d - %s",
+             codigo, obtener_nombre_interrupcion(codigo));
+    printf("Interrupcion: INTERRUPCION ARROJADA: Codigo %d - %s\n",
+           codigo, obtener_nombre_interrupcion(codigo));
+}
+
+// Orden en que se atienden las interrupciones pendientes
+static const int prioridad_interrupcion[] = {
+    INT_DIR_INVALIDA, INT_FALLO_PAGINA, INT_INST_INVALIDA, INT_OVERFLOW, INT_UNDERFLOW,
+    INT_COD_INVALIDO, INT_COD_SIST_INVALIDO, INT_SYSCALL,
+    INT_IO_FINALIZADA, INT_RELOJ
+};
+
+int interrupciones_siguiente(unsigned int pendientes) {
+    for (int i = 0; i < CANT_INTERRUPCIONES; i++) {
+        if (pendientes & INT_BIT(prioridad_interrupcion[i])) return prioridad_interrupcion[i];
+    }
+    return -1;
+}
+
+void interrupciones_quitar(CPU_t *cpu, unsigned int mascara) {
+    atomic_fetch_and_explicit(&cpu->interrupciones_pendientes, ~mascara, memory_order_acq_rel);
 }
 
 const char* obtener_nombre_interrupcion(int codigo) {
@@ -53,34 +65,31 @@ const char* obtener_nombre_interrupcion(int codigo) {
             return "Underflow";
         case INT_OVERFLOW:
             return "Overflow";
+        case INT_FALLO_PAGINA:
+            return "Fallo de pagina";
         default:
             return "Interrupcion desconocida";
     }
 }
 
-void procesar_interrupcion(CPU_t *cpu, palabra_t *memoria, VectorInterrupciones_t *vec) {
-    if (!interrupcion_pendiente) {
-        return;
-    }
-    
+int procesar_interrupcion(CPU_t *cpu, Memoria_t *mem, VectorInterrupciones_t *vec, int codigo) {
     // Verificar si interrupciones estan habilitadas
     if (cpu->PSW.interrupciones == INT_DESHABILITADAS) {
         // Solo algunas interrupciones criticas se procesan
-        if (codigo_interrupcion != INT_OVERFLOW &&
-            codigo_interrupcion != INT_UNDERFLOW && 
-            codigo_interrupcion != INT_DIR_INVALIDA &&
-            codigo_interrupcion != INT_INST_INVALIDA) {
-            return; // Postponer interrupcion
+        if (codigo != INT_OVERFLOW &&
+            codigo != INT_UNDERFLOW && 
+            codigo != INT_DIR_INVALIDA &&
+            codigo != INT_FALLO_PAGINA &&
+            codigo != INT_INST_INVALIDA) {
+            return 0; // Postponer interrupcion
         }
     }
     
-    char msg[200];
-    sprintf(msg, "PROCESANDO INTERRUPCION: Codigo %d - %s", 
-            codigo_interrupcion, obtener_nombre_interrupcion(codigo_interrupcion));
-    log_mensaje(msg);
+    LOG_INFO(LOG_CAT_INT, "PROCESANDO INTERRUPCION: Codigo %d - %s",
+             codigo, obtener_nombre_interrupcion(codigo));
     
     // Guarda el estado del cpu
-    cpu_salvar_contexto(cpu, memoria);
+    cpu_salvar_contexto(cpu, mem);
     
     // Cambiar a modo kernel para manejar la interrupcion
     int modo_anterior = cpu->PSW.modo;
@@ -90,22 +99,21 @@ void procesar_interrupcion(CPU_t *cpu, palabra_t *memoria, VectorInterrupciones_
     cpu->PSW.interrupciones = INT_DESHABILITADAS;
     
     // Obtener direccion del manejador de la interrupcion
-    int dir_manejador = vec->manejadores[codigo_interrupcion];
+    int dir_manejador = vec->manejadores[codigo];
     
     if (dir_manejador > 0) {
         cpu->PSW.pc = dir_manejador;
     } else {
         // Manejador por defecto, no hace nada
-        sprintf(msg, "No hay manejador para interrupcion %d, continua la ejecucion", 
-                codigo_interrupcion);
-        log_mensaje(msg);
+        LOG_DEBUG(LOG_CAT_INT, "No hay manejador para interrupcion %d, continua la ejecucion", codigo);
     }
     
-    // Limpiar bandera de interrupcion
-    interrupcion_pendiente = 0;
+    // Quitar la interrupcion de las pendientes
+    interrupciones_quitar(cpu, INT_BIT(codigo));
     
     // Restaurar contexto
-    cpu_restaurar_contexto(cpu, memoria);
+    cpu_restaurar_contexto(cpu, mem);
     cpu->PSW.modo = modo_anterior;
     cpu->PSW.interrupciones = INT_HABILITADAS;
+    return 1;
 }
\ No newline at end of file
@@ -2,24 +2,39 @@
 #define INTERRUPCIONES_H
 
 #include "tipos.h"
+#include "memoria.h"
 
 // Vector de interrupciones
 typedef struct {
-    int manejadores[9]; // Direcciones de los manejadores
+    int manejadores[CANT_INTERRUPCIONES]; // Direcciones de los manejadores
 } VectorInterrupciones_t;
 
-// Variables globales para control de interrupciones
-extern int interrupcion_pendiente;
-extern int codigo_interrupcion;
-
 // Inicializa el vector de interrupciones
 void interrupciones_inicializar(VectorInterrupciones_t *vec);
 
-// Lanza una interrupcion
-void lanzar_interrupcion(int codigo);
+// Interrupciones pendientes de una CPU (CPU_t.interrupciones_pendientes): el bit c indica
+// que la interrupcion c esta pendiente. Se publican con un OR atomico, asi un dispositivo
+// (el DMA desde su hilo) interrumpe sin tomar el bus y ninguna se pierde aunque lleguen
+// varias antes de atenderlas. La CPU las atiende de a una en orden de prioridad.
+#define INT_BIT(codigo) (1u << (codigo))
+#define INT_MASCARA_TODAS 0x3FFu
+
+// Las que produce la instruccion en curso; las demas (reloj y E/S) llegan de afuera
+#define INT_MASCARA_SINCRONAS (INT_MASCARA_TODAS & ~(INT_BIT(INT_RELOJ) | INT_BIT(INT_IO_FINALIZADA)))
+
+// Lanza una interrupcion en la CPU indicada (cada nucleo y cada instancia tiene la suya)
+void lanzar_interrupcion(CPU_t *cpu, int codigo);
+
+// Interrupcion de mayor prioridad en la mascara, o -1 si esta vacia: primero los fallos
+// de la instruccion, despues las llamadas al sistema y al final los dispositivos
+int interrupciones_siguiente(unsigned int pendientes);
+
+// Quita de las pendientes las interrupciones de la mascara (atendidas o descartadas)
+void interrupciones_quitar(CPU_t *cpu, unsigned int mascara);
 
-// Procesa la interrupcion pendiente
-void procesar_interrupcion(CPU_t *cpu, palabra_t *memoria, VectorInterrupciones_t *vec);
+// Procesa la interrupcion indicada con el vector y la quita de las pendientes.
+// Retorna 0 si quedo pospuesta porque las interrupciones estan deshabilitadas.
+int procesar_interrupcion(CPU_t *cpu, Memoria_t *mem, VectorInterrupciones_t *vec, int codigo);
 
 // Obtiene descripcion de la interrupcion
 const char* obtener_nombre_interrupcion(int codigo);
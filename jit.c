@@ -0,0 +1,893 @@
+#include "jit.h"
+#include "interrupciones.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(CPU_JIT) && defined(__x86_64__)
+
+#include <sys/mman.h>
+
+// Un bloque basico se traduce a codigo nativo. En un bloque de modo usuario las instrucciones
+// frecuentes (LOAD, STR, SUM, RES, COMP, PSH, POP, los saltos inmediatos, RETRN y la copia de
+// un registro en el AC) se emiten en linea: operan sobre los registros de la CPU y la memoria
+// simulada con las verificaciones de RB y RL, de la pila y del desborde en el propio codigo.
+// Cuando una verificacion falla se salta al tramo frio de la instruccion, que la ejecuta
+// desde el principio con el manejador del interprete; asi las interrupciones quedan igual que
+// en el interprete. Las demas instrucciones, las de los bloques de modo kernel y todas
+// mientras el log registra cada operacion replican la fase de busqueda (MAR, MDR, IR y PC
+// como inmediatos) y llaman al manejador. El camino rapido no escribe MAR, MDR, IR ni el PC
+// de cada instruccion: se escriben en la ultima del bloque y en los tramos frios de salida.
+// Se entra desde C por el trampolin
+//     int trampolin(CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma, int presupuesto, void *bloque)
+// que deja cpu, mem y dma en rbx, r12 y r13, el presupuesto de ciclos en r14d y los ciclos
+// hechos en r15d. Al terminar, un bloque salta directo al bloque traducido de su sucesor
+// (salidas enlazadas), que repite a su entrada las verificaciones de jit_puede_entrar. Todo
+// vuelve a C por el epilogo comun, que retorna los ciclos consumidos: se sale antes si
+// queda una interrupcion pendiente, si una escritura invalido codigo traducido o si el
+// sucesor no esta traducido o no se puede entrar a el.
+
+#define JIT_BYTES_POR_INSTRUCCION 512 // Cota del codigo emitido por instruccion, con sus tramos frios
+#define JIT_BYTES_ENLACES 256         // Cota de la verificacion de entrada y las salidas del bloque
+#define JIT_SALTOS_FRIOS (JIT_MAX_BLOQUE * 10) // Saltos del bloque hacia sus tramos frios
+
+// Tramos frios de una instruccion en linea
+#define JIT_FRIO_LENTO 0        // La ejecuta con su manejador y sigue en el bloque
+#define JIT_FRIO_SALIDA 1       // Deja la busqueda de la instruccion en los registros y sale al epilogo
+#define JIT_FRIO_INVALIDAR 2    // memoria_invalidar_decodificada sobre la palabra escrita (en ecx)
+#define JIT_TIPOS_FRIO 3
+
+// Registros de x86-64 que usa el codigo en linea
+#define JIT_EAX 0
+#define JIT_ECX 1
+#define JIT_EDX 2
+
+// op r32, [m] y op [m], r32
+#define JIT_OP_CARGAR 0x8B
+#define JIT_OP_GUARDAR 0x89
+#define JIT_OP_SUMAR 0x03
+#define JIT_OP_COMPARAR 0x3B
+
+// Extensiones de 0x81 (op r32, inmediato)
+#define JIT_INM_ADD 0
+#define JIT_INM_SUB 5
+#define JIT_INM_CMP 7
+
+#define JIT_SIGNO 10000000      // Digito de signo de una palabra en Signo-Magnitud
+#define JIT_CPU(campo) offsetof(CPU_t, campo)
+#define JIT_MEM(campo) offsetof(Memoria_t, campo)
+
+// Salto de un camino rapido hacia un tramo frio, pendiente de parchear
+typedef struct {
+    size_t posicion;                // Desplazamiento del rel32
+    int k;                          // Instruccion del bloque
+    int tipo;                       // JIT_FRIO_*
+} SaltoFrioJIT_t;
+
+// Estado de la traduccion de un bloque
+typedef struct {
+    int k;                          // Instruccion que se esta emitiendo
+    SaltoFrioJIT_t saltos[JIT_SALTOS_FRIOS];
+    int cant_saltos;
+} TraduccionJIT_t;
+
+static const unsigned char jit_jmp[] = { 0xE9 };
+static const unsigned char jit_jne[] = { 0x0F, 0x85 };
+static const unsigned char jit_je[] = { 0x0F, 0x84 };
+static const unsigned char jit_jl[] = { 0x0F, 0x8C };
+static const unsigned char jit_jge[] = { 0x0F, 0x8D };
+static const unsigned char jit_jle[] = { 0x0F, 0x8E };
+static const unsigned char jit_jg[] = { 0x0F, 0x8F };
+static const unsigned char jit_jae[] = { 0x0F, 0x83 };
+static const unsigned char jit_ja[] = { 0x0F, 0x87 };
+
+//------------------------------------------------------EMISION DE CODIGO x86-64---------------------------------------------------------------------------------
+
+static void jit_emitir_byte(MotorJIT_t *jit, unsigned char b) {
+    jit->codigo[jit->usado++] = b;
+}
+
+static void jit_emitir_bytes(MotorJIT_t *jit, const unsigned char *bytes, size_t n) {
+    memcpy(jit->codigo + jit->usado, bytes, n);
+    jit->usado += n;
+}
+
+static void jit_emitir_32(MotorJIT_t *jit, uint32_t valor) {
+    memcpy(jit->codigo + jit->usado, &valor, 4);
+    jit->usado += 4;
+}
+
+static void jit_emitir_64(MotorJIT_t *jit, uint64_t valor) {
+    memcpy(jit->codigo + jit->usado, &valor, 8);
+    jit->usado += 8;
+}
+
+// Apunta el rel32 que esta en posicion a destino
+static void jit_parchear_salto(MotorJIT_t *jit, size_t posicion, const unsigned char *destino) {
+    int32_t rel = (int32_t)(destino - (jit->codigo + posicion + 4));
+    memcpy(jit->codigo + posicion, &rel, 4);
+}
+
+// jmp o jcc con desplazamiento de 32 bits. Retorna la posicion del rel32.
+static size_t jit_emitir_salto(MotorJIT_t *jit, const unsigned char *op, size_t n, const unsigned char *destino) {
+    jit_emitir_bytes(jit, op, n);
+    size_t posicion = jit->usado;
+    jit_emitir_32(jit, 0);
+    jit_parchear_salto(jit, posicion, destino);
+    return posicion;
+}
+
+// mov dword [rbx + desplazamiento], inmediato   (rbx = cpu)
+static void jit_emitir_guardar_registro(MotorJIT_t *jit, size_t desplazamiento, int32_t valor) {
+    static const unsigned char op[] = { 0xC7, 0x83 };
+    jit_emitir_bytes(jit, op, sizeof(op));
+    jit_emitir_32(jit, (uint32_t)desplazamiento);
+    jit_emitir_32(jit, (uint32_t)valor);
+}
+
+// cmp dword [rbx + desplazamiento], inmediato   (10 bytes)
+static void jit_emitir_comparar_registro(MotorJIT_t *jit, size_t desplazamiento, int32_t valor) {
+    static const unsigned char op[] = { 0x81, 0xBB };
+    jit_emitir_bytes(jit, op, sizeof(op));
+    jit_emitir_32(jit, (uint32_t)desplazamiento);
+    jit_emitir_32(jit, (uint32_t)valor);
+}
+
+// add r15d, ciclos   (ciclos hechos)
+static void jit_emitir_sumar_ciclos(MotorJIT_t *jit, int ciclos) {
+    static const unsigned char op[] = { 0x41, 0x81, 0xC7 };
+    jit_emitir_bytes(jit, op, sizeof(op));
+    jit_emitir_32(jit, (uint32_t)ciclos);
+}
+
+// Fase de busqueda ya resuelta: MAR, MDR, IR y PC de la instruccion en dir
+static void jit_emitir_busqueda(MotorJIT_t *jit, int dir, palabra_t palabra) {
+    jit_emitir_guardar_registro(jit, JIT_CPU(MAR), dir);
+    jit_emitir_guardar_registro(jit, JIT_CPU(MDR), palabra);
+    jit_emitir_guardar_registro(jit, JIT_CPU(IR), palabra);
+    jit_emitir_guardar_registro(jit, JIT_CPU(PSW.pc), dir + 1);
+}
+
+// manejador(cpu, inst, mem, dma)
+static void jit_emitir_llamada_manejador(MotorJIT_t *jit, const Instruccion_t *inst) {
+    static const unsigned char args_1[] = { 0x48, 0x89, 0xDF, 0x48, 0xBE }; // mov rdi, rbx ; mov rsi, imm64
+    jit_emitir_bytes(jit, args_1, sizeof(args_1));
+    jit_emitir_64(jit, (uint64_t)(uintptr_t)inst);
+    static const unsigned char args_2[] = { 0x4C, 0x89, 0xE2, 0x4C, 0x89, 0xE9, 0x48, 0xB8 }; // mov rdx, r12 ; mov rcx, r13 ; mov rax, imm64
+    jit_emitir_bytes(jit, args_2, sizeof(args_2));
+    jit_emitir_64(jit, (uint64_t)(uintptr_t)cpu_manejador_instruccion(inst->codigo_op));
+    static const unsigned char llamada[] = { 0xFF, 0xD0 }; // call rax
+    jit_emitir_bytes(jit, llamada, sizeof(llamada));
+}
+
+// cmp dword [rbx + desplazamiento], 0   (cpu->interrupciones_pendientes)
+static void jit_emitir_comparar_pendientes(MotorJIT_t *jit) {
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x83, 0xBB }, 2);
+    jit_emitir_32(jit, (uint32_t)JIT_CPU(interrupciones_pendientes));
+    jit_emitir_byte(jit, 0x00);
+}
+
+// cmp dword [r12 + desplazamiento], 0   (mem->traduccion_invalida)
+static void jit_emitir_comparar_traduccion(MotorJIT_t *jit) {
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x41, 0x83, 0xBC, 0x24 }, 4);
+    jit_emitir_32(jit, (uint32_t)JIT_MEM(traduccion_invalida));
+    jit_emitir_byte(jit, 0x00);
+}
+
+// op reg, [rbx + desplazamiento]   (un campo de la CPU; op es JIT_OP_* o 0xFF con reg = 0 inc, 1 dec)
+static void jit_emitir_op_cpu(MotorJIT_t *jit, unsigned char op, int reg, size_t desplazamiento) {
+    jit_emitir_byte(jit, op);
+    jit_emitir_byte(jit, (unsigned char)(0x83 | reg << 3));
+    jit_emitir_32(jit, (uint32_t)desplazamiento);
+}
+
+// op reg, inmediato   (extension JIT_INM_*)
+static void jit_emitir_op_inmediato(MotorJIT_t *jit, int extension, int reg, int32_t valor) {
+    jit_emitir_byte(jit, 0x81);
+    jit_emitir_byte(jit, (unsigned char)(0xC0 | extension << 3 | reg));
+    jit_emitir_32(jit, (uint32_t)valor);
+}
+
+// mov reg, inmediato
+static void jit_emitir_mover_inmediato(MotorJIT_t *jit, int reg, int32_t valor) {
+    jit_emitir_byte(jit, (unsigned char)(0xB8 + reg));
+    jit_emitir_32(jit, (uint32_t)valor);
+}
+
+// mov rdx, [r12 + desplazamiento]   (uno de los arreglos de la memoria)
+static void jit_emitir_arreglo_memoria(MotorJIT_t *jit, size_t desplazamiento) {
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x49, 0x8B, 0x94, 0x24 }, 4);
+    jit_emitir_32(jit, (uint32_t)desplazamiento);
+}
+
+// reg = datos[rcx]
+static void jit_emitir_leer_palabra(MotorJIT_t *jit, int reg) {
+    jit_emitir_arreglo_memoria(jit, JIT_MEM(datos));
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x8B, (unsigned char)(0x04 | reg << 3), 0x8A }, 3);
+}
+
+// datos[rcx] = eax
+static void jit_emitir_escribir_palabra(MotorJIT_t *jit) {
+    jit_emitir_arreglo_memoria(jit, JIT_MEM(datos));
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x89, 0x04, 0x8A }, 3);
+}
+
+// Salto corto hacia adelante (jcc rel8). Retorna la posicion del rel8 para jit_fijar_salto_corto.
+static size_t jit_emitir_salto_corto(MotorJIT_t *jit, unsigned char op) {
+    jit_emitir_byte(jit, op);
+    jit_emitir_byte(jit, 0x00);
+    return jit->usado - 1;
+}
+
+static void jit_fijar_salto_corto(MotorJIT_t *jit, size_t posicion) {
+    jit->codigo[posicion] = (unsigned char)(jit->usado - posicion - 1);
+}
+
+// jcc o jmp hacia el tramo frio de la instruccion en curso. Se parchea al emitir los tramos,
+// despues del bloque.
+static void jit_emitir_salto_frio(MotorJIT_t *jit, TraduccionJIT_t *tr, const unsigned char *op, size_t n, int tipo) {
+    jit_emitir_bytes(jit, op, n);
+    SaltoFrioJIT_t *salto = &tr->saltos[tr->cant_saltos++];
+    salto->posicion = jit->usado;
+    salto->k = tr->k;
+    salto->tipo = tipo;
+    jit_emitir_32(jit, 0);
+}
+
+// Entero con signo de 7 digitos -> Signo-Magnitud:   test reg, reg ; jns listo ; neg reg ; add reg, 10^7
+static void jit_emitir_signo_magnitud(MotorJIT_t *jit, int reg) {
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x85, (unsigned char)(0xC0 | reg << 3 | reg) }, 2);
+    size_t listo = jit_emitir_salto_corto(jit, 0x79);
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0xF7, (unsigned char)(0xD8 | reg) }, 2);
+    jit_emitir_op_inmediato(jit, JIT_INM_ADD, reg, JIT_SIGNO);
+    jit_fijar_salto_corto(jit, listo);
+}
+
+// palabra_a_sm sobre reg
+static void jit_emitir_palabra_a_sm(MotorJIT_t *jit, int reg) {
+#ifdef CPU_PALABRA_NATIVA
+    jit_emitir_signo_magnitud(jit, reg);
+#else
+    (void)jit;
+    (void)reg;
+#endif
+}
+
+// valor_a_palabra sobre reg, con el valor ya verificado dentro de 7 digitos
+static void jit_emitir_valor_a_palabra(MotorJIT_t *jit, int reg) {
+#ifdef CPU_PALABRA_NATIVA
+    (void)jit;
+    (void)reg;
+#else
+    jit_emitir_signo_magnitud(jit, reg);
+#endif
+}
+
+// palabra_a_valor sobre reg. Las palabras que no se convierten con una resta (digito de
+// signo mayor que 1 o, en la representacion nativa, positivas con digito de signo) van al
+// manejador.
+static void jit_emitir_palabra_a_valor(MotorJIT_t *jit, TraduccionJIT_t *tr, int reg) {
+    jit_emitir_op_inmediato(jit, JIT_INM_CMP, reg, JIT_SIGNO);
+#ifdef CPU_PALABRA_NATIVA
+    jit_emitir_salto_frio(jit, tr, jit_jge, sizeof(jit_jge), JIT_FRIO_LENTO);
+#else
+    // jb listo ; sub reg, 10^7 ; cmp reg, 10^7 ; jae lento ; neg reg
+    size_t listo = jit_emitir_salto_corto(jit, 0x72);
+    jit_emitir_op_inmediato(jit, JIT_INM_SUB, reg, JIT_SIGNO);
+    jit_emitir_op_inmediato(jit, JIT_INM_CMP, reg, JIT_SIGNO);
+    jit_emitir_salto_frio(jit, tr, jit_jae, sizeof(jit_jae), JIT_FRIO_LENTO);
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0xF7, (unsigned char)(0xD8 | reg) }, 2);
+    jit_fijar_salto_corto(jit, listo);
+#endif
+}
+
+// RB <= ecx <= RL (cpu_verificar_memoria)
+static void jit_emitir_verificar_limites(MotorJIT_t *jit, TraduccionJIT_t *tr) {
+    jit_emitir_op_cpu(jit, JIT_OP_COMPARAR, JIT_ECX, JIT_CPU(RB));
+    jit_emitir_salto_frio(jit, tr, jit_jl, sizeof(jit_jl), JIT_FRIO_LENTO);
+    jit_emitir_op_cpu(jit, JIT_OP_COMPARAR, JIT_ECX, JIT_CPU(RL));
+    jit_emitir_salto_frio(jit, tr, jit_jg, sizeof(jit_jg), JIT_FRIO_LENTO);
+}
+
+// ecx = direccion fisica del operando directo o indexado, ya verificada
+static void jit_emitir_direccion(MotorJIT_t *jit, TraduccionJIT_t *tr, const Instruccion_t *inst) {
+    if (inst->direccionamiento == DIR_INDEXADO) {
+        jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_ECX, JIT_CPU(AC));
+        jit_emitir_palabra_a_sm(jit, JIT_ECX);
+        jit_emitir_op_cpu(jit, JIT_OP_SUMAR, JIT_ECX, JIT_CPU(RB));
+        jit_emitir_op_inmediato(jit, JIT_INM_ADD, JIT_ECX, inst->valor);
+        jit_emitir_verificar_limites(jit, tr);
+    } else {
+        // RB + valor no puede quedar debajo de RB
+        jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_ECX, JIT_CPU(RB));
+        jit_emitir_op_inmediato(jit, JIT_INM_ADD, JIT_ECX, inst->valor);
+        jit_emitir_op_cpu(jit, JIT_OP_COMPARAR, JIT_ECX, JIT_CPU(RL));
+        jit_emitir_salto_frio(jit, tr, jit_jg, sizeof(jit_jg), JIT_FRIO_LENTO);
+    }
+}
+
+// ecx = RX + SP, la direccion del tope de una pila no vacia (cpu_leer_tope_pila)
+static void jit_emitir_tope_pila(MotorJIT_t *jit, TraduccionJIT_t *tr) {
+    jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_EAX, JIT_CPU(SP));
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x85, 0xC0 }, 2); // test eax, eax
+    jit_emitir_salto_frio(jit, tr, jit_jle, sizeof(jit_jle), JIT_FRIO_LENTO);
+    jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_ECX, JIT_CPU(RX));
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x01, 0xC1 }, 2); // add ecx, eax
+    jit_emitir_verificar_limites(jit, tr);
+}
+
+// Tras escribir datos[ecx]: si la palabra tenia instruccion decodificada o codigo traducido
+// se invalida en el tramo frio. Si su entrada ya era invalida, las superinstrucciones que la
+// incluyen tambien lo son.
+static void jit_emitir_invalidacion(MotorJIT_t *jit, TraduccionJIT_t *tr) {
+    jit_emitir_arreglo_memoria(jit, JIT_MEM(decodificada_valida));
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x0F, 0xB6, 0x04, 0x0A }, 4); // movzx eax, byte [rdx + rcx]
+    jit_emitir_arreglo_memoria(jit, JIT_MEM(traducida));
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x0A, 0x04, 0x0A }, 3);       // or al, [rdx + rcx]
+    jit_emitir_salto_frio(jit, tr, jit_jne, sizeof(jit_jne), JIT_FRIO_INVALIDAR);
+}
+
+// PC = RB + valor, verificado contra RL (cpu_saltar_modo con un operando inmediato)
+static void jit_emitir_saltar(MotorJIT_t *jit, TraduccionJIT_t *tr, const Instruccion_t *inst) {
+    jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_ECX, JIT_CPU(RB));
+    jit_emitir_op_inmediato(jit, JIT_INM_ADD, JIT_ECX, inst->valor);
+    jit_emitir_op_cpu(jit, JIT_OP_COMPARAR, JIT_ECX, JIT_CPU(RL));
+    jit_emitir_salto_frio(jit, tr, jit_jg, sizeof(jit_jg), JIT_FRIO_LENTO);
+    jit_emitir_op_cpu(jit, JIT_OP_GUARDAR, JIT_ECX, JIT_CPU(PSW.pc));
+}
+
+// Trampolin y epilogo al principio del buffer: no se descartan al vaciar la cache
+static void jit_emitir_rutinas(MotorJIT_t *jit) {
+    static const unsigned char trampolin[] = {
+        0x53,                   // push rbx
+        0x41, 0x54,             // push r12
+        0x41, 0x55,             // push r13
+        0x41, 0x56,             // push r14
+        0x41, 0x57,             // push r15   (la pila queda alineada a 16 para las llamadas)
+        0x48, 0x89, 0xFB,       // mov rbx, rdi   (cpu)
+        0x49, 0x89, 0xF4,       // mov r12, rsi   (mem)
+        0x49, 0x89, 0xD5,       // mov r13, rdx   (dma)
+        0x41, 0x89, 0xCE,       // mov r14d, ecx  (presupuesto)
+        0x45, 0x31, 0xFF,       // xor r15d, r15d (ciclos hechos)
+        0x41, 0xFF, 0xE0        // jmp r8         (bloque)
+    };
+    static const unsigned char epilogo[] = {
+        0x44, 0x89, 0xF8,       // mov eax, r15d
+        0x41, 0x5F,             // pop r15
+        0x41, 0x5E,             // pop r14
+        0x41, 0x5D,             // pop r13
+        0x41, 0x5C,             // pop r12
+        0x5B,                   // pop rbx
+        0xC3                    // ret
+    };
+    jit->trampolin = (TrampolinJIT_t)(void *)jit->codigo;
+    jit_emitir_bytes(jit, trampolin, sizeof(trampolin));
+    jit->epilogo = jit->codigo + jit->usado;
+    jit_emitir_bytes(jit, epilogo, sizeof(epilogo));
+    jit->fin_rutinas = jit->usado;
+}
+
+//------------------------------------------------------CACHE DE BLOQUES-----------------------------------------------------------------------------------------
+
+static int jit_es_fin_de_bloque(int codigo_op) {
+    switch (codigo_op) {
+        case 0: case 1: case 2: case 3: case 4: case 5: case 6: case 8:
+        case 19: case 21: case 23: case 24: case 25: case 26:
+            return 0; // No tocan PC, RB, RL, RX ni el modo
+        default:
+            return 1; // Saltos, SVC, RETRN, cambios de modo o registros base, DMA, invalidas
+    }
+}
+
+static void jit_proteger(MotorJIT_t *jit, int escribible) {
+    mprotect(jit->codigo, JIT_TAM_CODIGO, escribible ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC));
+}
+
+// Descarta todos los bloques y reutiliza el buffer desde el principio
+static void jit_vaciar(MotorJIT_t *jit, Memoria_t *mem) {
+    memset(jit->entrada, 0, jit->tam_memoria * sizeof(void *));
+    memset(jit->contador, 0, jit->tam_memoria * sizeof(int));
+    memset(mem->traducida, 0, jit->tam_memoria);
+    jit->usado = jit->fin_rutinas;
+    jit->cant_instrucciones = 0;
+    jit->cant_enlaces = 0;
+    LOG_DEBUG(LOG_CAT_SIS, "JIT: cache de bloques vaciada");
+}
+
+// Tras una escritura sobre codigo traducido, descarta los bloques cuyas palabras
+// ya no coinciden con la memoria y recalcula las marcas de memoria traducida
+static void jit_revisar_invalidaciones(MotorJIT_t *jit, Memoria_t *mem) {
+    int descartados = 0;
+    memset(mem->traducida, 0, jit->tam_memoria);
+    for (int ini = 0; ini < jit->tam_memoria; ini++) {
+        if (jit->entrada[ini] == NULL) continue;
+
+        int n = jit->fin_bloque[ini] - ini + 1;
+        const palabra_t *palabras = &jit->palabras[jit->primera[ini]];
+        if (memcmp(palabras, &mem->datos[ini], n * sizeof(palabra_t)) != 0) {
+            jit->entrada[ini] = NULL;
+            jit->contador[ini] = 0;
+            jit->bloques_invalidados++;
+            descartados++;
+            continue;
+        }
+        memset(&mem->traducida[ini], 1, n);
+    }
+    mem->traduccion_invalida = 0;
+    if (descartados == 0) return;
+
+    // Las salidas enlazadas a un bloque descartado vuelven al epilogo; las de un bloque
+    // descartado ya no se enlazan (su codigo no se vuelve a ejecutar)
+    jit_proteger(jit, 1);
+    for (int e = 0; e < jit->cant_enlaces; e++) {
+        EnlaceJIT_t *enlace = &jit->enlaces[e];
+        if (enlace->destino < 0) continue;
+        if (jit->entrada[enlace->bloque] == NULL) {
+            enlace->destino = -1;
+        } else if (enlace->enlazada && jit->entrada[enlace->destino] == NULL) {
+            jit_parchear_salto(jit, enlace->posicion, jit->epilogo);
+            enlace->enlazada = 0;
+        }
+    }
+    jit_proteger(jit, 0);
+}
+
+// Direcciones a las que puede seguir el bloque despues de su ultima instruccion: el destino
+// de un salto inmediato y la siguiente palabra (salvo tras J). El sucesor real se compara
+// en ejecucion con cada una, asi que una prediccion que no se cumple solo sale al epilogo.
+static int jit_sucesores(MotorJIT_t *jit, const CPU_t *cpu, const Instruccion_t *ultima, int fin, int *sucesores) {
+    int cant = 0;
+    int codigo_op = ultima->codigo_op;
+    int es_salto = codigo_op == 27 || (codigo_op >= 9 && codigo_op <= 12);
+    if (es_salto && ultima->direccionamiento == DIR_INMEDIATO) {
+        int destino = (cpu->PSW.modo == MODO_USUARIO ? cpu->RB : 0) + ultima->valor;
+        if (destino >= 0 && destino < jit->tam_memoria) sucesores[cant++] = destino;
+    }
+    if (codigo_op != 27 && fin + 1 < jit->tam_memoria) sucesores[cant++] = fin + 1;
+    return cant;
+}
+
+// 1 si la instruccion tiene camino rapido en linea (en bloques de modo usuario)
+static int jit_traducible_en_linea(const Instruccion_t *inst) {
+    switch (inst->codigo_op) {
+        case 0: case 1: case 4: case 8:     // SUM, RES, LOAD, COMP
+            return inst->direccionamiento <= DIR_INDEXADO;
+        case 5:                             // STR (con direccion inmediata siempre falla)
+            return inst->direccionamiento == DIR_DIRECTO || inst->direccionamiento == DIR_INDEXADO;
+        case 9: case 10: case 11: case 12: case 27: // Saltos
+            return inst->direccionamiento == DIR_INMEDIATO;
+        case 6: case 14: case 19: case 21: case 23: case 25: case 26: // LOADRx, RETRN, PSH, POP
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Camino rapido de la instruccion en curso. Nada se modifica antes de la ultima verificacion
+// que puede ir al tramo lento, asi el manejador la repite desde el principio.
+static void jit_emitir_en_linea(MotorJIT_t *jit, TraduccionJIT_t *tr, const Instruccion_t *inst) {
+    switch (inst->codigo_op) {
+        case 0: case 1: case 8: // SUM, RES y COMP: AC +/- operando, con codigo de condicion
+            if (inst->direccionamiento == DIR_INMEDIATO) {
+                jit_emitir_mover_inmediato(jit, JIT_ECX, inst->valor);
+            } else {
+                jit_emitir_direccion(jit, tr, inst);
+                jit_emitir_leer_palabra(jit, JIT_ECX);
+                jit_emitir_palabra_a_valor(jit, tr, JIT_ECX);
+            }
+            jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_EAX, JIT_CPU(AC));
+            jit_emitir_palabra_a_valor(jit, tr, JIT_EAX);
+            jit_emitir_bytes(jit, (const unsigned char[]){ inst->codigo_op == 0 ? 0x01 : 0x29, 0xC8 }, 2); // add/sub eax, ecx
+
+            // Mas de 7 digitos (CC_OVERFLOW e INT_OVERFLOW): lea edx, [rax + 9999999] ; cmp edx, 19999998 ; ja lento
+            jit_emitir_bytes(jit, (const unsigned char[]){ 0x8D, 0x90 }, 2);
+            jit_emitir_32(jit, JIT_SIGNO - 1);
+            jit_emitir_op_inmediato(jit, JIT_INM_CMP, JIT_EDX, 2 * (JIT_SIGNO - 1));
+            jit_emitir_salto_frio(jit, tr, jit_ja, sizeof(jit_ja), JIT_FRIO_LENTO);
+
+            // CC = (res < 0) + 2 * (res > 0), que da CC_IGUAL, CC_MENOR o CC_MAYOR
+            jit_emitir_bytes(jit, (const unsigned char[]){
+                0x31, 0xC9,             // xor ecx, ecx
+                0x31, 0xD2,             // xor edx, edx
+                0x85, 0xC0,             // test eax, eax
+                0x0F, 0x9C, 0xC1,       // setl cl
+                0x0F, 0x9F, 0xC2,       // setg dl
+                0x8D, 0x14, 0x51        // lea edx, [rcx + rdx*2]
+            }, 15);
+            jit_emitir_op_cpu(jit, JIT_OP_GUARDAR, JIT_EDX, JIT_CPU(PSW.codigo_condicion));
+            if (inst->codigo_op != 8) {
+                jit_emitir_valor_a_palabra(jit, JIT_EAX);
+                jit_emitir_op_cpu(jit, JIT_OP_GUARDAR, JIT_EAX, JIT_CPU(AC));
+            }
+            break;
+
+        case 4: // LOAD
+            if (inst->direccionamiento == DIR_INMEDIATO) {
+                jit_emitir_guardar_registro(jit, JIT_CPU(AC), inst->valor);
+                break;
+            }
+            jit_emitir_direccion(jit, tr, inst);
+            jit_emitir_leer_palabra(jit, JIT_ECX);
+            jit_emitir_op_cpu(jit, JIT_OP_GUARDAR, JIT_ECX, JIT_CPU(AC));
+            break;
+
+        case 5: // STR
+            jit_emitir_direccion(jit, tr, inst);
+            jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_EAX, JIT_CPU(AC));
+            jit_emitir_escribir_palabra(jit);
+            jit_emitir_invalidacion(jit, tr);
+            break;
+
+        case 6: case 19: case 21: case 23: { // LOADRX, LOADRB, LOADRL y LOADSP
+            size_t registro = inst->codigo_op == 6 ? JIT_CPU(RX) : inst->codigo_op == 19 ? JIT_CPU(RB) :
+                              inst->codigo_op == 21 ? JIT_CPU(RL) : JIT_CPU(SP);
+            jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_EAX, registro);
+#ifdef CPU_PALABRA_NATIVA
+            // sm_a_palabra: un registro con digito de signo se convierte en el manejador
+            jit_emitir_op_inmediato(jit, JIT_INM_CMP, JIT_EAX, JIT_SIGNO);
+            jit_emitir_salto_frio(jit, tr, jit_jg, sizeof(jit_jg), JIT_FRIO_LENTO);
+#endif
+            jit_emitir_op_cpu(jit, JIT_OP_GUARDAR, JIT_EAX, JIT_CPU(AC));
+            break;
+        }
+
+        case 9: case 10: case 11: case 12: { // JMPE, JMPNE, JMPLT y JMPGT: AC contra el tope de la pila
+            jit_emitir_tope_pila(jit, tr);
+            jit_emitir_leer_palabra(jit, JIT_ECX);
+            jit_emitir_palabra_a_valor(jit, tr, JIT_ECX);
+            jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_EAX, JIT_CPU(AC));
+            jit_emitir_palabra_a_valor(jit, tr, JIT_EAX);
+            jit_emitir_bytes(jit, (const unsigned char[]){ 0x39, 0xC8 }, 2); // cmp eax, ecx
+
+            // Salto sobre el salto simulado con la condicion contraria (el PC ya apunta a la siguiente)
+            static const unsigned char *const no_cumple[] = { jit_jne, jit_je, jit_jge, jit_jle };
+            size_t sigue = jit_emitir_salto(jit, no_cumple[inst->codigo_op - 9], 2, jit->epilogo);
+            jit_emitir_saltar(jit, tr, inst);
+            jit_parchear_salto(jit, sigue, jit->codigo + jit->usado);
+            break;
+        }
+
+        case 27: // J
+            jit_emitir_saltar(jit, tr, inst);
+            break;
+
+        case 14: // RETRN: el PC sale del tope de la pila
+            jit_emitir_tope_pila(jit, tr);
+            jit_emitir_op_inmediato(jit, JIT_INM_CMP, JIT_ECX, jit->tam_memoria);
+            jit_emitir_salto_frio(jit, tr, jit_jae, sizeof(jit_jae), JIT_FRIO_LENTO);
+            jit_emitir_leer_palabra(jit, JIT_ECX);
+            jit_emitir_palabra_a_sm(jit, JIT_ECX);
+            jit_emitir_op_cpu(jit, JIT_OP_GUARDAR, JIT_ECX, JIT_CPU(PSW.pc));
+            jit_emitir_op_cpu(jit, 0xFF, 1, JIT_CPU(SP)); // dec SP
+            break;
+
+        case 25: // PSH
+            jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_ECX, JIT_CPU(RX));
+            jit_emitir_op_cpu(jit, JIT_OP_SUMAR, JIT_ECX, JIT_CPU(SP));
+            jit_emitir_op_inmediato(jit, JIT_INM_ADD, JIT_ECX, 1);
+            jit_emitir_verificar_limites(jit, tr);
+            jit_emitir_op_cpu(jit, 0xFF, 0, JIT_CPU(SP)); // inc SP
+            jit_emitir_op_cpu(jit, JIT_OP_CARGAR, JIT_EAX, JIT_CPU(AC));
+            jit_emitir_escribir_palabra(jit);
+            jit_emitir_invalidacion(jit, tr);
+            break;
+
+        default: // 26: POP
+            jit_emitir_tope_pila(jit, tr);
+            jit_emitir_leer_palabra(jit, JIT_EAX);
+            jit_emitir_op_cpu(jit, JIT_OP_GUARDAR, JIT_EAX, JIT_CPU(AC));
+            jit_emitir_op_cpu(jit, 0xFF, 1, JIT_CPU(SP)); // dec SP
+            break;
+    }
+}
+
+// Tramo frio de tipo para la instruccion k del bloque (en dir). cont es donde sigue el bloque
+// despues de la instruccion.
+static void jit_emitir_tramo_frio(MotorJIT_t *jit, int tipo, int k, int dir, palabra_t palabra,
+                                  const Instruccion_t *inst, int en_linea, size_t cont) {
+    switch (tipo) {
+        case JIT_FRIO_LENTO:
+            jit_emitir_busqueda(jit, dir, palabra);
+            jit_emitir_llamada_manejador(jit, inst);
+            break;
+        case JIT_FRIO_SALIDA:
+            // Una instruccion por manejador ya dejo su busqueda en los registros
+            if (en_linea) jit_emitir_busqueda(jit, dir, palabra);
+            jit_emitir_sumar_ciclos(jit, k + 1);
+            jit_emitir_salto(jit, jit_jmp, sizeof(jit_jmp), jit->epilogo);
+            return;
+        default:
+            // memoria_invalidar_decodificada(mem, ecx): mov rdi, r12 ; mov esi, ecx ; mov rax, imm64 ; call rax
+            jit_emitir_bytes(jit, (const unsigned char[]){ 0x4C, 0x89, 0xE7, 0x89, 0xCE, 0x48, 0xB8 }, 7);
+            jit_emitir_64(jit, (uint64_t)(uintptr_t)memoria_invalidar_decodificada);
+            jit_emitir_bytes(jit, (const unsigned char[]){ 0xFF, 0xD0 }, 2);
+            break;
+    }
+    jit_emitir_salto(jit, jit_jmp, sizeof(jit_jmp), jit->codigo + cont);
+}
+
+// Traduce el bloque basico que empieza en ini. Retorna 0 si no se pudo traducir.
+static int jit_compilar_bloque(MotorJIT_t *jit, CPU_t *cpu, Memoria_t *mem, int ini) {
+    // El bloque termina en la primera instruccion que cambia el flujo o el contexto
+    // (incluida), en la primera palabra sin decodificar o al salir de la particion
+    int fin = ini;
+    while (1) {
+        if (!mem->decodificada_valida[fin]) { fin--; break; }
+        if (cpu->PSW.modo == MODO_USUARIO && (fin > cpu->RL || fin >= cpu->RX)) { fin--; break; }
+        if (jit_es_fin_de_bloque(mem->decodificadas[fin].codigo_op)) break;
+        if (fin - ini + 1 >= JIT_MAX_BLOQUE || fin + 1 >= jit->tam_memoria) break;
+        fin++;
+    }
+    int n = fin - ini + 1;
+    if (n < 2) return 0; // Una sola instruccion no amortiza la entrada al bloque
+
+    if (jit->cant_instrucciones + n > JIT_MAX_INSTRUCCIONES || jit->cant_enlaces + 2 > JIT_MAX_ENLACES ||
+        jit->usado + (size_t)n * JIT_BYTES_POR_INSTRUCCION + JIT_BYTES_ENLACES > JIT_TAM_CODIGO) {
+        jit_vaciar(jit, mem);
+    }
+
+    int primera = jit->cant_instrucciones;
+    jit->cant_instrucciones += n;
+    for (int k = 0; k < n; k++) {
+        jit->instrucciones[primera + k] = mem->decodificadas[ini + k];
+        jit->palabras[primera + k] = mem->datos[ini + k];
+    }
+
+    // Con el log de operaciones activo los manejadores son los que lo escriben
+    int en_linea = cpu->PSW.modo == MODO_USUARIO && !jit->registra_operaciones;
+    unsigned char *codigo = jit->codigo + jit->usado;
+    TraduccionJIT_t tr;
+    tr.cant_saltos = 0;
+    size_t cont[JIT_MAX_BLOQUE];            // Donde sigue el bloque despues de cada instruccion
+    unsigned char rapida[JIT_MAX_BLOQUE];   // La instruccion tiene camino rapido en linea
+
+    jit_proteger(jit, 1);
+
+    // Entrada: las condiciones de jit_puede_entrar, para cuando se llega desde otro bloque.
+    // cmp r14d, n ; jl epilogo   (el bloque entero tiene que caber en el presupuesto)
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x41, 0x81, 0xFE }, 3);
+    jit_emitir_32(jit, (uint32_t)n);
+    jit_emitir_salto(jit, jit_jl, sizeof(jit_jl), jit->epilogo);
+    // En modo usuario la busqueda no puede fallar en ninguna direccion del bloque. Un bloque
+    // en linea solo se ejecuta en modo usuario.
+    jit_emitir_comparar_registro(jit, JIT_CPU(PSW.modo), MODO_USUARIO);
+    if (en_linea) {
+        jit_emitir_salto(jit, jit_jne, sizeof(jit_jne), jit->epilogo);
+    } else {
+        jit_emitir_bytes(jit, (const unsigned char[]){ 0x75, 0x30 }, 2); // jne: las tres verificaciones siguientes
+    }
+    jit_emitir_comparar_registro(jit, JIT_CPU(RB), ini);
+    jit_emitir_salto(jit, jit_jg, sizeof(jit_jg), jit->epilogo);
+    jit_emitir_comparar_registro(jit, JIT_CPU(RL), fin);
+    jit_emitir_salto(jit, jit_jl, sizeof(jit_jl), jit->epilogo);
+    jit_emitir_comparar_registro(jit, JIT_CPU(RX), fin);
+    jit_emitir_salto(jit, jit_jle, sizeof(jit_jle), jit->epilogo);
+
+    for (int k = 0; k < n; k++) {
+        int dir = ini + k;
+        palabra_t palabra = mem->datos[dir];
+        const Instruccion_t *inst = &jit->instrucciones[primera + k];
+        tr.k = k;
+
+        rapida[k] = en_linea && jit_traducible_en_linea(inst);
+        if (rapida[k]) {
+            // Los registros de la busqueda solo se escriben al salir del bloque
+            if (k == n - 1) jit_emitir_busqueda(jit, dir, palabra);
+            jit_emitir_en_linea(jit, &tr, inst);
+        } else {
+            jit_emitir_busqueda(jit, dir, palabra);
+            jit_emitir_llamada_manejador(jit, inst);
+        }
+        cont[k] = jit->usado;
+
+        if (k == n - 1) break; // Tras la ultima instruccion se pasa a las salidas
+
+        jit_emitir_comparar_pendientes(jit);
+        jit_emitir_salto_frio(jit, &tr, jit_jne, sizeof(jit_jne), JIT_FRIO_SALIDA);
+
+        // Codigo automodificable: STR y PSH pueden sobrescribir el propio bloque
+        if (inst->codigo_op == 5 || inst->codigo_op == 25) {
+            jit_emitir_comparar_traduccion(jit);
+            jit_emitir_salto_frio(jit, &tr, jit_jne, sizeof(jit_jne), JIT_FRIO_SALIDA);
+        }
+    }
+
+    // Salidas: se cuentan los n ciclos (add r15d, n ; sub r14d, n) y, si no quedo nada
+    // pendiente, se sigue en el bloque del sucesor
+    jit_emitir_sumar_ciclos(jit, n);
+    jit_emitir_bytes(jit, (const unsigned char[]){ 0x41, 0x81, 0xEE }, 3);
+    jit_emitir_32(jit, (uint32_t)n);
+    jit_emitir_comparar_pendientes(jit);
+    jit_emitir_salto(jit, jit_jne, sizeof(jit_jne), jit->epilogo);
+    jit_emitir_comparar_traduccion(jit);
+    jit_emitir_salto(jit, jit_jne, sizeof(jit_jne), jit->epilogo);
+
+    // Por cada sucesor posible: cmp PC, sucesor ; jne +5 ; jmp epilogo (hasta enlazarlo)
+    int sucesores[2];
+    int cant_sucesores = jit_sucesores(jit, cpu, &jit->instrucciones[primera + n - 1], fin, sucesores);
+    for (int i = 0; i < cant_sucesores; i++) {
+        jit_emitir_comparar_registro(jit, JIT_CPU(PSW.pc), sucesores[i]);
+        jit_emitir_bytes(jit, (const unsigned char[]){ 0x75, 0x05 }, 2);
+        EnlaceJIT_t *enlace = &jit->enlaces[jit->cant_enlaces++];
+        enlace->posicion = jit_emitir_salto(jit, jit_jmp, sizeof(jit_jmp), jit->epilogo);
+        enlace->destino = sucesores[i];
+        enlace->bloque = ini;
+        enlace->enlazada = 0;
+    }
+    jit_emitir_salto(jit, jit_jmp, sizeof(jit_jmp), jit->epilogo);
+
+    // Tramos frios, fuera del camino del bloque: uno por instruccion y tipo que tenga saltos
+    size_t tramos[JIT_MAX_BLOQUE][JIT_TIPOS_FRIO] = {{0}};
+    for (int s = 0; s < tr.cant_saltos; s++) {
+        const SaltoFrioJIT_t *salto = &tr.saltos[s];
+        size_t *tramo = &tramos[salto->k][salto->tipo];
+        if (*tramo == 0) {
+            *tramo = jit->usado;
+            jit_emitir_tramo_frio(jit, salto->tipo, salto->k, ini + salto->k, mem->datos[ini + salto->k],
+                                  &jit->instrucciones[primera + salto->k], rapida[salto->k], cont[salto->k]);
+        }
+        jit_parchear_salto(jit, salto->posicion, jit->codigo + *tramo);
+    }
+
+    jit->entrada[ini] = codigo;
+    jit->fin_bloque[ini] = fin;
+    jit->primera[ini] = primera;
+    jit->en_linea[ini] = (unsigned char)en_linea;
+    memset(&mem->traducida[ini], 1, n);
+    jit->bloques_compilados++;
+
+    // Se enlazan las salidas de este bloque a los sucesores ya traducidos y las de los
+    // demas bloques que esperaban a este
+    for (int e = 0; e < jit->cant_enlaces; e++) {
+        EnlaceJIT_t *enlace = &jit->enlaces[e];
+        if (enlace->enlazada || enlace->destino < 0 || jit->entrada[enlace->destino] == NULL) continue;
+        jit_parchear_salto(jit, enlace->posicion, jit->entrada[enlace->destino]);
+        enlace->enlazada = 1;
+        jit->enlaces_hechos++;
+    }
+
+    jit_proteger(jit, 0);
+
+    LOG_DEBUG(LOG_CAT_SIS, "JIT: bloque traducido [%d, %d] (%d instrucciones%s)", ini, fin, n,
+              en_linea ? ", en linea" : "");
+    return 1;
+}
+
+// Condiciones para entrar a un bloque: cabe entero en el presupuesto de ciclos y,
+// en modo usuario, la fase de busqueda no fallaria en ninguna de sus direcciones.
+// Un bloque en linea solo corre en modo usuario.
+static int jit_puede_entrar(MotorJIT_t *jit, CPU_t *cpu, int ini, int ciclos_restantes) {
+    int fin = jit->fin_bloque[ini];
+    if (fin - ini + 1 > ciclos_restantes) return 0;
+    if (cpu->PSW.modo == MODO_USUARIO) {
+        return ini >= cpu->RB && fin <= cpu->RL && fin < cpu->RX;
+    }
+    return !jit->en_linea[ini];
+}
+
+static void jit_liberar_arreglos(MotorJIT_t *jit) {
+    free(jit->entrada);
+    free(jit->fin_bloque);
+    free(jit->primera);
+    free(jit->contador);
+    free(jit->en_linea);
+}
+
+MotorJIT_t *jit_crear(int tam_memoria) {
+    MotorJIT_t *jit = calloc(1, sizeof(MotorJIT_t));
+    if (jit == NULL) return NULL;
+
+    jit->tam_memoria = tam_memoria;
+    jit->entrada = calloc(tam_memoria, sizeof(void *));
+    jit->fin_bloque = calloc(tam_memoria, sizeof(int));
+    jit->primera = calloc(tam_memoria, sizeof(int));
+    jit->contador = calloc(tam_memoria, sizeof(int));
+    jit->en_linea = calloc(tam_memoria, 1);
+    if (!jit->entrada || !jit->fin_bloque || !jit->primera || !jit->contador || !jit->en_linea) {
+        log_error(LOG_CAT_SIS, "JIT: no se pudo reservar la cache de bloques", tam_memoria);
+        jit_liberar_arreglos(jit);
+        free(jit);
+        return NULL;
+    }
+
+    void *codigo = mmap(NULL, JIT_TAM_CODIGO, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (codigo == MAP_FAILED) {
+        log_error(LOG_CAT_SIS, "JIT: no se pudo reservar el buffer ejecutable", JIT_TAM_CODIGO);
+        jit_liberar_arreglos(jit);
+        free(jit);
+        return NULL;
+    }
+    jit->codigo = codigo;
+    jit->pc_anterior = -1;
+    jit_emitir_rutinas(jit);
+    jit_proteger(jit, 0);
+    LOG_INFO(LOG_CAT_SIS, "JIT x86-64 habilitado");
+    return jit;
+}
+
+void jit_destruir(MotorJIT_t *jit) {
+    if (jit == NULL) return;
+    munmap(jit->codigo, JIT_TAM_CODIGO);
+    jit_liberar_arreglos(jit);
+    free(jit);
+}
+
+int jit_ejecutar_rafaga(MotorJIT_t *jit, CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma,
+                        int max_ciclos, EstadisticasCPU_t *est) {
+    // El modo debug necesita imprimir cada instruccion: solo interprete
+    if (cpu->modo_debug) {
+        jit->pc_anterior = -1;
+        return cpu_ejecutar_rafaga(cpu, mem, dma, max_ciclos, est);
+    }
+
+    // Los bloques con caminos en linea no escriben el log de operaciones: si el log empieza
+    // o deja de registrarlas, se traducen de nuevo
+    int registra = LOG_NIVEL_COMPILADO >= LOG_NIVEL_TRAZA && log_registra(LOG_NIVEL_TRAZA, LOG_CAT_CPU);
+    if (registra != jit->registra_operaciones) {
+        jit_vaciar(jit, mem);
+        jit->registra_operaciones = registra;
+    }
+
+    int ciclos = 0;
+    while (ciclos < max_ciclos && !cpu->interrupciones_pendientes) {
+        int pc = cpu->PSW.pc;
+        if (pc < 0 || pc >= jit->tam_memoria) break;
+
+        if (mem->traduccion_invalida) {
+            jit_revisar_invalidaciones(jit, mem);
+        }
+
+        if (jit->entrada[pc] != NULL && jit_puede_entrar(jit, cpu, pc, max_ciclos - ciclos)) {
+            // Con el perfil activo cada bloque vuelve aca para contar sus instrucciones: el
+            // presupuesto justo no deja pasar a otro bloque
+            int presupuesto = perfil_cpu.activo ? jit->fin_bloque[pc] - pc + 1 : max_ciclos - ciclos;
+            int hechos = jit->trampolin(cpu, mem, dma, presupuesto, jit->entrada[pc]);
+            if (perfil_cpu.activo) {
+                // El bloque ejecuta sus instrucciones en orden, una por ciclo
+                for (int i = 0; i < hechos; i++) {
+                    cpu_perfil_contar(&jit->instrucciones[jit->primera[pc] + i]);
+                }
+            }
+            ciclos += hechos;
+            jit->ciclos_nativos += hechos;
+            jit->pc_anterior = cpu->PSW.pc - 1;
+            continue;
+        }
+
+        // Un lider de bloque es el destino de un salto: cuenta sus ejecuciones
+        if (pc != jit->pc_anterior + 1 && jit->entrada[pc] == NULL && jit->contador[pc] >= 0 &&
+            ++jit->contador[pc] >= JIT_UMBRAL) {
+            if (jit_compilar_bloque(jit, cpu, mem, pc)) {
+                continue; // Se entra al bloque recien traducido en la siguiente vuelta
+            }
+            jit->contador[pc] = -1;
+        }
+
+        jit->pc_anterior = pc;
+        ciclos += cpu_ejecutar_rafaga(cpu, mem, dma, 1, est);
+    }
+    return ciclos;
+}
+
+#else
+
+// Sin soporte JIT en esta compilacion o arquitectura: el sistema usa solo el interprete
+MotorJIT_t *jit_crear(int tam_memoria) {
+    (void)tam_memoria;
+    return NULL;
+}
+
+void jit_destruir(MotorJIT_t *jit) {
+    (void)jit;
+}
+
+int jit_ejecutar_rafaga(MotorJIT_t *jit, CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma,
+                        int max_ciclos, EstadisticasCPU_t *est) {
+    (void)jit;
+    return cpu_ejecutar_rafaga(cpu, mem, dma, max_ciclos, est);
+}
+
+#endif
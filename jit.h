@@ -0,0 +1,73 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "tipos.h"
+#include "cpu.h"
+#include "memoria.h"
+#include "dma.h"
+#include <stddef.h>
+
+// Traductor dinamico (JIT) de bloques basicos calientes a codigo x86-64. Las instrucciones
+// frecuentes de modo usuario se emiten en linea; el resto llama a los manejadores del interprete.
+// Se habilita al compilar con "make JIT=1"; en cualquier otro caso (o en otra
+// arquitectura) jit_crear retorna NULL y el sistema usa solo el interprete.
+
+#define JIT_UMBRAL 50               // Ejecuciones interpretadas antes de traducir un bloque
+#define JIT_MAX_BLOQUE 32           // Instrucciones maximas por bloque
+#define JIT_TAM_CODIGO (1 << 22)    // Bytes del buffer ejecutable
+#define JIT_MAX_INSTRUCCIONES 16384 // Instrucciones traducidas antes de vaciar la cache
+#define JIT_MAX_ENLACES JIT_MAX_INSTRUCCIONES // Hasta dos salidas por bloque de dos o mas instrucciones
+
+typedef int (*TrampolinJIT_t)(CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma, int presupuesto, void *bloque);
+
+// Salida de un bloque hacia el bloque que empieza en destino. Su jmp va al epilogo hasta
+// que ese bloque se traduce; entonces se parchea para saltar directo a el.
+typedef struct {
+    size_t posicion;                // Desplazamiento del rel32 del jmp en el buffer
+    int destino;                    // Direccion del sucesor (-1: salida de un bloque descartado)
+    int bloque;                     // Direccion del bloque al que pertenece la salida
+    int enlazada;                   // El jmp va al sucesor y no al epilogo
+} EnlaceJIT_t;
+
+typedef struct {
+    unsigned char *codigo;          // Buffer reservado con mmap
+    size_t usado;                   // Bytes ocupados del buffer
+    size_t fin_rutinas;             // Bytes del trampolin y el epilogo (no se vacian)
+    unsigned char *epilogo;         // Salida comun de todos los bloques
+    TrampolinJIT_t trampolin;       // Entrada desde C: salva registros y salta al bloque
+
+    // Arreglos por direccion fisica, del tamaño de la memoria simulada
+    int tam_memoria;
+    void **entrada;                 // Codigo nativo del bloque que empieza en cada direccion
+    int *fin_bloque;                // Ultima direccion cubierta por ese bloque
+    int *primera;                   // Indice de su primera instruccion en instrucciones[]
+    int *contador;                  // Ejecuciones interpretadas (-1: no se puede traducir)
+    unsigned char *en_linea;        // El bloque tiene caminos rapidos en linea (solo modo usuario)
+
+    Instruccion_t instrucciones[JIT_MAX_INSTRUCCIONES]; // Copias que reciben los manejadores
+    palabra_t palabras[JIT_MAX_INSTRUCCIONES];           // Palabras de las que se tradujo cada bloque
+    int cant_instrucciones;
+    int pc_anterior;                // Ultima direccion interpretada, para detectar lideres de bloque
+    int registra_operaciones;       // El log registraba cada operacion al traducir los bloques
+    EnlaceJIT_t enlaces[JIT_MAX_ENLACES];
+    int cant_enlaces;
+
+    long bloques_compilados;
+    long bloques_invalidados;
+    long enlaces_hechos;            // Salidas parcheadas para saltar de un bloque a otro
+    long ciclos_nativos;            // Ciclos ejecutados dentro de codigo traducido
+} MotorJIT_t;
+
+// Reserva el motor, su buffer ejecutable y sus arreglos para una memoria de tam_memoria
+// palabras. Retorna NULL si el JIT no esta disponible.
+MotorJIT_t *jit_crear(int tam_memoria);
+
+// Libera el buffer y el motor
+void jit_destruir(MotorJIT_t *jit);
+
+// Igual que cpu_ejecutar_rafaga, pero ejecutando en nativo los bloques ya traducidos
+// e interpretando el resto mientras cuenta cuantas veces se entra a cada bloque.
+int jit_ejecutar_rafaga(MotorJIT_t *jit, CPU_t *cpu, Memoria_t *mem, ControladorDMA_t *dma,
+                        int max_ciclos, EstadisticasCPU_t *est);
+
+#endif
@@ -1,69 +1,260 @@
 #include "logger.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
 #include <time.h>
 #include <string.h>
+#include <sched.h>
 
-static FILE *log_file = NULL;
+// Tipos de registro (cada uno con su formato en el archivo)
+#define LOG_TIPO_MENSAJE 0
+#define LOG_TIPO_OPERACION 1
+#define LOG_TIPO_ERROR 2
+#define LOG_TIPO_INTERRUPCION 3
 
-void log_inicializar(void) {
-    log_file = fopen("sistema.log", "w");
-    if (!log_file) {
-        fprintf(stderr, "Error: No se pudo crear archivo de log\n");
+#define LOG_TAM_BUFFER (1 << 16)    // Buffer del archivo: el escritor vacia un lote por fflush
+#define LOG_ESPERA_NS 1000000       // Pausa del escritor con el anillo vacio (1 ms)
+
+// Log del hilo actual. Un hilo sin log elegido no registra nada
+static __thread Logger_t *log_hilo = NULL;
+
+//------------------------------------------------------HILO ESCRITOR-----------------------------------------------------------------------------------------------
+
+// Da formato a un registro y lo escribe en el archivo. La marca de tiempo se calcula una
+// vez por segundo.
+static void log_escribir_registro(FILE *archivo, const RegistroLog_t *r, time_t *instante_previo, char *timestamp) {
+    if (r->instante != *instante_previo) {
+        ctime_r(&r->instante, timestamp);
+        timestamp[strlen(timestamp)-1] = '\0'; // Eliminar \n
+        *instante_previo = r->instante;
+    }
+
+    switch (r->tipo) {
+        case LOG_TIPO_OPERACION:
+            fprintf(archivo, "[%s] OPERACION: %s | Op1=%d, Op2=%d, res=%d\n",
+                    timestamp, r->operacion, r->valores[0], r->valores[1], r->valores[2]);
+            break;
+        case LOG_TIPO_ERROR:
+            fprintf(archivo, "[%s] ERROR: %s (Codigo: %d)\n", timestamp, r->texto, r->valores[0]);
+            break;
+        case LOG_TIPO_INTERRUPCION:
+            fprintf(archivo, "\n");
+            fprintf(archivo, "************************************\n");
+            fprintf(archivo, "*** %s ***\n", r->texto);
+            fprintf(archivo, "************************************\n");
+            fprintf(archivo, "\n");
+            break;
+        default:
+            fprintf(archivo, "[%s] %s\n", timestamp, r->texto);
+            break;
+    }
+}
+
+// Escribe todos los registros publicados en orden. Retorna cuantos escribio
+static int log_vaciar_anillo(Logger_t *log, time_t *instante_previo, char *timestamp) {
+    int escritos = 0;
+    while (1) {
+        RegistroLog_t *r = &log->anillo[log->cabeza & (LOG_CAPACIDAD - 1)];
+        if (atomic_load_explicit(&r->secuencia, memory_order_acquire) != log->cabeza + 1) break;
+
+        log_escribir_registro(log->archivo, r, instante_previo, timestamp);
+        // La celda vuelve a quedar libre para la siguiente vuelta del anillo
+        atomic_store_explicit(&r->secuencia, log->cabeza + LOG_CAPACIDAD, memory_order_release);
+        log->cabeza++;
+        escritos++;
+    }
+    return escritos;
+}
+
+static void *log_escritor(void *arg) {
+    Logger_t *log = (Logger_t *)arg;
+    time_t instante_previo = (time_t)-1;
+    char timestamp[26] = "";
+    struct timespec espera = { 0, LOG_ESPERA_NS };
+
+    while (1) {
+        if (log_vaciar_anillo(log, &instante_previo, timestamp) > 0) {
+            fflush(log->archivo);
+            continue;
+        }
+        if (atomic_load(&log->cerrando)) {
+            // Lo que se publico antes de cerrar
+            log_vaciar_anillo(log, &instante_previo, timestamp);
+            break;
+        }
+        nanosleep(&espera, NULL);
+    }
+    fflush(log->archivo);
+    return NULL;
+}
+
+//------------------------------------------------------ANILLO DE REGISTROS-----------------------------------------------------------------------------------------
+
+// Reserva una celda del anillo para el hilo actual. Retorna NULL si no hay log, si el
+// filtro del log descarta el nivel o la categoria, o si el anillo esta lleno con la
+// politica de descartar. La celda se publica con log_publicar.
+static RegistroLog_t *log_reservar(int tipo, int nivel, unsigned int categoria) {
+    Logger_t *log = log_hilo;
+    if (!log || !log->archivo || nivel > log->nivel || !(categoria & log->categorias)) return NULL;
+
+    size_t pos = atomic_load_explicit(&log->cola, memory_order_relaxed);
+    while (1) {
+        RegistroLog_t *r = &log->anillo[pos & (LOG_CAPACIDAD - 1)];
+        size_t secuencia = atomic_load_explicit(&r->secuencia, memory_order_acquire);
+        intptr_t diferencia = (intptr_t)secuencia - (intptr_t)pos;
+
+        if (diferencia == 0) {
+            // Celda libre en este turno: se la lleva quien avance la cola primero
+            if (atomic_compare_exchange_weak_explicit(&log->cola, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                r->instante = time(NULL);
+                r->tipo = tipo;
+                return r;
+            }
+        } else if (diferencia < 0) {
+            // Anillo lleno: el escritor todavia no libero esta celda
+            if (log->politica == LOG_POLITICA_DESCARTAR) {
+                atomic_fetch_add(&log->descartados, 1);
+                return NULL;
+            }
+            sched_yield();
+            pos = atomic_load_explicit(&log->cola, memory_order_relaxed);
+        } else {
+            // Otro productor tomo la celda: reintentar con la cola actual
+            pos = atomic_load_explicit(&log->cola, memory_order_relaxed);
+        }
+    }
+}
+
+static void log_publicar(RegistroLog_t *r) {
+    size_t turno = atomic_load_explicit(&r->secuencia, memory_order_relaxed);
+    atomic_store_explicit(&r->secuencia, turno + 1, memory_order_release);
+}
+
+//------------------------------------------------------API---------------------------------------------------------------------------------------------------------
+
+void log_abrir(Logger_t *log, const char *ruta) {
+    log->archivo = NULL;
+    log->anillo = NULL;
+    log->politica = LOG_POLITICA_BLOQUEAR;
+    log->nivel = LOG_NIVEL_COMPILADO;
+    log->categorias = LOG_CAT_TODAS;
+    if (ruta == NULL) return;
+
+    log->archivo = fopen(ruta, "w");
+    if (!log->archivo) {
+        fprintf(stderr, "Error: No se pudo crear archivo de log %s\n", ruta);
         return;
     }
-    
+    setvbuf(log->archivo, NULL, _IOFBF, LOG_TAM_BUFFER);
+
+    log->anillo = malloc(LOG_CAPACIDAD * sizeof(RegistroLog_t));
+    for (size_t i = 0; log->anillo && i < LOG_CAPACIDAD; i++) {
+        atomic_init(&log->anillo[i].secuencia, i);
+    }
+    atomic_init(&log->cola, 0);
+    log->cabeza = 0;
+    atomic_init(&log->descartados, 0);
+    atomic_init(&log->cerrando, 0);
+
     time_t ahora = time(NULL);
-    fprintf(log_file, "=== Sistema iniciado: %s", ctime(&ahora));
-    fprintf(log_file, "========================================\n\n");
-    fflush(log_file);
+    char timestamp[26];
+    fprintf(log->archivo, "=== Sistema iniciado: %s", ctime_r(&ahora, timestamp));
+    fprintf(log->archivo, "========================================\n\n");
+    fflush(log->archivo);
+
+    if (!log->anillo || pthread_create(&log->escritor, NULL, log_escritor, log) != 0) {
+        fprintf(stderr, "Error: No se pudo iniciar el escritor del log %s\n", ruta);
+        free(log->anillo);
+        log->anillo = NULL;
+        fclose(log->archivo);
+        log->archivo = NULL;
+    }
 }
 
-void log_close(void) {
-    if (log_file) {
+void log_cerrar(Logger_t *log) {
+    if (log->archivo) {
+        atomic_store(&log->cerrando, 1);
+        pthread_join(log->escritor, NULL);
+
         time_t ahora = time(NULL);
-        fprintf(log_file, "\n========================================\n");
-        fprintf(log_file, "=== Sistema finalizado: %s", ctime(&ahora));
-        fclose(log_file);
-        log_file = NULL;
+        char timestamp[26];
+        long descartados = atomic_load(&log->descartados);
+        if (descartados > 0) {
+            fprintf(log->archivo, "\n=== Registros descartados (anillo lleno): %ld\n", descartados);
+        }
+        fprintf(log->archivo, "\n========================================\n");
+        fprintf(log->archivo, "=== Sistema finalizado: %s", ctime_r(&ahora, timestamp));
+        fclose(log->archivo);
+        log->archivo = NULL;
+        free(log->anillo);
+        log->anillo = NULL;
     }
+    if (log_hilo == log) log_hilo = NULL;
 }
 
-void log_mensaje(const char *mensaje) {
-    if (!log_file) return;
-    
-    time_t ahora = time(NULL);
-    char timestamp[26];
-    strcpy(timestamp, ctime(&ahora));
-    timestamp[strlen(timestamp)-1] = '\0'; // Eliminar \n
-    
-    fprintf(log_file, "[%s] %s\n", timestamp, mensaje);
-    fflush(log_file);
+void log_usar(Logger_t *log) {
+    log_hilo = log;
+}
+
+Logger_t *log_actual(void) {
+    return log_hilo;
+}
+
+int log_registra(int nivel, unsigned int categoria) {
+    Logger_t *log = log_hilo;
+    return log && log->archivo && nivel <= log->nivel && (categoria & log->categorias);
+}
+
+void log_registrar(int nivel, unsigned int categoria, const char *formato, ...) {
+    RegistroLog_t *r = log_reservar(LOG_TIPO_MENSAJE, nivel, categoria);
+    if (!r) return;
+
+    va_list args;
+    va_start(args, formato);
+    vsnprintf(r->texto, sizeof(r->texto), formato, args);
+    va_end(args);
+    log_publicar(r);
 }
 
 void log_operacion(const char *op, palabra_t op1, palabra_t op2, palabra_t res) {
-    if (!log_file) return;
-    
-    char buffer[256];
-    sprintf(buffer, "OPERACION: %s | Op1=%d, Op2=%d, res=%d", 
-            op, op1, op2, res);
-    log_mensaje(buffer);
+    RegistroLog_t *r = log_reservar(LOG_TIPO_OPERACION, LOG_NIVEL_TRAZA, LOG_CAT_CPU);
+    if (!r) return;
+
+    r->operacion = op;
+    r->valores[0] = op1;
+    r->valores[1] = op2;
+    r->valores[2] = res;
+    log_publicar(r);
 }
 
-void log_error(const char *mensaje, int codigo) {
-    if (!log_file) return;
-    
-    char buffer[256];
-    sprintf(buffer, "ERROR: %s (Codigo: %d)", mensaje, codigo);
-    log_mensaje(buffer);
+void log_error(unsigned int categoria, const char *mensaje, int codigo) {
+    RegistroLog_t *r = log_reservar(LOG_TIPO_ERROR, LOG_NIVEL_ERROR, categoria);
+    if (!r) return;
+
+    snprintf(r->texto, sizeof(r->texto), "%s", mensaje);
+    r->valores[0] = codigo;
+    log_publicar(r);
 }
 
 void log_interrupcion(const char *mensaje) {
-    if (!log_file) return;
-    
-    fprintf(log_file, "\n");
-    fprintf(log_file, "************************************\n");
-    fprintf(log_file, "*** %s ***\n", mensaje);
-    fprintf(log_file, "************************************\n");
-    fprintf(log_file, "\n");
-    fflush(log_file);
-}
\ No newline at end of file
+    RegistroLog_t *r = log_reservar(LOG_TIPO_INTERRUPCION, LOG_NIVEL_INFO, LOG_CAT_INT);
+    if (!r) return;
+
+    snprintf(r->texto, sizeof(r->texto), "%s", mensaje);
+    log_publicar(r);
+}
+
+const char *log_nombre_nivel(int nivel) {
+    static const char *nombres[] = {"error", "info", "debug", "traza"};
+    return (nivel >= LOG_NIVEL_ERROR && nivel <= LOG_NIVEL_TRAZA) ? nombres[nivel] : "?";
+}
+
+const char *log_nombre_categoria(unsigned int categoria) {
+    static const char *nombres[LOG_CANT_CATEGORIAS] = {"cpu", "mem", "dma", "planif", "int", "sis"};
+    for (int i = 0; i < LOG_CANT_CATEGORIAS; i++) {
+        if (categoria == (1u << i)) return nombres[i];
+    }
+    return "?";
+}
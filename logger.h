@@ -2,23 +2,125 @@
 #define LOGGER_H
 
 #include "tipos.h"
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
 
-// Inicializa el sistema de logging
-void log_inicializar(void);
+// Log asincrono. Los hilos que registran solo copian un registro de tamaño fijo a un
+// anillo sin cerrojos; un hilo escritor por log les da formato y los escribe en lotes.
+// Cuando el anillo se llena se aplica la politica del log: esperar o descartar.
+#define LOG_CAPACIDAD 4096      // Registros del anillo (potencia de 2)
+#define LOG_TAM_TEXTO 256       // Texto maximo de un registro
 
-// Cierra el archivo de log
-void log_close(void);
+#define LOG_POLITICA_BLOQUEAR 0  // El que registra espera lugar en el anillo (no se pierde nada)
+#define LOG_POLITICA_DESCARTAR 1 // El registro se descarta y se cuenta
 
-// Registra un mensaje general
-void log_mensaje(const char *mensaje);
+// Niveles de severidad, de menos a mas detalle. Un log registra hasta su nivel
+// (comando "log nivel <n>").
+#define LOG_NIVEL_ERROR 0
+#define LOG_NIVEL_INFO 1       // Inicializacion, procesos, interrupciones
+#define LOG_NIVEL_DEBUG 2      // Registros del DMA, particiones, eventos de la CPU
+#define LOG_NIVEL_TRAZA 3      // Cada operacion ejecutada
 
-// Registra una operacion
+// Nivel mas detallado que se compila (make LOG_NIVEL=error|info|debug|traza). Las
+// llamadas de niveles mayores desaparecen en el preprocesador, con sus argumentos.
+#ifndef LOG_NIVEL_COMPILADO
+#define LOG_NIVEL_COMPILADO LOG_NIVEL_TRAZA
+#endif
+
+// Categorias (bits): un log registra las que tenga en su mascara (comando "log categorias")
+#define LOG_CAT_CPU (1u << 0)
+#define LOG_CAT_MEM (1u << 1)
+#define LOG_CAT_DMA (1u << 2)      // DMA y disco
+#define LOG_CAT_PLANIF (1u << 3)   // Procesos, despachos y quantum
+#define LOG_CAT_INT (1u << 4)
+#define LOG_CAT_SIS (1u << 5)      // Resto del sistema (consola, JIT, SMP)
+#define LOG_CAT_TODAS 0x3Fu
+#define LOG_CANT_CATEGORIAS 6
+
+typedef struct {
+    atomic_size_t secuencia;    // Turno de la celda: libre para el productor o lista para el escritor
+    time_t instante;
+    int tipo;                   // Mensaje, operacion, error o interrupcion
+    const char *operacion;      // Nombre de la operacion (cadena estatica)
+    palabra_t valores[3];       // Operandos y resultado, o codigo de error
+    char texto[LOG_TAM_TEXTO];
+} RegistroLog_t;
+
+// Destino del log de una instancia del simulador. Cada Sistema_t tiene el suyo y los
+// hilos que trabajan para esa instancia (consola, nucleos SMP, DMA) lo eligen con
+// log_usar; asi varias instancias pueden registrar en paralelo sin mezclarse.
+typedef struct {
+    FILE *archivo;              // NULL: log deshabilitado
+    int politica;               // LOG_POLITICA_BLOQUEAR o LOG_POLITICA_DESCARTAR
+    int nivel;                  // Nivel mas detallado que se registra
+    unsigned int categorias;    // Mascara de categorias que se registran
+    RegistroLog_t *anillo;
+    atomic_size_t cola;         // Proxima celda que reserva un productor
+    size_t cabeza;              // Proxima celda que escribe el hilo escritor
+    atomic_long descartados;
+    atomic_int cerrando;
+    pthread_t escritor;
+} Logger_t;
+
+// Abre el archivo de log de la instancia y arranca su hilo escritor (ruta NULL: sin log)
+void log_abrir(Logger_t *log, const char *ruta);
+
+// Escribe lo que quede en el anillo, detiene el hilo escritor y cierra el archivo.
+// Ningun otro hilo debe estar registrando en este log.
+void log_cerrar(Logger_t *log);
+
+// Elige el log donde escribe el hilo actual
+void log_usar(Logger_t *log);
+
+// Log elegido por el hilo actual (para pasarlo a otro hilo)
+Logger_t *log_actual(void);
+
+// 1 si el log del hilo actual registraria un mensaje de ese nivel y categoria
+int log_registra(int nivel, unsigned int categoria);
+
+// Registra un mensaje con formato de printf (usar las macros LOG_INFO, LOG_DEBUG, LOG_TRAZA)
+void log_registrar(int nivel, unsigned int categoria, const char *formato, ...)
+    __attribute__((format(printf, 3, 4)));
+
+// Registra una operacion de la CPU con nivel traza (op debe ser una cadena estatica: se
+// formatea despues). Usar LOG_OPERACION.
 void log_operacion(const char *op, palabra_t op1, palabra_t op2, palabra_t res);
 
-// Registra un error
-void log_error(const char *mensaje, int codigo);
+// Registra un error (siempre se compila)
+void log_error(unsigned int categoria, const char *mensaje, int codigo);
 
-// Registra una interrupcion
+// Registra una interrupcion con nivel info (usar LOG_INTERRUPCION)
 void log_interrupcion(const char *mensaje);
 
-#endif
\ No newline at end of file
+// Nombre de un nivel o de una categoria (un solo bit) para la consola
+const char *log_nombre_nivel(int nivel);
+const char *log_nombre_categoria(unsigned int categoria);
+
+// Llamadas por nivel. Las que superan LOG_NIVEL_COMPILADO quedan en un if (0): no
+// generan codigo ni evaluan sus argumentos, pero el compilador sigue revisandolos.
+#define LOG_DESCARTADA(llamada) do { if (0) llamada; } while (0)
+
+#if LOG_NIVEL_COMPILADO >= LOG_NIVEL_INFO
+#define LOG_INFO(categoria, ...) log_registrar(LOG_NIVEL_INFO, categoria, __VA_ARGS__)
+#define LOG_INTERRUPCION(mensaje) log_interrupcion(mensaje)
+#else
+#define LOG_INFO(categoria, ...) LOG_DESCARTADA(log_registrar(LOG_NIVEL_INFO, categoria, __VA_ARGS__))
+#define LOG_INTERRUPCION(mensaje) LOG_DESCARTADA(log_interrupcion(mensaje))
+#endif
+
+#if LOG_NIVEL_COMPILADO >= LOG_NIVEL_DEBUG
+#define LOG_DEBUG(categoria, ...) log_registrar(LOG_NIVEL_DEBUG, categoria, __VA_ARGS__)
+#else
+#define LOG_DEBUG(categoria, ...) LOG_DESCARTADA(log_registrar(LOG_NIVEL_DEBUG, categoria, __VA_ARGS__))
+#endif
+
+#if LOG_NIVEL_COMPILADO >= LOG_NIVEL_TRAZA
+#define LOG_TRAZA(categoria, ...) log_registrar(LOG_NIVEL_TRAZA, categoria, __VA_ARGS__)
+#define LOG_OPERACION(op, op1, op2, res) log_operacion(op, op1, op2, res)
+#else
+#define LOG_TRAZA(categoria, ...) LOG_DESCARTADA(log_registrar(LOG_NIVEL_TRAZA, categoria, __VA_ARGS__))
+#define LOG_OPERACION(op, op1, op2, res) LOG_DESCARTADA(log_operacion(op, op1, op2, res))
+#endif
+
+#endif
@@ -1,25 +1,164 @@
 #include "sistema.h"
-#include "logger.h"
+#include "granja.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
-int main() {
+// Codigos de salida del modo por lotes
+#define SALIDA_OK 0
+#define SALIDA_FALLO 1   // Algun comando fallo o algun proceso fue abortado
+#define SALIDA_USO 2     // Argumentos invalidos
+
+static void mostrar_uso(const char *programa) {
+    printf("Uso: %s                       Consola interactiva\n", programa);
+    printf("     %s -c <comando> ...      Ejecuta el comando de consola (repetible)\n", programa);
+    printf("     %s -s <script> ...       Ejecuta los comandos de un archivo\n", programa);
+    printf("     %s -g <trabajos> [-j hilos] [-l dir_logs]\n", programa);
+    printf("                                Granja: una simulacion independiente por linea\n");
+    printf("                                (comandos separados por ';'), en paralelo\n");
+    printf("     %s -m <palabras>[,<palabras_so>][,grandes] ...\n", programa);
+    printf("                                Memoria simulada de otro tamaño (def. %d, %d del SO;\n",
+           TAM_MEMORIA_DEFECTO, MEM_SO_DEFECTO);
+    printf("                                hasta %d palabras); se combina con cualquier modo.\n",
+           TAM_MEMORIA_MAXIMA);
+    printf("                                El PC de la PSW tiene 5 digitos: el SO y los procesos\n");
+    printf("                                sin paginacion quedan debajo de %d. grandes: paginas\n",
+           LIMITE_PC_PSW);
+    printf("                                enormes del host\n");
+    printf("Las opciones se ejecutan en orden y al terminar se imprime un resumen en JSON.\n");
+    printf("La granja descarta la consola de cada simulacion, deja su log en dir_logs\n");
+    printf("(def. %s) e imprime un reporte JSON con todos los resumenes.\n", GRANJA_DIR_LOGS);
+    printf("Ejemplo: %s -c \"quantum 20\" -c \"ejecutar casos/caso_pila\" -c ps\n", programa);
+}
+
+// Geometria de la memoria: -m <palabras>[,<palabras_so>][,grandes], en cualquier posicion.
+// Se quita de argv para que los modos lean sus opciones como siempre. Retorna -1 si falta
+// el argumento o la geometria no es valida.
+static int leer_geometria(int *argc, char *argv[]) {
+    int quedan = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strcmp(argv[i], "-m") != 0) {
+            argv[quedan++] = argv[i];
+            continue;
+        }
+        if (i + 1 >= *argc) return -1;
+
+        char geometria[64];
+        snprintf(geometria, sizeof(geometria), "%s", argv[++i]);
+        int tam_memoria = 0, mem_so = MEM_SO_DEFECTO, grandes = 0;
+        char *resto;
+        char *parte = strtok_r(geometria, ",", &resto);
+        for (int campo = 0; parte != NULL; campo++, parte = strtok_r(NULL, ",", &resto)) {
+            if (strcmp(parte, "grandes") == 0) grandes = 1;
+            else if (campo == 0) tam_memoria = atoi(parte);
+            else if (campo == 1) mem_so = atoi(parte);
+            else return -1;
+        }
+        if (memoria_configurar(tam_memoria, mem_so, grandes) != 0) return -1;
+    }
+    *argc = quedan;
+    return 0;
+}
+
+// Modo por lotes: ejecuta los comandos de argv sin consola y retorna el codigo de salida
+static int ejecutar_lote(Sistema_t *sys, int argc, char *argv[]) {
+    int resultado = CONSOLA_CONTINUAR;
+    int fallo = 0;
+
+    for (int i = 1; i < argc && resultado != CONSOLA_APAGAR; i++) {
+        if (i + 1 >= argc) {
+            mostrar_uso(argv[0]);
+            return SALIDA_USO;
+        }
+        if (strcmp(argv[i], "-c") == 0) {
+            char comando[TAM_LINEA_COMANDO];
+            snprintf(comando, sizeof(comando), "%s", argv[++i]);
+            resultado = sistema_ejecutar_comando(sys, comando);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            resultado = sistema_ejecutar_script(sys, argv[++i]);
+        } else {
+            mostrar_uso(argv[0]);
+            return SALIDA_USO;
+        }
+        if (resultado == CONSOLA_ERROR) fallo = 1;
+    }
+
+    sistema_imprimir_totales(sys, stdout);
+    if (fallo || sys->totales.procesos_abortados > 0) return SALIDA_FALLO;
+    return SALIDA_OK;
+}
+
+// Granja: -g <trabajos> [-j hilos] [-l dir_logs], en cualquier orden
+static int ejecutar_granja(int argc, char *argv[]) {
+    const char *trabajos = NULL;
+    const char *dir_logs = GRANJA_DIR_LOGS;
+    int hilos = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            mostrar_uso(argv[0]);
+            return SALIDA_USO;
+        }
+        if (strcmp(argv[i], "-g") == 0) {
+            trabajos = argv[i + 1];
+        } else if (strcmp(argv[i], "-j") == 0) {
+            hilos = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            dir_logs = argv[i + 1];
+        } else {
+            mostrar_uso(argv[0]);
+            return SALIDA_USO;
+        }
+    }
+    if (trabajos == NULL || hilos < 1) {
+        mostrar_uso(argv[0]);
+        return SALIDA_USO;
+    }
+
+    int resultado = granja_ejecutar(trabajos, hilos, dir_logs, stdout);
+    if (resultado == GRANJA_ERROR) return SALIDA_USO;
+    return resultado == GRANJA_OK ? SALIDA_OK : SALIDA_FALLO;
+}
+
+int main(int argc, char *argv[]) {
 
     Sistema_t sistema;
-    
-    // Inicializar logger
-    log_inicializar();
-    
-    // Inicializar sistema
-    sistema_inicializar(&sistema);
-    
-    // Lanzar consola interactiva
-    sistema_consola(&sistema);
-    
-    // Limpiar recursos
+    int salida = SALIDA_OK;
+
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        mostrar_uso(argv[0]);
+        return SALIDA_OK;
+    }
+
+    if (leer_geometria(&argc, argv) != 0) {
+        printf("Error: Geometria de memoria invalida (hasta %d palabras en total y %d del SO; el area de usuario necesita al menos %d)\n",
+               TAM_MEMORIA_MAXIMA, LIMITE_PC_PSW, TAM_PILA);
+        mostrar_uso(argv[0]);
+        return SALIDA_USO;
+    }
+
+    // La granja crea sus propias instancias del sistema
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-g") == 0) return ejecutar_granja(argc, argv);
+    }
+
+    // Inicializar sistema (con su log)
+    if (sistema_inicializar(&sistema, "sistema.log") != 0) {
+        printf("Error: No se pudo reservar la memoria simulada (%d palabras)\n", geometria_memoria.tam_memoria);
+        return SALIDA_FALLO;
+    }
+
+    if (argc > 1) {
+        // Comandos desde la linea de comandos o un script
+        salida = ejecutar_lote(&sistema, argc, argv);
+    } else {
+        // Lanzar consola interactiva
+        sistema_consola(&sistema);
+    }
+
+    // Limpiar recursos (cierra el log)
     sistema_limpiar(&sistema);
-    
-    log_close();
-    
-    return 0;
-}
\ No newline at end of file
+
+    return salida;
+}
@@ -1,94 +1,471 @@
 #include "memoria.h"
+#include "cpu.h"
 #include "logger.h"
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <sys/mman.h>
 
-void memoria_inicializar(Memoria_t *mem) {
-    int i;
+// Marca (ocupar = 1) o libera (ocupar = 0) las palabras [inicio, fin) en el mapa de
+// ocupacion, de a una palabra del mapa por vez, y suma al contador solo los bits que
+// cambiaron. Las del area del SO ya estan en 1 y nunca se liberan, asi que no lo alteran.
+static void memoria_marcar(Memoria_t *mem, int inicio, int fin, int ocupar) {
+    int i = inicio;
+    while (i < fin) {
+        int bit = i % BITS_MAPA;
+        int cant = BITS_MAPA - bit;
+        if (cant > fin - i) cant = fin - i;
+        uint32_t mascara = (cant == BITS_MAPA ? ~0u : (1u << cant) - 1) << bit;
 
-    // Pone toda la memoria en 0
-    for (i = 0; i < TAM_MEMORIA; i++) {
-        mem->datos[i] = 0;
-        mem->ocupado[i] = 0;
+        uint32_t *palabra = &mem->ocupado[i / BITS_MAPA];
+        uint32_t cambian = ocupar ? mascara & ~*palabra : mascara & *palabra;
+        int cant_cambian = __builtin_popcount(cambian);
+        mem->ocupadas_usuario += ocupar ? cant_cambian : -cant_cambian;
+        *palabra ^= cambian;
+        i += cant;
     }
-    
-    // Marca la zona como area reservada para el Sistema Operativo
-    for (i = 0; i < MEM_SO; i++) {
-        mem->ocupado[i] = 1;
+}
+
+GeometriaMemoria_t geometria_memoria = { TAM_MEMORIA_DEFECTO, MEM_SO_DEFECTO, 0 };
+
+// Tamaño de las paginas enormes del host que se piden con MAP_HUGETLB (x86-64)
+#define TAM_PAGINA_ENORME (2u << 20)
+
+int memoria_configurar(int tam_memoria, int mem_so, int paginas_grandes) {
+    if (tam_memoria > TAM_MEMORIA_MAXIMA || mem_so < 1 || mem_so > LIMITE_PC_PSW ||
+        tam_memoria - mem_so < TAM_PILA) {
+        return -1;
     }
+    geometria_memoria.tam_memoria = tam_memoria;
+    geometria_memoria.mem_so = mem_so;
+    geometria_memoria.paginas_grandes = paginas_grandes;
+    return 0;
+}
+
+// Reparte la region entre los arreglos, cada uno alineado a una linea de cache. Con region
+// NULL solo calcula el tamaño total.
+static size_t memoria_repartir(Memoria_t *mem, unsigned char *region) {
+    size_t desplazamiento = 0;
+    size_t palabras_mapa = (mem->tam_memoria + BITS_MAPA - 1) / BITS_MAPA;
+    struct { void **arreglo; size_t tam; } partes[] = {
+        { (void **)&mem->datos, mem->tam_memoria * sizeof(palabra_t) },
+        { (void **)&mem->ocupado, palabras_mapa * sizeof(uint32_t) },
+        { (void **)&mem->huecos, mem->max_huecos * sizeof(Hueco_t) },
+        { (void **)&mem->decodificadas, mem->tam_memoria * sizeof(Instruccion_t) },
+        { (void **)&mem->decodificada_valida, (size_t)mem->tam_memoria },
+        { (void **)&mem->fusion, (size_t)mem->tam_memoria },
+        { (void **)&mem->traducida, (size_t)mem->tam_memoria },
+    };
+    for (size_t i = 0; i < sizeof(partes) / sizeof(partes[0]); i++) {
+        if (region != NULL) *partes[i].arreglo = region + desplazamiento;
+        desplazamiento += (partes[i].tam + 63) & ~(size_t)63;
+    }
+    return desplazamiento;
+}
+
+// Estado inicial sobre una region en 0: area del SO ocupada y un solo hueco de usuario
+static void memoria_preparar_areas(Memoria_t *mem) {
+    mem->traduccion_invalida = 0;
+
+    // Marca la zona como area reservada para el Sistema Operativo (no cuenta como usuario)
+    memoria_marcar(mem, 0, mem->mem_so, 1);
+    mem->ocupadas_usuario = 0;
+
+    // Toda el area de usuario es un solo hueco
+    mem->huecos[0].inicio = mem->mem_so;
+    mem->huecos[0].tam = mem->tam_usuario;
+    mem->cant_huecos = 1;
+    mem->politica = AJUSTE_DEFECTO;
+    mem->cursor = mem->mem_so;
+    memset(&mem->estadisticas, 0, sizeof(mem->estadisticas));
     
-    log_mensaje("Memoria inicializada");
+    LOG_INFO(LOG_CAT_MEM, "Memoria inicializada");
+}
+
+int memoria_inicializar(Memoria_t *mem) {
+    // Al reiniciar el sistema se conserva la region (la geometria no cambia): el host la
+    // devuelve en 0 sin que haya que recorrerla
+    if (mem->region != NULL) {
+        madvise(mem->region, mem->tam_region, MADV_DONTNEED);
+        memoria_preparar_areas(mem);
+        return 0;
+    }
+
+    mem->tam_memoria = geometria_memoria.tam_memoria;
+    mem->mem_so = geometria_memoria.mem_so;
+    mem->tam_usuario = mem->tam_memoria - mem->mem_so;
+    mem->max_huecos = mem->tam_usuario / TAM_PAGINA + 1;
+
+    // Una region anonima ya viene en 0 (datos, mapa, fusiones y marcas del JIT) y el host
+    // solo entrega las paginas que se tocan: no hace falta recorrer la memoria al iniciar.
+    // Con paginas enormes se intenta MAP_HUGETLB; si el host no tiene reservadas se usa una
+    // region normal y se sugieren las paginas enormes transparentes.
+    size_t tam = memoria_repartir(mem, NULL);
+    void *region = MAP_FAILED;
+    mem->paginas_grandes = 0;
+    if (geometria_memoria.paginas_grandes) {
+        tam = (tam + TAM_PAGINA_ENORME - 1) & ~(size_t)(TAM_PAGINA_ENORME - 1);
+        region = mmap(NULL, tam, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        mem->paginas_grandes = region != MAP_FAILED;
+    }
+    if (region == MAP_FAILED) {
+        region = mmap(NULL, tam, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) {
+            log_error(LOG_CAT_MEM, "No se pudo reservar la memoria simulada", mem->tam_memoria);
+            return -1;
+        }
+        if (geometria_memoria.paginas_grandes) madvise(region, tam, MADV_HUGEPAGE);
+    }
+    mem->region = region;
+    mem->tam_region = tam;
+    memoria_repartir(mem, region);
+    LOG_DEBUG(LOG_CAT_MEM, "Memoria reservada: %d palabras (%d del SO), %zu KiB del host%s",
+              mem->tam_memoria, mem->mem_so, tam / 1024, mem->paginas_grandes ? " en paginas enormes" : "");
+    memoria_preparar_areas(mem);
+    return 0;
+}
+
+void memoria_liberar(Memoria_t *mem) {
+    if (mem->region == NULL) return;
+    munmap(mem->region, mem->tam_region);
+    mem->region = NULL;
 }
 
 palabra_t memoria_leer(Memoria_t *mem, int direccion) {
-    if (direccion < 0 || direccion >= TAM_MEMORIA) {
-        log_error("Direccion de memoria invalida en lectura", direccion);
+    if (direccion < 0 || direccion >= mem->tam_memoria) {
+        log_error(LOG_CAT_MEM, "Direccion de memoria invalida en lectura", direccion);
         return 0;
     }
     return mem->datos[direccion];
 }
 
 void memoria_escribir(Memoria_t *mem, int direccion, palabra_t dato) {
-    if (direccion < 0 || direccion >= TAM_MEMORIA) {
-        log_error("Direccion de memoria invalida en escritura", direccion);
+    if (direccion < 0 || direccion >= mem->tam_memoria) {
+        log_error(LOG_CAT_MEM, "Direccion de memoria invalida en escritura", direccion);
         return;
     }
     mem->datos[direccion] = dato;
+    memoria_invalidar_decodificada(mem, direccion);
 }
 
 int memoria_cargar_desde_buffer(Memoria_t *mem, const palabra_t *buffer, int cant_palabras, int dir_inicio) {
-    if (dir_inicio + cant_palabras > TAM_MEMORIA) {
-        log_error("Fallo al escribir en memoria: supera el limite", dir_inicio);
+    if (dir_inicio + cant_palabras > mem->tam_memoria) {
+        log_error(LOG_CAT_MEM, "Fallo al escribir en memoria: supera el limite", dir_inicio);
         return -1;
     }
 
+    memoria_marcar(mem, dir_inicio, dir_inicio + cant_palabras, 1);
     for (int i = 0; i < cant_palabras; i++) {
-        mem->datos[dir_inicio + i] = buffer[i];
-        mem->ocupado[dir_inicio + i] = 1;
+        mem->datos[dir_inicio + i] = sm_a_palabra(buffer[i]);
+        memoria_invalidar_decodificada(mem, dir_inicio + i);
         
-        char msg[200];
-        sprintf(msg, "Cargado en RAM[%d]: %08d", dir_inicio + i, buffer[i]);
-        log_mensaje(msg);
+        LOG_TRAZA(LOG_CAT_MEM, "Cargado en RAM[%d]: %08d", dir_inicio + i, buffer[i]);
     }
+
+    // El codigo no cambia despues de cargarse: se decodifica una sola vez aqui
+    memoria_predecodificar(mem, dir_inicio, cant_palabras);
     
     return dir_inicio;
 }
 
-int memoria_asignar_espacio(Memoria_t *mem, int tam_requerido) {
-    // Si el tamano excede la particion estatica, falla directamente
-    if (tam_requerido > TAM_PARTICION) {
-        return -1;
+void memoria_predecodificar(Memoria_t *mem, int dir_inicio, int cant_palabras) {
+    if (dir_inicio < 0 || dir_inicio + cant_palabras > mem->tam_memoria) return;
+
+    int fin = dir_inicio + cant_palabras;
+    for (int i = dir_inicio; i < fin; i++) {
+        mem->decodificadas[i] = cpu_decodificar_instruccion(palabra_a_sm(mem->datos[i]));
+        mem->decodificada_valida[i] = 1;
     }
 
-    // Busqueda de una particion libre (Particionamiento estatico puro)
-    for (int p = 0; p < MAX_PROCESOS; p++) {
-        int inicio = MEM_SO + (p * TAM_PARTICION);
-        
-        // Verificamos el bloque buscando la primera partición que no esté ocupada
-        if (mem->ocupado[inicio] == 0) {
-            
-            // Se encontró partición libre. Se marca toda la partición estática como ocupada.
-            for (int i = inicio; i < inicio + TAM_PARTICION; i++) {
-                mem->ocupado[i] = 1;
+    // Con el tramo ya decodificado se buscan las secuencias que se pueden fusionar
+    for (int i = dir_inicio; i < fin; i++) {
+        mem->fusion[i] = cpu_detectar_fusion(&mem->decodificadas[i], fin - i);
+    }
+}
+
+void memoria_invalidar_decodificada(Memoria_t *mem, int direccion) {
+    if (direccion < 0 || direccion >= mem->tam_memoria) return;
+    mem->decodificada_valida[direccion] = 0;
+
+    // Toda superinstruccion que incluya esta palabra deja de ser valida
+    for (int i = direccion; i >= 0 && i > direccion - 3; i--) {
+        mem->fusion[i] = FUSION_NINGUNA;
+    }
+
+    if (mem->traducida[direccion]) {
+        mem->traduccion_invalida = 1;
+    }
+}
+
+// Palabras que un pedido se lleva del hueco: todo el hueco si el sobrante no sirve como hueco
+static int memoria_tam_entregado(const Hueco_t *hueco, int tam_requerido) {
+    return hueco->tam - tam_requerido < HUECO_MINIMO ? hueco->tam : tam_requerido;
+}
+
+// Si el pedido cabe en el hueco y el bloque que se entregaria termina antes de tope
+static int memoria_hueco_sirve(const Hueco_t *hueco, int tam_requerido, int tope) {
+    return hueco->tam >= tam_requerido && hueco->inicio + memoria_tam_entregado(hueco, tam_requerido) <= tope;
+}
+
+// Busca el hueco para un pedido segun la politica. Retorna su posicion en la lista o -1 y
+// suma en revisados los huecos que miro.
+static int memoria_buscar_hueco(Memoria_t *mem, int tam_requerido, int tope, long *revisados) {
+    int cant = mem->cant_huecos;
+    int elegido = -1;
+
+    if (mem->politica == AJUSTE_MEJOR) {
+        for (int h = 0; h < cant; h++) {
+            if (memoria_hueco_sirve(&mem->huecos[h], tam_requerido, tope) &&
+                (elegido == -1 || mem->huecos[h].tam < mem->huecos[elegido].tam)) {
+                elegido = h;
             }
-            
-            char msg[200];
-            sprintf(msg, "Memoria asignada (Particion %d): RAM[%d] a RAM[%d]", p + 1, inicio, inicio + TAM_PARTICION - 1);
-            log_mensaje(msg);
-            
-            return inicio; // Retorna la base física
         }
+        *revisados += cant;
+        return elegido;
+    }
+
+    // Primer ajuste empieza por el hueco mas bajo; siguiente ajuste por el primero que
+    // termina despues del cursor, y da la vuelta
+    int desde = 0;
+    if (mem->politica == AJUSTE_SIGUIENTE) {
+        while (desde < cant && mem->huecos[desde].inicio + mem->huecos[desde].tam <= mem->cursor) desde++;
+        if (desde == cant) desde = 0;
     }
-    return -1; // No hay particiones libres
+    for (int k = 0; k < cant; k++) {
+        int h = (desde + k) % cant;
+        (*revisados)++;
+        if (memoria_hueco_sirve(&mem->huecos[h], tam_requerido, tope)) {
+            elegido = h;
+            break;
+        }
+    }
+    return elegido;
 }
 
-void memoria_liberar_espacio(Memoria_t *mem, int base, int limite) {
-    if (base < MEM_SO || limite >= TAM_MEMORIA || base > limite) return;
+int memoria_asignar_espacio(Memoria_t *mem, int tam_requerido, int tope, int *tam_asignado) {
+    struct timespec t_inicio, t_fin;
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+
+    int base = -1;
+    int h = tam_requerido > 0 ? memoria_buscar_hueco(mem, tam_requerido, tope, &mem->estadisticas.huecos_revisados) : -1;
+    if (h != -1) {
+        Hueco_t *hueco = &mem->huecos[h];
+        base = hueco->inicio;
+        if (memoria_tam_entregado(hueco, tam_requerido) == hueco->tam) {
+            // El sobrante no sirve como hueco: se entrega entero y se saca de la lista
+            *tam_asignado = hueco->tam;
+            memmove(&mem->huecos[h], &mem->huecos[h + 1], (mem->cant_huecos - h - 1) * sizeof(Hueco_t));
+            mem->cant_huecos--;
+        } else {
+            *tam_asignado = tam_requerido;
+            hueco->inicio += tam_requerido;
+            hueco->tam -= tam_requerido;
+        }
+        mem->cursor = base + *tam_asignado;
+        memoria_marcar(mem, base, base + *tam_asignado, 1);
+        mem->estadisticas.asignaciones++;
+
+        LOG_DEBUG(LOG_CAT_MEM, "Memoria asignada (ajuste %s): RAM[%d] a RAM[%d]",
+                  memoria_nombre_ajuste(mem->politica), base, base + *tam_asignado - 1);
+    } else {
+        mem->estadisticas.fallos++;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t_fin);
+    mem->estadisticas.segundos += (t_fin.tv_sec - t_inicio.tv_sec) + (t_fin.tv_nsec - t_inicio.tv_nsec) / 1e9;
+    return base;
+}
+
+int memoria_hay_espacio(Memoria_t *mem, int tam_requerido, int tope) {
+    long revisados = 0;
+    return tam_requerido > 0 && memoria_buscar_hueco(mem, tam_requerido, tope, &revisados) != -1;
+}
+
+int memoria_asignar_en(Memoria_t *mem, int base, int tam) {
+    int h = 0;
+    while (h < mem->cant_huecos && mem->huecos[h].inicio + mem->huecos[h].tam <= base) h++;
+    if (tam <= 0 || h == mem->cant_huecos || mem->huecos[h].inicio > base ||
+        base + tam > mem->huecos[h].inicio + mem->huecos[h].tam) {
+        return -1;
+    }
+
+    // Lo que queda antes y despues del rango sigue siendo hueco
+    Hueco_t *hueco = &mem->huecos[h];
+    int antes = base - hueco->inicio;
+    int despues = hueco->inicio + hueco->tam - (base + tam);
+    if (antes > 0 && despues > 0) {
+        if (mem->cant_huecos == mem->max_huecos) return -1;
+        memmove(&mem->huecos[h + 1], &mem->huecos[h], (mem->cant_huecos - h) * sizeof(Hueco_t));
+        mem->cant_huecos++;
+        mem->huecos[h].tam = antes;
+        mem->huecos[h + 1].inicio = base + tam;
+        mem->huecos[h + 1].tam = despues;
+    } else if (antes > 0) {
+        hueco->tam = antes;
+    } else if (despues > 0) {
+        hueco->inicio = base + tam;
+        hueco->tam = despues;
+    } else {
+        memmove(&mem->huecos[h], &mem->huecos[h + 1], (mem->cant_huecos - h - 1) * sizeof(Hueco_t));
+        mem->cant_huecos--;
+    }
+
+    memoria_marcar(mem, base, base + tam, 1);
+    LOG_DEBUG(LOG_CAT_MEM, "Memoria asignada en su base: RAM[%d] a RAM[%d]", base, base + tam - 1);
+    return 0;
+}
+
+// Devuelve el bloque a la lista de huecos. Retorna 0 si se pudo.
+static int memoria_devolver_espacio(Memoria_t *mem, int base, int limite) {
+    if (base < mem->mem_so || limite >= mem->tam_memoria || base > limite) return -1;
+    int tam = limite - base + 1;
+
+    // Posicion del bloque en la lista ordenada y fusion con los huecos que lo tocan
+    int h = 0;
+    while (h < mem->cant_huecos && mem->huecos[h].inicio < base) h++;
+    int con_anterior = h > 0 && mem->huecos[h - 1].inicio + mem->huecos[h - 1].tam == base;
+    int con_siguiente = h < mem->cant_huecos && base + tam == mem->huecos[h].inicio;
+
+    if (con_anterior && con_siguiente) {
+        mem->huecos[h - 1].tam += tam + mem->huecos[h].tam;
+        memmove(&mem->huecos[h], &mem->huecos[h + 1], (mem->cant_huecos - h - 1) * sizeof(Hueco_t));
+        mem->cant_huecos--;
+    } else if (con_anterior) {
+        mem->huecos[h - 1].tam += tam;
+    } else if (con_siguiente) {
+        mem->huecos[h].inicio = base;
+        mem->huecos[h].tam += tam;
+    } else if (mem->cant_huecos < mem->max_huecos) {
+        memmove(&mem->huecos[h + 1], &mem->huecos[h], (mem->cant_huecos - h) * sizeof(Hueco_t));
+        mem->huecos[h].inicio = base;
+        mem->huecos[h].tam = tam;
+        mem->cant_huecos++;
+    } else {
+        // No deberia pasar: el bloque queda ocupado antes que perderlo de la lista
+        log_error(LOG_CAT_MEM, "Lista de huecos llena al liberar", base);
+        return -1;
+    }
+
+    memoria_marcar(mem, base, limite + 1, 0);
     for (int i = base; i <= limite; i++) {
-        mem->ocupado[i] = 0;
         mem->datos[i] = 0;
+        memoria_invalidar_decodificada(mem, i);
+    }
+    LOG_DEBUG(LOG_CAT_MEM, "Memoria liberada: RAM[%d] a RAM[%d]", base, limite);
+    return 0;
+}
+
+void memoria_liberar_espacio(Memoria_t *mem, int base, int limite) {
+    if (memoria_devolver_espacio(mem, base, limite) == 0) mem->estadisticas.liberaciones++;
+}
+
+void memoria_desalojar_espacio(Memoria_t *mem, int base, int limite) {
+    memoria_devolver_espacio(mem, base, limite);
+}
+
+// Toma un marco del mismo asignador que las particiones variables. Retorna -1 si no hay.
+static int memoria_ocupar_marco(Memoria_t *mem) {
+    int tam = 0;
+    int marco = memoria_asignar_espacio(mem, TAM_PAGINA, mem->tam_memoria, &tam);
+    if (marco == -1) return -1;
+    if (tam > TAM_PAGINA) {
+        // El sobrante de un hueco casi justo vuelve a la lista: el marco mide una pagina
+        memoria_liberar_espacio(mem, marco + TAM_PAGINA, marco + tam - 1);
+    }
+    return marco;
+}
+
+int memoria_cargar_pagina(Memoria_t *mem, TablaPaginas_t *tabla, int pagina) {
+    if (pagina < 0 || pagina >= tabla->cant_paginas) return -1;
+    if (tabla->marcos[pagina] >= 0) return tabla->marcos[pagina];
+
+    SegmentoCodigo_t *segmento = tabla->segmento;
+    int compartida = segmento != NULL && pagina < segmento->cant_paginas;
+    if (compartida && segmento->marcos[pagina] >= 0) {
+        // Otro proceso del mismo programa ya la cargo
+        tabla->marcos[pagina] = segmento->marcos[pagina];
+        tabla->compartida[pagina] = 1;
+        mem->estadisticas.paginas_compartidas++;
+        LOG_DEBUG(LOG_CAT_MEM, "Pagina %d compartida en el marco RAM[%d]", pagina, tabla->marcos[pagina]);
+        return tabla->marcos[pagina];
     }
-    char msg[200];
-    sprintf(msg, "Memoria liberada: RAM[%d] a RAM[%d]", base, limite);
-    log_mensaje(msg);
-}
\ No newline at end of file
+
+    int marco = memoria_ocupar_marco(mem);
+    if (marco == -1) return -1;
+
+    // La memoria libre esta en 0: solo se copia la parte de la pagina que tiene codigo
+    int desde = pagina * TAM_PAGINA;
+    int cant = tabla->tam_imagen - desde;
+    if (cant > TAM_PAGINA) cant = TAM_PAGINA;
+    if (cant > 0) {
+        memoria_cargar_desde_buffer(mem, tabla->imagen + desde, cant, marco);
+    }
+    tabla->marcos[pagina] = marco;
+    if (compartida) {
+        segmento->marcos[pagina] = marco;
+        tabla->compartida[pagina] = 1;
+    }
+    mem->estadisticas.paginas_cargadas++;
+
+    LOG_DEBUG(LOG_CAT_MEM, "Pagina %d cargada en el marco RAM[%d] a RAM[%d]", pagina, marco, marco + TAM_PAGINA - 1);
+    return marco;
+}
+
+void memoria_tomar_segmento(TablaPaginas_t *tabla, int cant_paginas) {
+    SegmentoCodigo_t *segmento = tabla->segmento;
+    if (segmento->referencias++ == 0) {
+        segmento->cant_paginas = cant_paginas;
+        for (int p = 0; p < cant_paginas; p++) segmento->marcos[p] = -1;
+    }
+}
+
+int memoria_copiar_pagina(Memoria_t *mem, TablaPaginas_t *tabla, int pagina) {
+    int marco = memoria_ocupar_marco(mem);
+    if (marco == -1) return -1;
+
+    // Las paginas compartidas estan llenas de codigo: se copian enteras (y se predecodifican)
+    palabra_t copia[TAM_PAGINA];
+    int origen = tabla->marcos[pagina];
+    for (int i = 0; i < TAM_PAGINA; i++) copia[i] = palabra_a_sm(mem->datos[origen + i]);
+    memoria_cargar_desde_buffer(mem, copia, TAM_PAGINA, marco);
+
+    tabla->marcos[pagina] = marco;
+    tabla->compartida[pagina] = 0;
+    mem->estadisticas.copias_escritura++;
+
+    LOG_DEBUG(LOG_CAT_MEM, "Pagina %d copiada del marco compartido RAM[%d] a RAM[%d]", pagina, origen, marco);
+    return marco;
+}
+
+void memoria_liberar_paginas(Memoria_t *mem, TablaPaginas_t *tabla) {
+    for (int p = 0; p < tabla->cant_paginas; p++) {
+        if (tabla->marcos[p] >= 0 && !tabla->compartida[p]) {
+            memoria_liberar_espacio(mem, tabla->marcos[p], tabla->marcos[p] + TAM_PAGINA - 1);
+        }
+        tabla->marcos[p] = -1;
+        tabla->compartida[p] = 0;
+    }
+
+    SegmentoCodigo_t *segmento = tabla->segmento;
+    tabla->segmento = NULL;
+    if (segmento == NULL || --segmento->referencias > 0) return;
+    for (int p = 0; p < segmento->cant_paginas; p++) {
+        if (segmento->marcos[p] >= 0) {
+            memoria_liberar_espacio(mem, segmento->marcos[p], segmento->marcos[p] + TAM_PAGINA - 1);
+            segmento->marcos[p] = -1;
+        }
+    }
+}
+
+const char *memoria_nombre_ajuste(int politica) {
+    static const char *nombres[] = {"primero", "mejor", "siguiente"};
+    return (politica >= AJUSTE_PRIMERO && politica <= AJUSTE_SIGUIENTE) ? nombres[politica] : NULL;
+}
+
+int memoria_mayor_hueco(const Memoria_t *mem) {
+    int mayor = 0;
+    for (int h = 0; h < mem->cant_huecos; h++) {
+        if (mem->huecos[h].tam > mayor) mayor = mem->huecos[h].tam;
+    }
+    return mayor;
+}
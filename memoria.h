@@ -2,15 +2,103 @@
 #define MEMORIA_H
 
 #include "tipos.h"
+#include <stddef.h>
 
-// Estructura para control de memoria
+// Mapa de ocupacion: un bit por palabra de memoria
+#define BITS_MAPA 32
+
+// Politicas de ubicacion del asignador de memoria de usuario (comando "ajuste")
+#define AJUSTE_PRIMERO 0        // El primer hueco que alcance
+#define AJUSTE_MEJOR 1          // El hueco mas chico que alcance
+#define AJUSTE_SIGUIENTE 2      // El primero que alcance a partir de la ultima asignacion
+#define AJUSTE_DEFECTO AJUSTE_PRIMERO
+
+// Un sobrante menor no se deja como hueco: se entrega con el bloque (fragmentacion interna)
+#define HUECO_MINIMO 4
+
+// Geometria de la memoria simulada, elegida al arrancar (opcion -m de main). Todas las
+// instancias del sistema (tambien las de la granja) la toman al inicializar su memoria.
+typedef struct {
+    int tam_memoria;            // Palabras de la RAM
+    int mem_so;                 // Primeras palabras, reservadas para el SO
+    int paginas_grandes;        // Pedir al host paginas enormes para los arreglos de la memoria
+} GeometriaMemoria_t;
+
+extern GeometriaMemoria_t geometria_memoria;
+
+// Tramo libre del area de usuario
+typedef struct {
+    int inicio;
+    int tam;
+} Hueco_t;
+
+// Estadisticas del asignador (memestat)
 typedef struct {
-    palabra_t datos[TAM_MEMORIA];
-    int ocupado[TAM_MEMORIA];
+    long asignaciones;
+    long fallos;                // Pedidos sin un hueco suficiente
+    long liberaciones;
+    long huecos_revisados;      // Huecos mirados por todas las busquedas
+    double segundos;            // Tiempo total dentro de memoria_asignar_espacio
+    long paginas_cargadas;      // Marcos ocupados por paginas (al crear o por demanda)
+    long fallos_pagina;         // INT_FALLO_PAGINA atendidos
+    long paginas_compartidas;   // Paginas de codigo resueltas con el marco ya cargado de otro proceso
+    long copias_escritura;      // Paginas compartidas que un proceso copio al escribirlas
+} EstadisticasMemoria_t;
+
+// Estructura para control de memoria. Los arreglos por palabra se reservan juntos en una
+// region de mmap del tamaño de la geometria (el host pone las paginas en 0 al tocarlas).
+typedef struct {
+    int tam_memoria;                    // Palabras de la RAM
+    int mem_so;                         // RAM[0] a RAM[mem_so - 1]: area del SO
+    int tam_usuario;                    // tam_memoria - mem_so
+    void *region;                       // Region de mmap con todos los arreglos
+    size_t tam_region;
+    int paginas_grandes;                // La region quedo respaldada por paginas enormes
+
+    palabra_t *datos;
+    uint32_t *ocupado;                  // Bit en 1: palabra asignada (el area del SO siempre)
+    int ocupadas_usuario;               // Bits en 1 del area de usuario, al dia con el mapa
+
+    // Asignador de particiones variables: lista de huecos ordenada por direccion. Al
+    // liberar un bloque se fusiona con los huecos vecinos. Los bloques asignados
+    // (particiones o marcos de pagina) miden al menos TAM_PAGINA palabras: hay a lo sumo
+    // uno mas de huecos que de bloques entre ellos.
+    Hueco_t *huecos;
+    int max_huecos;
+    int cant_huecos;
+    int politica;                       // AJUSTE_PRIMERO, AJUSTE_MEJOR o AJUSTE_SIGUIENTE
+    int cursor;                         // Donde retoma la busqueda AJUSTE_SIGUIENTE
+    EstadisticasMemoria_t estadisticas;
+
+    // Cache de instrucciones predecodificadas, indexada por direccion fisica.
+    // Cada particion tiene su tramo de codigo decodificado al cargar el programa.
+    Instruccion_t *decodificadas;
+    unsigned char *decodificada_valida; // 1 si la entrada coincide con datos[]
+    unsigned char *fusion;              // Superinstruccion que comienza en cada direccion
+
+    // Palabras cubiertas por bloques traducidos a codigo nativo (JIT). Al escribir
+    // en una de ellas se levanta traduccion_invalida para que el JIT descarte el bloque.
+    unsigned char *traducida;
+    int traduccion_invalida;
 } Memoria_t;
 
-// Inicializa la memoria
-void memoria_inicializar(Memoria_t *mem);
+// 1 si la palabra de la direccion esta asignada
+static inline int memoria_ocupada(const Memoria_t *mem, int direccion) {
+    return (mem->ocupado[direccion / BITS_MAPA] >> (direccion % BITS_MAPA)) & 1;
+}
+
+// Fija la geometria de las memorias que se inicialicen despues. Retorna -1 (sin cambiarla)
+// si no es valida: el area de usuario debe alojar al menos una pila, el total no puede
+// pasar de TAM_MEMORIA_MAXIMA ni el area del SO de LIMITE_PC_PSW.
+int memoria_configurar(int tam_memoria, int mem_so, int paginas_grandes);
+
+// Deja la memoria en 0 con el area del SO ocupada. La primera vez (region en NULL) reserva
+// los arreglos segun geometria_memoria; despues reutiliza la region. Retorna -1 si el host
+// no tiene memoria para la region.
+int memoria_inicializar(Memoria_t *mem);
+
+// Devuelve la region de la memoria al host
+void memoria_liberar(Memoria_t *mem);
 
 // Lee de memoria
 palabra_t memoria_leer(Memoria_t *mem, int direccion);
@@ -24,10 +112,69 @@ int memoria_cargar_programa(Memoria_t *mem, const char *archivo, int dir_inicio,
 // Carga programa desde un buffer
 int memoria_cargar_desde_buffer(Memoria_t *mem, const palabra_t *buffer, int cant_palabras, int dir_inicio);
 
-// Asigna espacio en memoria
-int memoria_asignar_espacio(Memoria_t *mem, int tam_requerido);
+// Decodifica por adelantado un tramo de memoria (codigo recien cargado)
+void memoria_predecodificar(Memoria_t *mem, int dir_inicio, int cant_palabras);
+
+// Invalida la instruccion predecodificada de una direccion tras escribir en ella
+void memoria_invalidar_decodificada(Memoria_t *mem, int direccion);
+
+// Asigna un bloque contiguo de al menos tam_requerido palabras segun la politica de ajuste,
+// terminado antes de la direccion tope. Retorna la base fisica (-1 si ningun hueco alcanza) y
+// deja en tam_asignado el tamaño real del bloque, que puede incluir un sobrante menor que
+// HUECO_MINIMO.
+int memoria_asignar_espacio(Memoria_t *mem, int tam_requerido, int tope, int *tam_asignado);
 
-// Libera espacio en memoria
+// 1 si memoria_asignar_espacio encontraria hueco para el pedido; no asigna ni cuenta nada
+int memoria_hay_espacio(Memoria_t *mem, int tam_requerido, int tope);
+
+// Tope para el bloque de un proceso sin paginacion: su PC fisico tiene que caber en la PSW
+static inline int memoria_tope_contiguo(const Memoria_t *mem) {
+    return mem->tam_memoria < LIMITE_PC_PSW ? mem->tam_memoria : LIMITE_PC_PSW;
+}
+
+// Asigna exactamente [base, base + tam) si todo el rango esta dentro de un hueco (el
+// intercambio trae un proceso de vuelta a su base). Retorna 0 o -1 si no esta libre.
+// Como memoria_desalojar_espacio, no entra en las estadisticas del asignador: las
+// entradas y salidas se cuentan en el area de intercambio.
+int memoria_asignar_en(Memoria_t *mem, int base, int tam);
+
+// Devuelve el bloque [base, limite] a la lista de huecos y borra su contenido
 void memoria_liberar_espacio(Memoria_t *mem, int base, int limite);
 
+// Igual que memoria_liberar_espacio para un proceso que sale al intercambio
+void memoria_desalojar_espacio(Memoria_t *mem, int base, int limite);
+
+// Direccion fisica de una direccion virtual segun la tabla de paginas, sin pasar por la
+// TLB. Sin tabla la direccion ya es fisica. -1 si queda fuera del espacio del proceso o su
+// pagina no esta cargada.
+static inline int memoria_traducir(const TablaPaginas_t *tabla, int direccion) {
+    if (tabla == NULL) return direccion;
+    int pagina = direccion / TAM_PAGINA;
+    if (direccion < 0 || pagina >= tabla->cant_paginas || tabla->marcos[pagina] < 0) return -1;
+    return tabla->marcos[pagina] + direccion % TAM_PAGINA;
+}
+
+// Ubica la pagina en un marco libre y copia su parte del codigo del disco (el resto de la
+// pagina queda en 0). Una pagina del segmento compartido usa el marco del segmento, que se
+// carga solo la primera vez. Retorna la direccion fisica del marco o -1 si no hay marcos libres.
+int memoria_cargar_pagina(Memoria_t *mem, TablaPaginas_t *tabla, int pagina);
+
+// Suma la tabla a los usuarios del segmento de su programa (tabla->segmento). El primero lo
+// inicializa con cant_paginas paginas de codigo todavia sin cargar.
+void memoria_tomar_segmento(TablaPaginas_t *tabla, int cant_paginas);
+
+// Copia en un marco propio la pagina compartida que el proceso quiere escribir. Retorna el
+// marco nuevo o -1 si no hay marcos libres (la pagina sigue compartida).
+int memoria_copiar_pagina(Memoria_t *mem, TablaPaginas_t *tabla, int pagina);
+
+// Libera los marcos propios de la tabla y suelta su segmento compartido: sus marcos se
+// liberan con el ultimo proceso que lo usaba
+void memoria_liberar_paginas(Memoria_t *mem, TablaPaginas_t *tabla);
+
+// Nombre de una politica de ajuste ("primero", "mejor", "siguiente"); NULL si no existe
+const char *memoria_nombre_ajuste(int politica);
+
+// Tamaño del hueco mas grande (0 si la memoria de usuario esta llena)
+int memoria_mayor_hueco(const Memoria_t *mem);
+
 #endif
\ No newline at end of file
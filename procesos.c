@@ -0,0 +1,124 @@
+#include "procesos.h"
+#include "logger.h"
+#include <stdlib.h>
+
+int procesos_inicializar(TablaProcesos_t *tabla) {
+    tabla->slabs = NULL;
+    tabla->cant_slabs = 0;
+    tabla->capacidad = 0;
+    tabla->usados = 0;
+    tabla->libres_frente = tabla->libres_fin = -1;
+    tabla->cant_libres = 0;
+    tabla->cant_pids = 0;
+    tabla->tam_hash = HASH_PIDS_INICIAL;
+    tabla->hash = malloc(tabla->tam_hash * sizeof(int));
+    if (!tabla->hash) return -1;
+    for (int h = 0; h < tabla->tam_hash; h++) tabla->hash[h] = -1;
+    return 0;
+}
+
+void procesos_liberar(TablaProcesos_t *tabla) {
+    for (int s = 0; s < tabla->cant_slabs; s++) free(tabla->slabs[s]);
+    free(tabla->slabs);
+    free(tabla->hash);
+    tabla->slabs = NULL;
+    tabla->hash = NULL;
+    tabla->cant_slabs = tabla->capacidad = tabla->usados = 0;
+}
+
+// Agrega un bloque de BCP virgenes (pid 0). Solo crece el arreglo de punteros.
+static int procesos_agregar_slab(TablaProcesos_t *tabla) {
+    BCP_t **slabs = realloc(tabla->slabs, (tabla->cant_slabs + 1) * sizeof(BCP_t *));
+    if (!slabs) return -1;
+    tabla->slabs = slabs;
+
+    BCP_t *slab = calloc(BCP_POR_SLAB, sizeof(BCP_t));
+    if (!slab) return -1;
+    tabla->slabs[tabla->cant_slabs++] = slab;
+    tabla->capacidad += BCP_POR_SLAB;
+    LOG_DEBUG(LOG_CAT_SIS, "Tabla de procesos: %d lugares", tabla->capacidad);
+    return 0;
+}
+
+int procesos_reservar(TablaProcesos_t *tabla) {
+    if (tabla->usados < tabla->capacidad) {
+        return tabla->usados++;
+    }
+    if (tabla->cant_libres > 0) {
+        int indice = tabla->libres_frente;
+        tabla->libres_frente = procesos_bcp(tabla, indice)->siguiente;
+        tabla->cant_libres--;
+        return indice;
+    }
+    if (procesos_agregar_slab(tabla) != 0) return -1;
+    return tabla->usados++;
+}
+
+void procesos_cancelar(TablaProcesos_t *tabla, int indice) {
+    if (indice == tabla->usados - 1 && procesos_bcp(tabla, indice)->pid == 0) {
+        tabla->usados--;
+        return;
+    }
+    // Era uno reciclado: vuelve al frente de los libres
+    procesos_bcp(tabla, indice)->siguiente = tabla->libres_frente;
+    tabla->libres_frente = indice;
+    if (tabla->cant_libres++ == 0) tabla->libres_fin = indice;
+}
+
+void procesos_liberar_indice(TablaProcesos_t *tabla, int indice) {
+    procesos_bcp(tabla, indice)->siguiente = -1;
+    if (tabla->cant_libres++ == 0) {
+        tabla->libres_frente = indice;
+    } else {
+        procesos_bcp(tabla, tabla->libres_fin)->siguiente = indice;
+    }
+    tabla->libres_fin = indice;
+}
+
+//------------------------------------------------------INDICE POR PID----------------------------------------------------------------------------------------------
+
+static void procesos_hash_insertar(TablaProcesos_t *tabla, int indice) {
+    BCP_t *bcp = procesos_bcp(tabla, indice);
+    int h = bcp->pid & (tabla->tam_hash - 1);
+    bcp->siguiente_pid = tabla->hash[h];
+    tabla->hash[h] = indice;
+}
+
+static void procesos_hash_quitar(TablaProcesos_t *tabla, int indice) {
+    int *enlace = &tabla->hash[procesos_bcp(tabla, indice)->pid & (tabla->tam_hash - 1)];
+    while (*enlace != indice) enlace = &procesos_bcp(tabla, *enlace)->siguiente_pid;
+    *enlace = procesos_bcp(tabla, indice)->siguiente_pid;
+}
+
+// Duplica las cadenas cuando hay mas pids que cadenas. Sin memoria sigue con las que tiene.
+static void procesos_hash_crecer(TablaProcesos_t *tabla) {
+    int *hash = malloc(2 * tabla->tam_hash * sizeof(int));
+    if (!hash) return;
+
+    free(tabla->hash);
+    tabla->hash = hash;
+    tabla->tam_hash *= 2;
+    for (int h = 0; h < tabla->tam_hash; h++) tabla->hash[h] = -1;
+    for (int i = 0; i < tabla->usados; i++) {
+        if (procesos_bcp(tabla, i)->pid != 0) procesos_hash_insertar(tabla, i);
+    }
+}
+
+void procesos_asignar_pid(TablaProcesos_t *tabla, int indice, int pid) {
+    BCP_t *bcp = procesos_bcp(tabla, indice);
+    if (bcp->pid != 0) {
+        procesos_hash_quitar(tabla, indice);
+        tabla->cant_pids--;
+    }
+    bcp->pid = pid;
+    procesos_hash_insertar(tabla, indice);
+    if (++tabla->cant_pids > tabla->tam_hash) procesos_hash_crecer(tabla);
+}
+
+int procesos_buscar(TablaProcesos_t *tabla, int pid) {
+    int indice = tabla->hash[pid & (tabla->tam_hash - 1)];
+    while (indice != -1 && procesos_bcp(tabla, indice)->pid != pid) {
+        indice = procesos_bcp(tabla, indice)->siguiente_pid;
+    }
+    return indice;
+}
@@ -0,0 +1,55 @@
+#ifndef PROCESOS_H
+#define PROCESOS_H
+
+#include "tipos.h"
+
+// Tabla de procesos que crece por demanda. Los BCP viven en bloques (slabs) de
+// BCP_POR_SLAB que no se mueven ni se liberan hasta reiniciar: contexto.paginas apunta
+// dentro del BCP y los indices de las colas siguen valiendo. Se entregan primero los
+// indices virgenes de los bloques; despues se recicla el del proceso que termino hace mas
+// tiempo (hasta entonces sigue visible como TERMINADO) y solo si no hay se agrega un bloque.
+// El pid se busca con una tabla hash encadenada por BCP_t.siguiente_pid.
+
+#define BCP_POR_SLAB 64
+#define HASH_PIDS_INICIAL 64    // Cadenas de la tabla hash (potencia de dos; se duplica)
+
+typedef struct {
+    BCP_t **slabs;
+    int cant_slabs;
+    int capacidad;          // cant_slabs * BCP_POR_SLAB
+    int usados;             // Indices entregados alguna vez: del resto de los bloques, virgenes
+    int libres_frente;      // Indices para reciclar en orden de terminacion (enlace: BCP_t.siguiente)
+    int libres_fin;
+    int cant_libres;
+    int *hash;              // Primer indice de cada cadena (-1: vacia)
+    int tam_hash;
+    int cant_pids;          // BCPs en la tabla hash (los de pid distinto de cero)
+} TablaProcesos_t;
+
+// Deja la tabla vacia, sin bloques. Retorna -1 si no hay memoria para la tabla hash.
+int procesos_inicializar(TablaProcesos_t *tabla);
+
+// Libera los bloques y la tabla hash
+void procesos_liberar(TablaProcesos_t *tabla);
+
+static inline BCP_t *procesos_bcp(TablaProcesos_t *tabla, int indice) {
+    return &tabla->slabs[indice / BCP_POR_SLAB][indice % BCP_POR_SLAB];
+}
+
+// Entrega un indice para un proceso nuevo en O(1) (amortizado al agregar un bloque).
+// Retorna -1 si no hay memoria para otro bloque.
+int procesos_reservar(TablaProcesos_t *tabla);
+
+// Devuelve sin usar un indice recien reservado (la creacion del proceso fallo)
+void procesos_cancelar(TablaProcesos_t *tabla, int indice);
+
+// Le da el pid al BCP del indice y lo indexa; el pid anterior del BCP deja de encontrarse
+void procesos_asignar_pid(TablaProcesos_t *tabla, int indice, int pid);
+
+// El proceso del indice termino: su lugar se podra reciclar
+void procesos_liberar_indice(TablaProcesos_t *tabla, int indice);
+
+// Retorna el indice del proceso con ese pid o -1
+int procesos_buscar(TablaProcesos_t *tabla, int pid);
+
+#endif
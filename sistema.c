@@ -1,36 +1,31 @@
 #include "sistema.h"
 #include "logger.h"
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-int g_modo_debug = 0;
+// El monticulo de dormidos tiene lugar para toda la tabla de procesos: se agranda con ella
+static int sistema_ajustar_dormidos(Sistema_t *sys) {
+    MonticuloDormidos_t *m = &sys->dormidos;
+    if (m->capacidad >= sys->tabla_procesos.capacidad) return 0;
+
+    int *indices = realloc(m->indices, sys->tabla_procesos.capacidad * sizeof(int));
+    if (!indices) return -1;
+    m->indices = indices;
+    m->capacidad = sys->tabla_procesos.capacidad;
+    return 0;
+}
 
 int sistema_crear_proceso(Sistema_t *sys, const char *archivo) {
     
-    //
-    int indice_libre = -1;
-
-    // 1. Intentar buscar un hueco virgen (pid == 0) primero
-    for (int i = 0; i < MAX_PROCESOS; i++) {
-        if (sys->tabla_procesos[i].pid == 0) {
-            indice_libre = i;
-            break;
-        }
-    }
-
-    // 2. Si no hay huecos vírgenes, reutilizar un slot TERMINADO
-    if (indice_libre == -1) {
-        for (int i = 0; i < MAX_PROCESOS; i++) {
-            if (sys->tabla_procesos[i].estado == TERMINADO) {
-                indice_libre = i;
-                break;
-            }
-        }
-    }
-
-    if (indice_libre == -1) {
-        printf("Error: No se pueden crear más procesos. Límite de %d alcanzado.\n", MAX_PROCESOS);
+    // 1. Lugar en la tabla: uno virgen, el de un proceso que termino o uno de un bloque nuevo
+    int indice_libre = procesos_reservar(&sys->tabla_procesos);
+    if (indice_libre == -1 || sistema_ajustar_dormidos(sys) != 0) {
+        if (indice_libre != -1) procesos_cancelar(&sys->tabla_procesos, indice_libre);
+        printf("Error: No hay memoria para otro proceso en la tabla (%d lugares).\n", sys->tabla_procesos.capacidad);
         return -1;
     }
 
@@ -39,122 +34,254 @@ int sistema_crear_proceso(Sistema_t *sys, const char *archivo) {
     int sector_disco = disco_cargar_programa(&sys->disco, archivo, &cant_palabras);
     if (sector_disco == -1) {
         printf("Error: Fallo al cargar el programa '%s' en el disco.\n", archivo);
+        procesos_cancelar(&sys->tabla_procesos, indice_libre);
         return -1;
     }
 
-    // 3. Asignar memoria estática (Partición)
+    BCP_t *nuevo_proceso = sistema_bcp(sys, indice_libre);
     int tam_requerido = cant_palabras + TAM_PILA;
-    int dir_base = memoria_asignar_espacio(&sys->memoria, tam_requerido);
-    
-    if (dir_base == -1) {
-        if (tam_requerido > TAM_PARTICION) {
-            printf("Error: Programa '%s' muy grande (requiere %d, config limite %d).\n", archivo, tam_requerido, TAM_PARTICION);
-        } else {
-            printf("Error: No hay particiones libres en memoria para '%s'.\n", archivo);
+    int dir_base = 0;
+    int tam_asignado = 0;
+
+    if (sys->paginacion) {
+        // 3. Paginacion: el codigo se carga por demanda desde el disco; la pila de una vez
+        TablaPaginas_t *tabla = &nuevo_proceso->tabla_paginas;
+        int cant_paginas = (tam_requerido + TAM_PAGINA - 1) / TAM_PAGINA;
+        if (cant_paginas > MAX_PAGINAS) {
+            printf("Error: Programa '%s' muy grande para paginar (%d paginas, maximo %d).\n", archivo, cant_paginas, MAX_PAGINAS);
+            procesos_cancelar(&sys->tabla_procesos, indice_libre);
+            return -1;
         }
-        return -1;
-    }
+        tabla->cant_paginas = cant_paginas;
+        tabla->imagen = sys->disco.sectores[sector_disco].codigo;
+        tabla->tam_imagen = cant_palabras;
+        for (int p = 0; p < cant_paginas; p++) {
+            tabla->marcos[p] = -1;
+            tabla->compartida[p] = 0;
+        }
+        // Con codigo compartido las paginas llenas de codigo son las del segmento del programa
+        tabla->segmento = sys->codigo_compartido ? &sys->segmentos_codigo[sector_disco] : NULL;
 
-    // 4. Cargar de disco a memoria
-    palabra_t buffer_codigo[MAX_CODE_SIZE];
-    disco_leer_programa(&sys->disco, sector_disco, buffer_codigo, &cant_palabras);
-    memoria_cargar_desde_buffer(&sys->memoria, buffer_codigo, cant_palabras, dir_base);
+        int sin_marcos = 0;
+        pthread_mutex_lock(&sys->mutex_memoria);
+        if (tabla->segmento != NULL) memoria_tomar_segmento(tabla, cant_palabras / TAM_PAGINA);
+        for (int p = cant_palabras / TAM_PAGINA; p < cant_paginas && !sin_marcos; p++) {
+            sin_marcos = memoria_cargar_pagina(&sys->memoria, tabla, p) == -1;
+        }
+        if (sin_marcos) memoria_liberar_paginas(&sys->memoria, tabla);
+        pthread_mutex_unlock(&sys->mutex_memoria);
+
+        if (sin_marcos) {
+            printf("Error: No hay marcos libres para la pila de '%s'.\n", archivo);
+            procesos_cancelar(&sys->tabla_procesos, indice_libre);
+            return -1;
+        }
+        tam_asignado = cant_paginas * TAM_PAGINA; // Espacio virtual desde RB = 0 (FRAG: resto de la ultima pagina)
+    } else {
+        // 3. Asignar memoria (particion variable del tamaño del programa mas su pila). Si no
+        // hay hueco, el intercambio lleva otros procesos al disco.
+        dir_base = sistema_asignar_con_intercambio(sys, tam_requerido, &tam_asignado);
+
+        if (dir_base == -1) {
+            int tam_contiguo = memoria_tope_contiguo(&sys->memoria) - sys->memoria.mem_so;
+            if (tam_requerido > tam_contiguo) {
+                printf("Error: Programa '%s' muy grande (requiere %d, memoria de usuario sin paginacion %d).\n", archivo, tam_requerido, tam_contiguo);
+            } else {
+                printf("Error: No hay un hueco de %d palabras libre en memoria para '%s'.\n", tam_requerido, archivo);
+            }
+            procesos_cancelar(&sys->tabla_procesos, indice_libre);
+            return -1;
+        }
+
+        // 4. Cargar de disco a memoria
+        palabra_t buffer_codigo[MAX_CODE_SIZE];
+        disco_leer_programa(&sys->disco, sector_disco, buffer_codigo, &cant_palabras);
+        memoria_cargar_desde_buffer(&sys->memoria, buffer_codigo, cant_palabras, dir_base);
+        nuevo_proceso->tabla_paginas.cant_paginas = 0;
+        nuevo_proceso->tabla_paginas.segmento = NULL;
+    }
 
     // 5. Inicializar BCP
-    BCP_t *nuevo_proceso = &sys->tabla_procesos[indice_libre];
-    
-    nuevo_proceso->pid = ++sys->contador_pids;
+    procesos_asignar_pid(&sys->tabla_procesos, indice_libre, ++sys->contador_pids);
     strncpy(nuevo_proceso->nombre_programa, archivo, 49);
     nuevo_proceso->estado = NUEVO;
     nuevo_proceso->tiempo_inicio = sys->ciclos_reloj;
     nuevo_proceso->base_disco = sector_disco;
     nuevo_proceso->tics_dormido = 0;
     nuevo_proceso->tamano_real = tam_requerido;
+    nuevo_proceso->base_memoria = dir_base;
+    nuevo_proceso->tam_asignado = tam_asignado;
+    nuevo_proceso->en_disco = 0;
+    nuevo_proceso->ultimo_uso = ++sys->intercambio.reloj;
+    nuevo_proceso->nucleo = -1;
     
-    // 6. Inicializar contexto de CPU
+    // 6. Inicializar contexto de CPU (con paginacion las direcciones son virtuales)
     memset(&nuevo_proceso->contexto, 0, sizeof(CPU_t));
     nuevo_proceso->contexto.PSW.pc = dir_base;
     nuevo_proceso->contexto.PSW.modo = MODO_USUARIO;
     nuevo_proceso->contexto.PSW.interrupciones = INT_HABILITADAS;
     nuevo_proceso->contexto.RB = dir_base;
     nuevo_proceso->contexto.RX = dir_base + cant_palabras;
-    nuevo_proceso->contexto.RL = dir_base + TAM_PARTICION - 1; // Limite fijo tamaño particion
+    nuevo_proceso->contexto.RL = dir_base + tam_asignado - 1; // Limite del bloque asignado
     nuevo_proceso->contexto.SP = 0;
+    nuevo_proceso->contexto.paginas = sys->paginacion ? &nuevo_proceso->tabla_paginas : NULL;
 
     // 7. Registrar LOG
-    sistema_log(nuevo_proceso->pid, -1, NUEVO);
+    sistema_log(sys, nuevo_proceso->pid, -1, NUEVO);
 
-    printf("[SO] Proceso %d ('%s') creado exitosamente. Asignado RAM: %d a %d\n", 
-            nuevo_proceso->pid, archivo, dir_base, nuevo_proceso->contexto.RL);
+    if (nuevo_proceso->tabla_paginas.segmento != NULL) {
+        printf("[SO] Proceso %d ('%s') creado exitosamente. Paginado: %d paginas de %d palabras (%d de codigo compartido)\n",
+                nuevo_proceso->pid, archivo, nuevo_proceso->tabla_paginas.cant_paginas, TAM_PAGINA,
+                nuevo_proceso->tabla_paginas.segmento->cant_paginas);
+    } else if (sys->paginacion) {
+        printf("[SO] Proceso %d ('%s') creado exitosamente. Paginado: %d paginas de %d palabras\n",
+                nuevo_proceso->pid, archivo, nuevo_proceso->tabla_paginas.cant_paginas, TAM_PAGINA);
+    } else {
+        printf("[SO] Proceso %d ('%s') creado exitosamente. Asignado RAM: %d a %d\n", 
+                nuevo_proceso->pid, archivo, dir_base, nuevo_proceso->contexto.RL);
+    }
 
     // Mover a LISTO
     nuevo_proceso->estado = LISTO;
-    sistema_log(nuevo_proceso->pid, NUEVO, LISTO);
+    sistema_log(sys, nuevo_proceso->pid, NUEVO, LISTO);
+    sistema_encolar_listo(sys, indice_libre);
+    sys->procesos_vivos++;
 
     return nuevo_proceso->pid;
 }
 
-int sistema_planificar_rr(Sistema_t *sys) {
-    int pid_saliente = sys->proceso_actual;
-    int proximo_indice = -1;
-    
-    int inicio_busqueda = 0;
-    if (pid_saliente != -1) {
-        for (int i = 0; i < MAX_PROCESOS; i++) {
-            if (sys->tabla_procesos[i].pid == pid_saliente) {
-                inicio_busqueda = (i + 1) % MAX_PROCESOS;
-                break;
-            }
-        }
+void sistema_encolar_listo(Sistema_t *sys, int indice) {
+    ColaProcesos_t *cola = &sys->listos;
+    sistema_bcp(sys, indice)->siguiente = -1;
+    if (cola->cantidad == 0) {
+        cola->frente = indice;
+    } else {
+        sistema_bcp(sys, cola->fin)->siguiente = indice;
     }
+    cola->fin = indice;
+    cola->cantidad++;
+}
 
-    for (int i = 0; i < MAX_PROCESOS; i++) {
-        int idx = (inicio_busqueda + i) % MAX_PROCESOS;
-        if (sys->tabla_procesos[idx].estado == LISTO && sys->tabla_procesos[idx].pid != 0) {
-            proximo_indice = idx;
-            break;
-        }
+int sistema_sacar_listo(Sistema_t *sys) {
+    ColaProcesos_t *cola = &sys->listos;
+    if (cola->cantidad == 0) return -1;
+
+    int indice = cola->frente;
+    cola->frente = sistema_bcp(sys, indice)->siguiente;
+    cola->cantidad--;
+    return indice;
+}
+
+void sistema_terminar_proceso(Sistema_t *sys, int indice) {
+    BCP_t *proceso = sistema_bcp(sys, indice);
+    proceso->estado = TERMINADO;
+    procesos_liberar_indice(&sys->tabla_procesos, indice); // Sigue en ps hasta que se recicle
+    // El bloque o los marcos vuelven a la lista de huecos (el contexto pudo mover RB o RL
+    // con STRRB/STRRL)
+    pthread_mutex_lock(&sys->mutex_memoria);
+    if (proceso->contexto.paginas != NULL) {
+        memoria_liberar_paginas(&sys->memoria, &proceso->tabla_paginas);
+    } else {
+        memoria_liberar_espacio(&sys->memoria, proceso->base_memoria, proceso->base_memoria + proceso->tam_asignado - 1);
+    }
+    pthread_mutex_unlock(&sys->mutex_memoria);
+    sistema_log(sys, proceso->pid, EJECUCION, TERMINADO);
+    __atomic_sub_fetch(&sys->procesos_vivos, 1, __ATOMIC_SEQ_CST); // Los nucleos SMP lo leen sin cerrojo
+}
+
+// Orden del monticulo de dormidos: primero el que despierta antes y, a igual ciclo, el de
+// menor indice en la tabla
+static int sistema_despierta_antes(Sistema_t *sys, int a, int b) {
+    int ciclo_a = sistema_bcp(sys, a)->ciclo_despertar;
+    int ciclo_b = sistema_bcp(sys, b)->ciclo_despertar;
+    return ciclo_a != ciclo_b ? ciclo_a < ciclo_b : a < b;
+}
+
+void sistema_agregar_dormido(Sistema_t *sys, MonticuloDormidos_t *m, int indice) {
+    // Subir desde la ultima hoja
+    int hijo = m->cantidad++;
+    while (hijo > 0) {
+        int padre = (hijo - 1) / 2;
+        if (!sistema_despierta_antes(sys, indice, m->indices[padre])) break;
+        m->indices[hijo] = m->indices[padre];
+        hijo = padre;
     }
-    return proximo_indice;
+    m->indices[hijo] = indice;
+}
+
+int sistema_sacar_dormido(Sistema_t *sys, MonticuloDormidos_t *m) {
+    int tope = m->indices[0];
+    int ultimo = m->indices[--m->cantidad];
+
+    // Bajar la ultima hoja desde la raiz
+    int padre = 0;
+    for (;;) {
+        int hijo = 2 * padre + 1;
+        if (hijo >= m->cantidad) break;
+        if (hijo + 1 < m->cantidad && sistema_despierta_antes(sys, m->indices[hijo + 1], m->indices[hijo])) hijo++;
+        if (!sistema_despierta_antes(sys, m->indices[hijo], ultimo)) break;
+        m->indices[padre] = m->indices[hijo];
+        padre = hijo;
+    }
+    m->indices[padre] = ultimo;
+    return tope;
+}
+
+// Agrega al monticulo de dormidos un proceso que se acaba de dormir por 'tics' ciclos. El
+// ciclo en que se duerme ya cuenta como el primero, y menos de un tic despierta en el mismo.
+static void sistema_dormir_proceso(Sistema_t *sys, int indice, int tics) {
+    sistema_bcp(sys, indice)->ciclo_despertar = sys->ciclos_reloj + (tics > 1 ? tics : 1) - 1;
+    sistema_agregar_dormido(sys, &sys->dormidos, indice);
+}
+
+// Round robin: el proximo es el primero de la cola de listos
+int sistema_planificar_rr(Sistema_t *sys) {
+    return sistema_sacar_listo(sys);
 }
 
 void sistema_despachar(Sistema_t *sys, int proximo_indice) {
     int pid_saliente = sys->proceso_actual;
 
-    // 1. SALVAR CONTEXTO
-    if (pid_saliente != -1) {
-        for (int i = 0; i < MAX_PROCESOS; i++) {
-            if (sys->tabla_procesos[i].pid == pid_saliente && sys->tabla_procesos[i].estado == EJECUCION) {
-                sys->tabla_procesos[i].contexto = sys->cpu; 
-                sys->tabla_procesos[i].estado = LISTO;
-                sistema_log(pid_saliente, EJECUCION, LISTO);
-                break;
-            }
-        }
+    // 1. SALVAR CONTEXTO (si sigue en ejecucion vuelve al final de la cola)
+    if (pid_saliente != -1 && sistema_bcp(sys, sys->indice_actual)->estado == EJECUCION) {
+        BCP_t *p_saliente = sistema_bcp(sys, sys->indice_actual);
+        p_saliente->contexto = sys->cpu;
+        p_saliente->estado = LISTO;
+        sistema_log(sys, pid_saliente, EJECUCION, LISTO);
+        sistema_encolar_listo(sys, sys->indice_actual);
+    }
+
+    // 2. TRAER DEL DISCO si fue intercambiado. Si no se puede, vuelve a la cola y se prueba
+    // con los siguientes (una vuelta como maximo); si ninguno entra, la CPU queda ociosa.
+    for (int intentos = sys->listos.cantidad; proximo_indice != -1 && sistema_bcp(sys, proximo_indice)->en_disco; intentos--) {
+        if (sistema_traer_de_disco(sys, proximo_indice) == 0) break;
+        sistema_encolar_listo(sys, proximo_indice);
+        proximo_indice = intentos > 0 ? sistema_sacar_listo(sys) : -1;
     }
 
-    // 2. CARGAR CONTEXTO
+    // 3. CARGAR CONTEXTO
     if (proximo_indice != -1) {
-        BCP_t *p_entrante = &sys->tabla_procesos[proximo_indice];
+        BCP_t *p_entrante = sistema_bcp(sys, proximo_indice);
         
-        sys->cpu = p_entrante->contexto;
+        cpu_cargar_contexto(&sys->cpu, &p_entrante->contexto);
+        p_entrante->ultimo_uso = ++sys->intercambio.reloj;
         sys->proceso_actual = p_entrante->pid;
+        sys->indice_actual = proximo_indice;
+        p_entrante->nucleo = 0;
         sys->contador_quantum = 0; // Reiniciamos quantum
+        sys->totales.cambios_contexto++;
         
         p_entrante->estado = EJECUCION;
-        sistema_log(p_entrante->pid, LISTO, EJECUCION);
+        sistema_log(sys, p_entrante->pid, LISTO, EJECUCION);
 
         if (pid_saliente != -1) {
-            char log_msg[200];
-            sprintf(log_msg, "Cambio de contexto: Saliente PID = %d, Entrante PID = %d", pid_saliente, p_entrante->pid);
-            log_mensaje(log_msg);
+            LOG_INFO(LOG_CAT_PLANIF, "Cambio de contexto: Saliente PID = %d, Entrante PID = %d", pid_saliente, p_entrante->pid);
         } else {
-            char log_msg[200];
-            sprintf(log_msg, "Despacho inicial: Entrante PID = %d", p_entrante->pid);
-            log_mensaje(log_msg);
+            LOG_INFO(LOG_CAT_PLANIF, "Despacho inicial: Entrante PID = %d", p_entrante->pid);
         }
     } else {
         sys->proceso_actual = -1;
+        sys->indice_actual = -1;
     }
 }
 
@@ -163,9 +290,7 @@ void sistema_planificar(Sistema_t *sys) {
     
     // Si no hay nadie LISTO y ya hay un proceso corriendo, simplemente dejarlo seguir
     if (prox == -1 && sys->proceso_actual != -1) {
-        char log_msg[200];
-        sprintf(log_msg, "QUANTUM AGOTADO: PID %d continua (unico proceso listo)", sys->proceso_actual);
-        log_mensaje(log_msg);
+        LOG_DEBUG(LOG_CAT_PLANIF, "QUANTUM AGOTADO: PID %d continua (unico proceso listo)", sys->proceso_actual);
         sys->contador_quantum = 0; // Reiniciar quantum para el mismo proceso
         return;
     }
@@ -176,75 +301,213 @@ void sistema_planificar(Sistema_t *sys) {
     }
 }
 
-void sistema_log(int pid, Estado_t anterior, Estado_t nuevo) {
+void sistema_log(Sistema_t *sys, int pid, Estado_t anterior, Estado_t nuevo) {
     const char* nombres[] = {"NUEVO", "LISTO", "EJECUCION", "DORMIDO", "TERMINADO"};
     
-    char buffer[256];
-    if (anterior == (Estado_t)-1) {
-        sprintf(buffer, "[ESTADO] Proceso %d: CREADO -> %s", pid, nombres[nuevo]);
-    } else {
-        sprintf(buffer, "[ESTADO] Proceso %d: %s -> %s", pid, nombres[anterior], nombres[nuevo]);
+    LOG_INFO(LOG_CAT_PLANIF, "[ESTADO] Proceso %d: %s -> %s", pid,
+             anterior == (Estado_t)-1 ? "CREADO" : nombres[anterior], nombres[nuevo]);
+
+    if (traza_activa(&sys->traza)) {
+        RegistroTraza_t r;
+        memset(&r, 0, sizeof(r));
+        r.tipo = TRAZA_ESTADO;
+        r.pid = pid;
+        r.interrupcion = TRAZA_SIN_INTERRUPCION;
+        r.estado = (anterior == (Estado_t)-1 ? 0xF0 : anterior << 4) | nuevo;
+        r.ciclo = sys->ciclos_reloj;
+
+        // En SMP la transicion la hace el nucleo del proceso: se usa su reloj
+        int indice = sys->cant_nucleos > 1 ? procesos_buscar(&sys->tabla_procesos, pid) : -1;
+        if (indice != -1 && sistema_bcp(sys, indice)->nucleo >= 0) {
+            BCP_t *proceso = sistema_bcp(sys, indice);
+            r.nucleo = proceso->nucleo;
+            r.ciclo += sys->nucleos[proceso->nucleo].ciclos;
+        }
+        traza_registrar(&sys->traza, &r);
     }
-    
-    log_mensaje(buffer);
 }
 
-void sistema_inicializar(Sistema_t *sys) {
+void sistema_trazar_instruccion(Sistema_t *sys, const CPU_t *cpu, int nucleo, long ciclo, int pid,
+                                int pc, palabra_t ac_antes) {
+    RegistroTraza_t r;
+    r.tipo = TRAZA_INSTRUCCION;
+    r.ciclo = ciclo;
+    r.nucleo = nucleo;
+    r.pid = pid;
+    r.reservado = 0;
+    r.pc = pc;
+    r.ir = palabra_a_sm(cpu->IR);
+    r.ac_antes = palabra_a_sm(ac_antes);
+    r.ac_despues = palabra_a_sm(cpu->AC);
+    r.estado = 0;
+
+    // La interrupcion que dejo pendiente la instruccion (se atiende a continuacion)
+    int codigo = interrupciones_siguiente(atomic_load(&cpu->interrupciones_pendientes));
+    r.interrupcion = codigo < 0 ? TRAZA_SIN_INTERRUPCION : codigo;
+    traza_registrar(&sys->traza, &r);
+}
+
+void sistema_trazar_interrupcion(Sistema_t *sys, const CPU_t *cpu, int nucleo, long ciclo, int pid, int codigo) {
+    RegistroTraza_t r;
+    memset(&r, 0, sizeof(r));
+    r.tipo = TRAZA_INTERRUPCION;
+    r.ciclo = ciclo;
+    r.nucleo = nucleo;
+    r.pid = pid < 0 ? 0 : pid; // Sin proceso en la CPU
+    r.pc = cpu->PSW.pc;
+    r.ac_antes = r.ac_despues = palabra_a_sm(cpu->AC);
+    r.interrupcion = codigo;
+    traza_registrar(&sys->traza, &r);
+}
+
+// Inicializa los componentes del sistema sin tocar su log (reiniciar lo conserva). Solo
+// falla la primera vez, si el host no tiene memoria para la RAM simulada.
+static int sistema_preparar(Sistema_t *sys) {
+    if (procesos_inicializar(&sys->tabla_procesos) != 0) return -1;
+    if (memoria_inicializar(&sys->memoria) != 0) { // La region se conserva al reiniciar
+        procesos_liberar(&sys->tabla_procesos);
+        return -1;
+    }
+
     // Inicializar mutex
-    pthread_mutex_init(&sys->mutex_bus, NULL);    //Controla quien puede usar el bus de datos. (Mutex)
-    pthread_mutex_init(&sys->mutex_memoria, NULL); //Protege el acceso al arreglo de datos de la RAM.
+    pthread_rwlock_init(&sys->cerrojo_bus, NULL);  //Controla quien puede usar el bus de datos (CPUs lectoras, DMA escritor)
+    pthread_mutex_init(&sys->mutex_memoria, NULL); //Protege la asignacion de particiones de la RAM.
+    pthread_mutex_init(&sys->mutex_procesos, NULL); //Protege los cambios de estado de la tabla de procesos.
     
     // Inicializar componentes
-    cpu_inicializar(&sys->cpu);    //Llama a cpu_inicializar para poner los registros de la CPU en cero
-    memoria_inicializar(&sys->memoria);  //Inicializa la memoria
+    cpu_inicializar(&sys->cpu, &sys->memoria);    //Llama a cpu_inicializar para poner los registros de la CPU en cero
     disco_inicializar(&sys->disco);      // Inicializa cache de disco
-    dma_inicializar(&sys->dma, sys->memoria.datos, &sys->mutex_bus);
+    dma_inicializar(&sys->dma, &sys->memoria, &sys->cerrojo_bus);
     interrupciones_inicializar(&sys->vector_int);
+    sys->jit = jit_crear(sys->memoria.tam_memoria);
     
     // Configurar vector de interrupciones para las llamadas al sistema posteriormente
     // lo haremos cuando tengamos las funciones.
     
-    // Inicializar tabla de procesos
-    for (int i = 0; i < MAX_PROCESOS; i++) {
-        sys->tabla_procesos[i].estado = TERMINADO;
-        sys->tabla_procesos[i].pid = 0;
-    }
-    
+    // La tabla de procesos empieza sin bloques: crece al crear procesos
     sys->proceso_actual = -1;
+    sys->indice_actual = -1;
+    sys->listos.frente = sys->listos.fin = -1;
+    sys->listos.cantidad = 0;
+    sys->dormidos.indices = NULL;
+    sys->dormidos.capacidad = 0;
+    sys->dormidos.cantidad = 0;
     sys->contador_quantum = 0;
+    sys->quantum = QUANTUM_DEFECTO;
+    sys->tam_rafaga = RAFAGA_DEFECTO;
+    sys->cant_nucleos = 1;
+    sys->procesos_vivos = 0;
     sys->contador_pids = 0;
     
     sys->ejecutando = 0;     //Indica si la maquina esta corriendo 
     sys->ciclos_reloj = 0;
     sys->periodo_reloj = 0;
     sys->pico_memoria = 0;
+    sys->paginacion = 0;
+    sys->codigo_compartido = 0;
+    memset(sys->segmentos_codigo, 0, sizeof(sys->segmentos_codigo));
+    memset(&sys->intercambio, 0, sizeof(Intercambio_t));
+    sys->intercambio.politica = INTERCAMBIO_LRU;
+    memset(&sys->estadisticas_cpu, 0, sizeof(EstadisticasCPU_t));
+    memset(&sys->totales, 0, sizeof(TotalesSistema_t));
     
-    log_mensaje("Sistema completo inicializado");
+    LOG_INFO(LOG_CAT_SIS, "Sistema completo inicializado");
+    return 0;
+}
+
+// Libera los componentes del sistema sin cerrar su log
+static void sistema_liberar(Sistema_t *sys) {
+    dma_terminar(&sys->dma);
+    jit_destruir(sys->jit);
+    sys->jit = NULL;
+    procesos_liberar(&sys->tabla_procesos);
+    free(sys->dormidos.indices);
+    sys->dormidos.indices = NULL;
+    pthread_rwlock_destroy(&sys->cerrojo_bus);
+    pthread_mutex_destroy(&sys->mutex_memoria);
+    pthread_mutex_destroy(&sys->mutex_procesos);
+    LOG_INFO(LOG_CAT_SIS, "Sistema finalizado correctamente");
+}
+
+int sistema_inicializar(Sistema_t *sys, const char *ruta_log) {
+    // Log de la instancia: todo lo que registre este hilo va a su archivo
+    log_abrir(&sys->log, ruta_log);
+    log_usar(&sys->log);
+
+    // El perfil es del hilo: una instancia nueva empieza sin contadores
+    perfil_cpu.activo = 0;
+    cpu_perfil_reiniciar();
+
+    sys->traza.archivo = NULL;
+    sys->memoria.region = NULL;
+    if (sistema_preparar(sys) != 0) {
+        log_cerrar(&sys->log);
+        return -1;
+    }
+    return 0;
+}
+
+void sistema_limpiar(Sistema_t *sys) {
+    sistema_liberar(sys);
+    memoria_liberar(&sys->memoria);
+    traza_cerrar(&sys->traza);
+    log_cerrar(&sys->log);
 }
 
 int hay_procesos_activos(Sistema_t *sys) {
-    for (int i = 0; i < MAX_PROCESOS; i++) {
-        if (sys->tabla_procesos[i].estado != TERMINADO && sys->tabla_procesos[i].pid != 0) {
-            return 1;
+    return sys->procesos_vivos > 0;
+}
+
+// Resumen por nucleo del modo SMP: contadores y procesos que cada uno ejecuto al final
+static void sistema_mostrar_nucleos(Sistema_t *sys) {
+    printf(" +--------+------------+---------------+----------+--------+-------------------------+\n");
+    printf(" | NUCLEO | CICLOS     | INSTRUCCIONES | CAMBIOS  | ROBOS  | PROCESOS (PID)          |\n");
+    printf(" +--------+------------+---------------+----------+--------+-------------------------+\n");
+    for (int i = 0; i < sys->cant_nucleos; i++) {
+        Nucleo_t *n = &sys->nucleos[i];
+        char pids[128] = "";
+        for (int p = 0; p < sys->tabla_procesos.usados; p++) {
+            if (sistema_bcp(sys, p)->pid != 0 && sistema_bcp(sys, p)->nucleo == i) {
+                char pid[12];
+                snprintf(pid, sizeof(pid), "%s%d", pids[0] ? " " : "", sistema_bcp(sys, p)->pid);
+                strncat(pids, pid, sizeof(pids) - strlen(pids) - 1);
+            }
         }
+        printf(" | %-6d | %-10ld | %-13ld | %-8ld | %-6ld | %-23s |\n",
+               n->id, n->ciclos, n->instrucciones, n->cambios_contexto, n->robos, pids);
     }
-    return 0;
+    printf(" +--------+------------+---------------+----------+--------+-------------------------+\n");
 }
 
 void sistema_iniciar_ejecucion(Sistema_t *sys) {
     sys->ejecutando = 1;
+    memset(&sys->estadisticas_cpu, 0, sizeof(EstadisticasCPU_t));
+    sys->rafagas = 0;
+    sys->cpu.tlb.aciertos = sys->cpu.tlb.fallos = 0;
+    long fallos_pagina = sys->memoria.estadisticas.fallos_pagina;
+    Intercambio_t *area = &sys->intercambio;
+    long salidas = area->salidas, entradas = area->entradas;
+    double segundos_salida = area->segundos_salida, segundos_entrada = area->segundos_entrada;
     
-    // Al arrancar o reiniciar ejecucion, forzamos la planificacion
-    sistema_planificar(sys);
+    // Al arrancar o reiniciar ejecucion, forzamos la planificacion (en SMP cada nucleo planifica)
+    if (sys->cant_nucleos == 1) {
+        sistema_planificar(sys);
+    }
     
-    char msg[200];
-    sprintf(msg, "Iniciando simulacion");
-    log_mensaje(msg);
-    printf("\n%s\n\n", msg);
+    LOG_INFO(LOG_CAT_SIS, "Iniciando simulacion");
+    printf("\nIniciando simulacion\n\n");
     
-    while (sys->ejecutando && hay_procesos_activos(sys)) {
-        sistema_ciclo(sys);
+    struct timespec t_inicio, t_fin;
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+    if (sys->cant_nucleos > 1) {
+        sistema_ejecutar_smp(sys);
+    } else {
+        while (sys->ejecutando && hay_procesos_activos(sys)) {
+            sistema_ciclo(sys);
+        }
     }
+    clock_gettime(CLOCK_MONOTONIC, &t_fin);
+    sys->totales.segundos += (t_fin.tv_sec - t_inicio.tv_sec) + (t_fin.tv_nsec - t_inicio.tv_nsec) / 1e9;
     printf("\n[SO] Ejecucion finalizada (Todos los procesos terminaron o sistema detenido)\n");
     sys->ejecutando = 0;
 
@@ -255,182 +518,291 @@ void sistema_iniciar_ejecucion(Sistema_t *sys) {
     printf(" +------+------------+-----------------+-------------+---------+---------+-------+\n");
     printf(" | PID  | ESTADO     | PROGRAMA        | RAM (BASE)  | %% ASIG  | %% REAL  | FRAG  |\n");
     printf(" +------+------------+-----------------+-------------+---------+---------+-------+\n");
-    for (int i = 0; i < MAX_PROCESOS; i++) {
-        if (sys->tabla_procesos[i].pid != 0) {
-            int tam_asig = TAM_PARTICION;
-            int tam_real = sys->tabla_procesos[i].tamano_real;
-            float pct_asig = (float)tam_asig * 100.0f / MEM_USUARIO;
-            float pct_real = (float)tam_real * 100.0f / MEM_USUARIO;
+    for (int i = 0; i < sys->tabla_procesos.usados; i++) {
+        if (sistema_bcp(sys, i)->pid != 0) {
+            int tam_asig = sistema_bcp(sys, i)->tam_asignado;
+            int tam_real = sistema_bcp(sys, i)->tamano_real;
+            float pct_asig = (float)tam_asig * 100.0f / sys->memoria.tam_usuario;
+            float pct_real = (float)tam_real * 100.0f / sys->memoria.tam_usuario;
             int frag_interna = tam_asig - tam_real;
 
             printf(" | %-4d | %-10s | %-15s | %-11d | %6.2f%% | %6.2f%% | %-5d |\n",
-                   sys->tabla_procesos[i].pid,
-                   nombres_est[sys->tabla_procesos[i].estado],
-                   sys->tabla_procesos[i].nombre_programa,
-                   sys->tabla_procesos[i].contexto.RB,
+                   sistema_bcp(sys, i)->pid,
+                   nombres_est[sistema_bcp(sys, i)->estado],
+                   sistema_bcp(sys, i)->nombre_programa,
+                   sistema_bcp(sys, i)->contexto.RB,
                    pct_asig,
                    pct_real,
                    frag_interna);
         }
     }
     printf(" +------+------------+-----------------+-------------+---------+---------+-------+\n");
-    printf(" * FRAG = Fragmentacion Interna (Palabras desperdiciadas en la particion estatica)\n");
-    printf(" Ciclos de reloj totales: %d\n\n", sys->ciclos_reloj);
+    printf(" * FRAG = Fragmentacion Interna (Sobrante del hueco entregado junto con el bloque)\n");
+    printf(" Ciclos de reloj totales: %d\n", sys->ciclos_reloj);
+    if (sys->cant_nucleos > 1) {
+        sistema_mostrar_nucleos(sys);
+    }
+    printf(" Rafagas de CPU: %ld (hasta %d ciclos por adquisicion del bus)\n", sys->rafagas, sys->tam_rafaga);
+    printf(" Despachos de instrucciones: %ld fusionados, %ld sin fusionar\n",
+           sys->estadisticas_cpu.despachos_fusionados, sys->estadisticas_cpu.despachos_simples);
+    if (sys->jit != NULL) {
+        printf(" JIT: %ld bloques traducidos, %ld invalidados, %ld enlaces entre bloques, %ld ciclos en codigo nativo\n",
+               sys->jit->bloques_compilados, sys->jit->bloques_invalidados, sys->jit->enlaces_hechos,
+               sys->jit->ciclos_nativos);
+    }
+    // Solo los procesos paginados consultan la TLB
+    long aciertos_tlb = sys->cpu.tlb.aciertos;
+    long fallos_tlb = sys->cpu.tlb.fallos;
+    for (int i = 0; sys->cant_nucleos > 1 && i < sys->cant_nucleos; i++) {
+        aciertos_tlb += sys->nucleos[i].cpu.tlb.aciertos;
+        fallos_tlb += sys->nucleos[i].cpu.tlb.fallos;
+    }
+    if (aciertos_tlb + fallos_tlb > 0) {
+        printf(" TLB: %ld aciertos, %ld fallos (%.2f%% de aciertos) | Fallos de pagina: %ld\n",
+               aciertos_tlb, fallos_tlb, aciertos_tlb * 100.0 / (aciertos_tlb + fallos_tlb),
+               sys->memoria.estadisticas.fallos_pagina - fallos_pagina);
+    }
+    salidas = area->salidas - salidas;
+    entradas = area->entradas - entradas;
+    if (salidas + entradas > 0) {
+        printf(" Intercambio: %ld salidas a disco (%.1f us prom.), %ld entradas (%.1f us prom.)\n", salidas,
+               salidas ? (area->segundos_salida - segundos_salida) * 1e6 / salidas : 0.0, entradas,
+               entradas ? (area->segundos_entrada - segundos_entrada) * 1e6 / entradas : 0.0);
+    }
+    printf("\n");
 }
 
-void sistema_manejar_syscall(Sistema_t *sys) {
-    int syscall_code = sys->cpu.AC;
-    // La pila crece de RX hacia arriba. El tope es RX + SP.
-    int tope_pila = sys->cpu.RX + sys->cpu.SP;
+int sistema_atender_syscall(Sistema_t *sys, CPU_t *cpu, int indice) {
+    BCP_t *proceso = sistema_bcp(sys, indice);
+    int syscall_code = palabra_a_sm(cpu->AC);
+    // La pila crece de RX hacia arriba. El tope es RX + SP (virtual si el proceso esta paginado;
+    // las paginas de la pila se cargan al crearlo).
+    int tope_pila = memoria_traducir(cpu->paginas, cpu->RX + cpu->SP);
+    palabra_t palabra_tope = tope_pila >= 0 && tope_pila < sys->memoria.tam_memoria ? sys->memoria.datos[tope_pila] : sm_a_palabra(0);
+    int resultado = SYSCALL_CONTINUA;
     
-    char msg[100];
-    sprintf(msg, "Llamada al sistema invocada: Codigo %d", syscall_code);
-    log_mensaje(msg);
+    LOG_INFO(LOG_CAT_INT, "Llamada al sistema invocada: Codigo %d", syscall_code);
 
     switch(syscall_code) {
         case 1: { // termina_prog(estado)
-            int estado_sm = sys->memoria.datos[tope_pila]; // Extraer en Signo-Magnitud
-            int estado = sm_a_nativo(estado_sm);           // Convertir a nativo
-            sys->cpu.SP--; // Pop
+            palabra_t estado_palabra = palabra_tope;                  // Extraer la palabra del tope
+            int estado = palabra_a_valor(estado_palabra);             // Convertir a nativo
+            cpu->SP--; // Pop
             
-            printf("[SO] Programa %d terminado vía Syscall con estado %d\n", sys->proceso_actual, estado);
+            printf("[SO] Programa %d terminado vía Syscall con estado %d\n", proceso->pid, estado);
             
             // Marcar BCP como terminado, liberar memoria y loguear
-            for (int i = 0; i < MAX_PROCESOS; i++) {
-                if (sys->tabla_procesos[i].pid == sys->proceso_actual) {
-                    sys->tabla_procesos[i].estado = TERMINADO;
-                    // memoria_liberar_espacio(&sys->memoria, sys->tabla_procesos[i].contexto.RB, sys->tabla_procesos[i].contexto.RL);
-                    sistema_log(sys->proceso_actual, EJECUCION, TERMINADO);
-                    break;
-                }
-            }
-            sys->proceso_actual = -1;
-            sistema_planificar(sys);
+            pthread_mutex_lock(&sys->mutex_procesos);
+            sistema_terminar_proceso(sys, indice);
+            pthread_mutex_unlock(&sys->mutex_procesos);
+            resultado = SYSCALL_TERMINA;
             break;
         }
         case 2: { // imprime_pantalla(valor)
-            int valor_sm = sys->memoria.datos[tope_pila];  // Extraer en Signo-Magnitud
-            int valor = sm_a_nativo(valor_sm); // Convertir a nativo
-            sys->cpu.SP--; // Pop
-            printf("[Programa %d en Consola] -> %d\n", sys->proceso_actual, valor);
+            palabra_t valor_palabra = palabra_tope;                   // Extraer la palabra del tope
+            int valor = palabra_a_valor(valor_palabra);               // Convertir a nativo
+            cpu->SP--; // Pop
+            printf("[Programa %d en Consola] -> %d\n", proceso->pid, valor);
             break;
         }
         case 3: { // leer_pantalla()
-            int entrada;
-            printf("[Programa %d solicita entrada] -> ", sys->proceso_actual);
+            int entrada = 0; // Sin entrada (EOF) se lee 0
+            printf("[Programa %d solicita entrada] -> ", proceso->pid);
             scanf("%d", &entrada);
             // vaciar buffer de entrada
             int c; while ((c = getchar()) != '\n' && c != EOF);
             
             // Al retorno, se almacena en AC
-            sys->cpu.AC = nativo_a_sm(entrada);
+            cpu->AC = valor_a_palabra(entrada);
             break;
         }
         case 4: { // Dormir(tics)
-            int tics_sm = sys->memoria.datos[tope_pila];   // Extraer en Signo-Magnitud
-            int tics = sm_a_nativo(tics_sm);               // Convertir a nativo
-            sys->cpu.SP--; // Pop
-            printf("[SO] Programa %d se va a dormir por %d tics\n", sys->proceso_actual, tics);
+            palabra_t tics_palabra = palabra_tope;                    // Extraer la palabra del tope
+            int tics = palabra_a_valor(tics_palabra);                 // Convertir a nativo
+            cpu->SP--; // Pop
+            printf("[SO] Programa %d se va a dormir por %d tics\n", proceso->pid, tics);
             
-            for (int i = 0; i < MAX_PROCESOS; i++) {
-                if (sys->tabla_procesos[i].pid == sys->proceso_actual) {
-                    sys->tabla_procesos[i].tics_dormido = tics;
-                    sys->tabla_procesos[i].estado = DORMIDO;
-                    sistema_log(sys->proceso_actual, EJECUCION, DORMIDO);
-                    
-                    // Salvar contexto actual para cuando despierte
-                    sys->tabla_procesos[i].contexto = sys->cpu;
-                    break;
-                }
-            }
-            sys->proceso_actual = -1;
-            sistema_planificar(sys);
+            pthread_mutex_lock(&sys->mutex_procesos);
+            proceso->tics_dormido = tics;
+            proceso->estado = DORMIDO;
+            sistema_log(sys, proceso->pid, EJECUCION, DORMIDO);
+            
+            // Salvar contexto actual para cuando despierte
+            proceso->contexto = *cpu;
+            pthread_mutex_unlock(&sys->mutex_procesos);
+            resultado = SYSCALL_DUERME;
             break;
         }
         default:
             printf("[SO] Error: Llamada al sistema %d no reconocida.\n", syscall_code);
-            log_error("Llamada al sistema no valida", syscall_code);
+            log_error(LOG_CAT_INT, "Llamada al sistema no valida", syscall_code);
             break;
     }
+    return resultado;
 }
 
-//Esta funcion encapsula lo que pasa en un ciclo de reloj.
+void sistema_manejar_syscall(Sistema_t *sys) {
+    if (sys->proceso_actual == -1) return;
+
+    int resultado = sistema_atender_syscall(sys, &sys->cpu, sys->indice_actual);
+    if (resultado == SYSCALL_DUERME) {
+        sistema_dormir_proceso(sys, sys->indice_actual, sistema_bcp(sys, sys->indice_actual)->tics_dormido);
+    }
+    if (resultado != SYSCALL_CONTINUA) {
+        sys->proceso_actual = -1;
+        sys->indice_actual = -1;
+        sistema_planificar(sys);
+    }
+}
+
+// Ciclos que se pueden ejecutar seguidos sin que cambie nada fuera de la CPU: no mas que
+// la rafaga configurada, lo que resta del quantum ni los ciclos hasta el proximo proceso
+// en despertar (el tope del monticulo de dormidos). Asi la contabilidad por rafaga da el
+// mismo resultado que ciclo a ciclo.
+static int sistema_ciclos_rafaga(Sistema_t *sys) {
+    int ciclos = sys->tam_rafaga;
+    // Con la traza activa se registra cada instruccion: rafagas de un ciclo
+    if (ciclos <= 1 || traza_activa(&sys->traza)) return 1;
+
+    if (sys->proceso_actual != -1 && sys->quantum - sys->contador_quantum < ciclos) {
+        ciclos = sys->quantum - sys->contador_quantum;
+    }
+    if (sys->dormidos.cantidad > 0) {
+        int faltan = sistema_bcp(sys, sys->dormidos.indices[0])->ciclo_despertar - sys->ciclos_reloj + 1;
+        if (faltan < ciclos) ciclos = faltan;
+    }
+    return ciclos < 1 ? 1 : ciclos;
+}
+
+int sistema_atender_fallo_pagina(Sistema_t *sys, CPU_t *cpu) {
+    int pagina = cpu->dir_fallo / TAM_PAGINA;
+    int marco;
+    pthread_mutex_lock(&sys->mutex_memoria);
+    if (cpu->paginas->compartida[pagina]) {
+        // Escritura en el codigo compartido: la pagina pasa a ser propia del proceso
+        marco = memoria_copiar_pagina(&sys->memoria, cpu->paginas, pagina);
+        if (marco != -1) cpu_tlb_invalidar(cpu, pagina);
+    } else {
+        marco = memoria_cargar_pagina(&sys->memoria, cpu->paginas, pagina);
+        if (marco != -1) sys->memoria.estadisticas.fallos_pagina++;
+    }
+    pthread_mutex_unlock(&sys->mutex_memoria);
+    return marco;
+}
+
+//Esta funcion encapsula lo que pasa en una rafaga de ciclos de reloj (uno por defecto).
 void sistema_ciclo(Sistema_t *sys) {
     
     if (!sys->ejecutando) return;
     
-    // Arbitraje del bus para CPU
-    pthread_mutex_lock(&sys->mutex_bus);  // La CPU pide permiso exclusivo para usar el bus
+    // Arbitraje del bus para CPU: el DMA solo puede tomarlo entre rafagas
+    pthread_rwlock_rdlock(&sys->cerrojo_bus);  // La CPU pide el bus (solo el DMA la excluye)
+    sys->rafagas++;
+
+    // Sin proceso cargado la CPU queda ociosa toda la rafaga
+    int ciclos = sistema_ciclos_rafaga(sys);
     
-    // Solo ejecutar instruccion si hay un proceso cargado en la CPU
+    // Solo ejecutar instrucciones si hay un proceso cargado en la CPU. La rafaga se corta
+    // antes si queda una interrupcion pendiente (incluidas las llamadas al sistema).
+    // Con la traza activa se usa el interprete, que deja cada instruccion en IR.
     if (sys->proceso_actual != -1) {
-        cpu_ciclo_instruccion(&sys->cpu, sys->memoria.datos, &sys->dma);
+        int pc = sys->cpu.PSW.pc;
+        palabra_t ac = sys->cpu.AC;
+        if (sys->jit != NULL && sys->cpu.paginas == NULL && !traza_activa(&sys->traza)) {
+            ciclos = jit_ejecutar_rafaga(sys->jit, &sys->cpu, &sys->memoria, &sys->dma, ciclos, &sys->estadisticas_cpu);
+        } else {
+            ciclos = cpu_ejecutar_rafaga(&sys->cpu, &sys->memoria, &sys->dma, ciclos, &sys->estadisticas_cpu);
+        }
+        sys->totales.instrucciones += ciclos;
+        if (traza_activa(&sys->traza)) {
+            sistema_trazar_instruccion(sys, &sys->cpu, 0, sys->ciclos_reloj, sys->proceso_actual, pc, ac);
+        }
     }
     
-    // Procesar interrupciones INMEDIATAMENTE despues de la instruccion
-    if (interrupcion_pendiente) {
+    // Contabilidad de los ciclos anteriores al ultimo de la rafaga. En ellos nadie despierta
+    // ni se agota el quantum (la rafaga no lo permite), y corresponden al proceso que estaba
+    // en la CPU antes de atender la interrupcion. El ultimo ciclo se contabiliza abajo.
+    if (ciclos > 1) {
+        sys->ciclos_reloj += ciclos - 1;
+        sys->contador_quantum += ciclos - 1;
+    }
+
+    // Procesar interrupciones INMEDIATAMENTE despues de la instruccion, en orden de
+    // prioridad. Las que lleguen mientras tanto se atienden en el proximo ciclo.
+    unsigned int pendientes = atomic_load(&sys->cpu.interrupciones_pendientes);
+    while (pendientes) {
+        int codigo = interrupciones_siguiente(pendientes);
+        pendientes &= ~INT_BIT(codigo);
+        if (traza_activa(&sys->traza)) {
+            sistema_trazar_interrupcion(sys, &sys->cpu, 0, sys->ciclos_reloj, sys->proceso_actual, codigo);
+        }
+
         // Si ocurre una interrupcion y no hay un manejador cargado en el vector
-        if (sys->vector_int.manejadores[codigo_interrupcion] == 0) {
+        if (sys->vector_int.manejadores[codigo] == 0 &&
+            (codigo == INT_SYSCALL || codigo == INT_DIR_INVALIDA || codigo == INT_FALLO_PAGINA)) {
             
             // Caso SVC (Codigo 2): El programa hace una llamada al sistema operativo.
-            if (codigo_interrupcion == INT_SYSCALL) {
+            if (codigo == INT_SYSCALL) {
+                interrupciones_quitar(&sys->cpu, INT_BIT(INT_SYSCALL));
                 sistema_manejar_syscall(sys);
-                interrupcion_pendiente = 0;
+            }
+
+            // Caso Fallo de pagina (Codigo 9): se carga la pagina y la instruccion se reintenta
+            else if (codigo == INT_FALLO_PAGINA && sistema_atender_fallo_pagina(sys, &sys->cpu) != -1) {
+                interrupciones_quitar(&sys->cpu, INT_BIT(INT_FALLO_PAGINA));
             }
             
-            // Caso Direccionamiento Invalido (Codigo 6): El PC se salio de RL.
-            else if (codigo_interrupcion == INT_DIR_INVALIDA) {
-                log_error("Violacion de limites de memoria", sys->cpu.PSW.pc);
-                printf("\nERROR: Direccionamiento invalido en PID %d. Terminando proceso.\n", sys->proceso_actual);
+            // Caso Direccionamiento Invalido (Codigo 6): El PC se salio de RL. Tambien un fallo
+            // de pagina sin marcos libres.
+            else {
+                if (codigo == INT_FALLO_PAGINA) {
+                    log_error(LOG_CAT_MEM, "Fallo de pagina sin marcos libres", sys->cpu.dir_fallo);
+                    printf("\nERROR: Sin marcos libres para la pagina %d del PID %d. Terminando proceso.\n",
+                           sys->cpu.dir_fallo / TAM_PAGINA, sys->proceso_actual);
+                } else {
+                    log_error(LOG_CAT_MEM, "Violacion de limites de memoria", sys->cpu.PSW.pc);
+                    printf("\nERROR: Direccionamiento invalido en PID %d. Terminando proceso.\n", sys->proceso_actual);
+                }
                 
                 // Finalizar proceso agresivamente
-                for (int i = 0; i < MAX_PROCESOS; i++) {
-                    if (sys->tabla_procesos[i].pid == sys->proceso_actual) {
-                        sys->tabla_procesos[i].estado = TERMINADO;
-                        // memoria_liberar_espacio(&sys->memoria, sys->tabla_procesos[i].contexto.RB, sys->tabla_procesos[i].contexto.RL);
-                        sistema_log(sys->proceso_actual, EJECUCION, TERMINADO);
-                        break;
-                    }
+                if (sys->proceso_actual != -1) {
+                    sistema_terminar_proceso(sys, sys->indice_actual);
+                    sys->totales.procesos_abortados++;
                 }
                 sys->proceso_actual = -1;
-                interrupcion_pendiente = 0;
+                sys->indice_actual = -1;
+                // Los demas fallos pendientes eran del proceso abortado
+                interrupciones_quitar(&sys->cpu, INT_MASCARA_SINCRONAS);
+                pendientes &= ~INT_MASCARA_SINCRONAS;
                 sistema_planificar(sys);
             }
         }
         
         // Si hay manejador o no es critica, se procesa normalmente 
-        if (interrupcion_pendiente) {
-            procesar_interrupcion(&sys->cpu, sys->memoria.datos, &sys->vector_int);
+        else {
+            procesar_interrupcion(&sys->cpu, &sys->memoria, &sys->vector_int, codigo);
         }
     }
 
-    // Despertar procesos dormidos
-    for (int i = 0; i < MAX_PROCESOS; i++) {
-        if (sys->tabla_procesos[i].estado == DORMIDO) {
-            sys->tabla_procesos[i].tics_dormido--;
-            if (sys->tabla_procesos[i].tics_dormido <= 0) {
-                sys->tabla_procesos[i].estado = LISTO;
-                sistema_log(sys->tabla_procesos[i].pid, DORMIDO, LISTO);
-            }
-        }
+    // Despertar procesos dormidos: solo se miran los que llegaron a su ciclo
+    while (sys->dormidos.cantidad > 0 &&
+           sistema_bcp(sys, sys->dormidos.indices[0])->ciclo_despertar <= sys->ciclos_reloj) {
+        int i = sistema_sacar_dormido(sys, &sys->dormidos);
+        sistema_bcp(sys, i)->estado = LISTO;
+        sistema_log(sys, sistema_bcp(sys, i)->pid, DORMIDO, LISTO);
+        sistema_encolar_listo(sys, i);
     }
 
     // Incrementar contador de ciclos y quantum si hay algo corriendo
     sys->ciclos_reloj++;
     
-    // Rastrear el pico de memoria de usuario (solo palabras de usuario)
-    int uso_actual = 0;
-    for (int i = MEM_SO; i < TAM_MEMORIA; i++) {
-        if (sys->memoria.ocupado[i]) uso_actual++;
-    }
-    if (uso_actual > sys->pico_memoria) sys->pico_memoria = uso_actual;
+    // Rastrear el pico de memoria de usuario (el contador lo lleva el mapa de ocupacion)
+    if (sys->memoria.ocupadas_usuario > sys->pico_memoria) sys->pico_memoria = sys->memoria.ocupadas_usuario;
 
     if (sys->proceso_actual != -1) {
         sys->contador_quantum++;
-        if (sys->contador_quantum >= 2) {
-            char log_msg[200];
-            sprintf(log_msg, "QUANTUM AGOTADO: Proceso saliente PID = %d", sys->proceso_actual);
-            log_mensaje(log_msg);
+        if (sys->contador_quantum >= sys->quantum) {
+            LOG_DEBUG(LOG_CAT_PLANIF, "QUANTUM AGOTADO: Proceso saliente PID = %d", sys->proceso_actual);
             sys->contador_quantum = 0;
             sistema_planificar(sys);
         }
@@ -439,199 +811,588 @@ void sistema_ciclo(Sistema_t *sys) {
         sistema_planificar(sys);
     }
     
-    if (sys->cpu.PSW.pc >= TAM_MEMORIA || sys->cpu.PSW.pc < 0) {
+    if (sys->cpu.PSW.pc >= sys->memoria.tam_memoria || sys->cpu.PSW.pc < 0) {
         if (sys->proceso_actual != -1) {
             printf("\nProceso %d finalizado (PC fuera de rango: %d)\n", sys->proceso_actual, sys->cpu.PSW.pc);
             
-            for (int i = 0; i < MAX_PROCESOS; i++) {
-                if (sys->tabla_procesos[i].pid == sys->proceso_actual) {
-                    sys->tabla_procesos[i].estado = TERMINADO;
-                    // memoria_liberar_espacio(&sys->memoria, sys->tabla_procesos[i].contexto.RB, sys->tabla_procesos[i].contexto.RL);
-                    sistema_log(sys->proceso_actual, EJECUCION, TERMINADO);
-                    break;
-                }
-            }
+            sistema_terminar_proceso(sys, sys->indice_actual);
+            sys->totales.procesos_abortados++;
             sys->proceso_actual = -1;
+            sys->indice_actual = -1;
             sistema_planificar(sys);
         }
     }
     
     // IMPORTANTE: Liberar bus de la CPU luego del ciclo
-    pthread_mutex_unlock(&sys->mutex_bus);
+    pthread_rwlock_unlock(&sys->cerrojo_bus);
 }
 
-void sistema_consola(Sistema_t *sys) {
+// Muestra los contadores del perfil de ejecucion de la CPU
+static void sistema_mostrar_perfil(void) {
+    long total = 0;
+    for (int i = 0; i <= CANT_OPCODES; i++) total += perfil_cpu.por_opcode[i];
 
-    char comando[256];   // Almacenara la linea completa que el usuario escriba.
-        
-    while (1) {
-        
-        printf("sistema> ");
-        
-        // Leemos el comando del usuario.
-        if (fgets(comando, sizeof(comando), stdin) == NULL) break;
-        
-        // Eliminamos el salto de línea del comando.
-        comando[strcspn(comando, "\n")] = 0;
+    printf("\n======================================================================\n");
+    printf("  PERFIL DE EJECUCION (%s, %ld instrucciones)\n", perfil_cpu.activo ? "activo" : "inactivo", total);
+    printf("======================================================================\n");
+    if (total == 0) {
+        printf("  Sin instrucciones contadas. Use 'perfil activar' antes de ejecutar.\n\n");
+        return;
+    }
+
+    printf("  %-10s %12s %8s\n", "OPCODE", "EJECUCIONES", "%");
+    for (int i = 0; i <= CANT_OPCODES; i++) {
+        if (perfil_cpu.por_opcode[i] == 0) continue;
+        printf("  %-10s %12ld %7.2f%%\n", cpu_nombre_opcode(i), perfil_cpu.por_opcode[i],
+               perfil_cpu.por_opcode[i] * 100.0 / total);
+    }
+    printf("  --------------------------------------------------------------------\n");
+    printf("  Direccionamiento: directo %ld, inmediato %ld, indexado %ld, otros %ld\n",
+           perfil_cpu.por_direccionamiento[DIR_DIRECTO], perfil_cpu.por_direccionamiento[DIR_INMEDIATO],
+           perfil_cpu.por_direccionamiento[DIR_INDEXADO], perfil_cpu.por_direccionamiento[3]);
+
+    printf("  Interrupciones lanzadas:\n");
+    for (int i = 0; i < CANT_INTERRUPCIONES; i++) {
+        if (perfil_cpu.interrupciones[i] == 0) continue;
+        printf("    %d %-40s %10ld\n", i, obtener_nombre_interrupcion(i), perfil_cpu.interrupciones[i]);
+    }
+
+    printf("  Tiempo del host por clase (1 de cada %d despachos):\n", PERFIL_PERIODO_MUESTREO);
+    printf("    %-12s %10s %14s\n", "CLASE", "MUESTRAS", "NS PROMEDIO");
+    for (int c = 0; c < CANT_CLASES; c++) {
+        if (perfil_cpu.muestras[c] == 0) continue;
+        printf("    %-12s %10ld %14.1f\n", cpu_nombre_clase(c), perfil_cpu.muestras[c],
+               (double)perfil_cpu.ns[c] / perfil_cpu.muestras[c]);
+    }
+    printf("======================================================================\n\n");
+}
+
+// Estado del log de la instancia (comando log sin argumentos)
+static void sistema_mostrar_log(Sistema_t *sys) {
+    printf("Log %s, nivel %s (compilado hasta %s), politica %s, %ld registros descartados\n",
+           sys->log.archivo ? "activo" : "deshabilitado",
+           log_nombre_nivel(sys->log.nivel), log_nombre_nivel(LOG_NIVEL_COMPILADO),
+           sys->log.politica == LOG_POLITICA_DESCARTAR ? "descartar" : "bloquear",
+           sys->log.archivo ? atomic_load(&sys->log.descartados) : 0L);
+    printf("Categorias:");
+    for (int i = 0; i < LOG_CANT_CATEGORIAS; i++) {
+        if (sys->log.categorias & (1u << i)) printf(" %s", log_nombre_categoria(1u << i));
+    }
+    printf("\n");
+}
+
+// Caracteres del mapa de memestat: cada uno resume la parte que le toca de la memoria de
+// usuario (25 palabras con la geometria por defecto)
+#define MARCAS_MAPA 68
+
+// Huecos, fragmentacion y costo del asignador de memoria (parte de memestat)
+static void sistema_mostrar_asignador(Sistema_t *sys) {
+    Memoria_t *mem = &sys->memoria;
+    EstadisticasMemoria_t *e = &mem->estadisticas;
+    int libre = sys->memoria.tam_usuario - mem->ocupadas_usuario;
+    int mayor = memoria_mayor_hueco(mem);
+
+    // Interna: sobrantes entregados a los procesos vivos. Externa: lo libre que no esta en
+    // el hueco mas grande (no sirve para un pedido de ese tamaño).
+    int frag_interna = 0;
+    for (int i = 0; i < sys->tabla_procesos.usados; i++) {
+        BCP_t *p = sistema_bcp(sys, i);
+        if (p->pid != 0 && p->estado != TERMINADO) frag_interna += p->tam_asignado - p->tamano_real;
+    }
+    float pct_externa = libre > 0 ? (float)(libre - mayor) * 100.0f / libre : 0.0f;
+
+    printf("  Asignador: ajuste %s, %d huecos, mayor hueco %d pal\n",
+           memoria_nombre_ajuste(mem->politica), mem->cant_huecos, mayor);
+    printf("  Fragmentacion Externa: %.2f%% de lo libre | Interna: %d pal\n", pct_externa, frag_interna);
+    printf("  Asignaciones: %ld (fallidas %ld) | Liberaciones: %ld\n", e->asignaciones, e->fallos, e->liberaciones);
+    long pedidos = e->asignaciones + e->fallos;
+    if (pedidos > 0) {
+        printf("  Latencia de asignacion: %.2f huecos revisados, %.0f ns promedio\n",
+               (double)e->huecos_revisados / pedidos, e->segundos * 1e9 / pedidos);
+    }
+    if (sys->paginacion || e->paginas_cargadas > 0) {
+        printf("  Paginacion: %s | Paginas cargadas: %ld (%ld por fallo de pagina)\n",
+               sys->paginacion ? "activa" : "inactiva", e->paginas_cargadas, e->fallos_pagina);
+    }
+    if (sys->codigo_compartido || e->paginas_compartidas > 0) {
+        // Cada pagina resuelta con un marco ya cargado es un marco que no se duplico
+        printf("  Codigo compartido: %s | Paginas reusadas: %ld (%ld pal sin duplicar) | Copias por escritura: %ld\n",
+               sys->codigo_compartido ? "activo" : "inactivo", e->paginas_compartidas,
+               e->paginas_compartidas * TAM_PAGINA, e->copias_escritura);
+    }
+    Intercambio_t *area = &sys->intercambio;
+    if (area->salidas > 0) {
+        printf("  Intercambio: %s | %d procesos en disco (pico %d) | Salidas: %ld (%ld pal) | Entradas: %ld (%ld pal)\n",
+               sistema_nombre_intercambio(area->politica), area->en_disco, area->pico_en_disco,
+               area->salidas, area->palabras_salida, area->entradas, area->palabras_entrada);
+        printf("  Latencia de intercambio: %.1f us por salida, %.1f us por entrada\n",
+               area->segundos_salida * 1e6 / area->salidas,
+               area->entradas ? area->segundos_entrada * 1e6 / area->entradas : 0.0);
+    }
+}
+
+// Lee un entero positivo que ocupe todo el argumento; 0 si sobra texto o no cabe en un int
+static int sistema_leer_positivo(const char *texto, int *valor) {
+    char *fin;
+    errno = 0;
+    long n = strtol(texto, &fin, 10);
+    if (fin == texto || *fin != '\0' || errno == ERANGE || n < 1 || n > INT_MAX) return 0;
+    *valor = (int)n;
+    return 1;
+}
+
+int sistema_ejecutar_comando(Sistema_t *sys, char *comando) {
+    // Eliminamos el salto de línea del comando.
+    comando[strcspn(comando, "\n")] = 0;
+
+    // Extraer el primer token (el comando). Las lineas vacias no hacen nada.
+    // strtok_r: varias instancias pueden interpretar comandos en paralelo (granja)
+    char *resto;
+    char *token = strtok_r(comando, " ", &resto);
+    if (!token) return CONSOLA_CONTINUAR;
+
+    // Comando para ejecutar procesos (ejecutar <p1> <p2> ..., <p>:<n> son n copias de p)
+    if (strcmp(token, "ejecutar") == 0) {
+        int procesos_creados = 0;
+        char *prog = strtok_r(NULL, " ", &resto);
         
-        // Volvemos al ciclo si no ingresó nada.
-        if (strlen(comando) == 0) continue;
-    
-        // Extraer el primer token (el comando)
-        char *token = strtok(comando, " ");
-        if (!token) continue;
-    
-        // Comando para ejecutar procesos (ejecutar <p1> <p2> ...)
-        if (strcmp(token, "ejecutar") == 0) {
-            int procesos_creados = 0;
-            char *prog = strtok(NULL, " ");
-            
-            // Loop de extracción de parámetros (todos son programas)
-            while (prog != NULL) {
-                if (sistema_crear_proceso(sys, prog) != -1) {
-                    procesos_creados++;
+        // Loop de extracción de parámetros (todos son programas)
+        while (prog != NULL) {
+            int copias = 1;
+            char *cantidad = strrchr(prog, ':');
+            if (cantidad != NULL) {
+                if (!sistema_leer_positivo(cantidad + 1, &copias)) {
+                    printf("Uso: ejecutar <programa>:<n>  (n entero entre 1 y %d, en '%s')\n", INT_MAX, prog);
+                    prog = strtok_r(NULL, " ", &resto);
+                    continue;
                 }
-                prog = strtok(NULL, " ");
+                *cantidad = '\0';
             }
-            
-            if (procesos_creados > 0) {
-                sistema_iniciar_ejecucion(sys);
-            } else {
-                printf("No se crearon procesos validos.\n");
+            for (int c = 0; c < copias; c++) {
+                if (sistema_crear_proceso(sys, prog) == -1) break;
+                procesos_creados++;
+                sys->totales.procesos_creados++;
             }
+            prog = strtok_r(NULL, " ", &resto);
+        }
+        
+        if (procesos_creados > 0) {
+            sistema_iniciar_ejecucion(sys);
+        } else {
+            printf("No se crearon procesos validos.\n");
+            return CONSOLA_ERROR;
         }
+    }
 
-        // Comando para mostrar el contenido completo de la memoria.
-        else if (strcmp(token, "memestat") == 0) {
-            int ocupada = 0;
-            // Calcular ocupación solo en área de usuario para el porcentaje de usuario
-            for (int i = MEM_SO; i < TAM_MEMORIA; i++) {
-                if (sys->memoria.ocupado[i]) ocupada++;
-            }
-            float pct_actual = (float)ocupada * 100.0f / MEM_USUARIO;
-            float pct_pico = (float)sys->pico_memoria * 100.0f / MEM_USUARIO;
-
-            printf("\n======================================================================\n");
-            printf("  ESTADO DE LA MEMORIA PRINCIPAL (Total: %d palabras)\n", TAM_MEMORIA);
-            printf("======================================================================\n");
-            printf("  AREA SO      : RAM[0] a RAM[%d]\n", MEM_SO - 1);
-            printf("  AREA USUARIO : RAM[%d] a RAM[%d]\n", MEM_SO, TAM_MEMORIA - 1);
-            printf("  --------------------------------------------------------------------\n");
-            printf("  Uso Actual Usuario : %d pal (%.2f%%)\n", ocupada, pct_actual);
-            printf("  Pico Maximo Usuario: %d pal (%.2f%%)\n", sys->pico_memoria, pct_pico);
-            printf("  --------------------------------------------------------------------\n");
-            
-            printf("  Mapa de Particiones (20 de %d pal):\n  [", TAM_PARTICION);
-            for (int p = 0; p < MAX_PROCESOS; p++) {
-                int inicio = MEM_SO + (p * TAM_PARTICION);
-                printf("%c", sys->memoria.ocupado[inicio] ? 'P' : '.');
+    // Comando para mostrar el contenido completo de la memoria.
+    else if (strcmp(token, "memestat") == 0) {
+        // Ocupación solo del área de usuario para el porcentaje de usuario
+        int ocupada = sys->memoria.ocupadas_usuario;
+        float pct_actual = (float)ocupada * 100.0f / sys->memoria.tam_usuario;
+        float pct_pico = (float)sys->pico_memoria * 100.0f / sys->memoria.tam_usuario;
+
+        printf("\n======================================================================\n");
+        printf("  ESTADO DE LA MEMORIA PRINCIPAL (Total: %d palabras)\n", sys->memoria.tam_memoria);
+        printf("======================================================================\n");
+        printf("  AREA SO      : RAM[0] a RAM[%d]\n", sys->memoria.mem_so - 1);
+        printf("  AREA USUARIO : RAM[%d] a RAM[%d]\n", sys->memoria.mem_so, sys->memoria.tam_memoria - 1);
+        printf("  --------------------------------------------------------------------\n");
+        printf("  Uso Actual Usuario : %d pal (%.2f%%)\n", ocupada, pct_actual);
+        printf("  Pico Maximo Usuario: %d pal (%.2f%%)\n", sys->pico_memoria, pct_pico);
+        printf("  --------------------------------------------------------------------\n");
+        
+        sistema_mostrar_asignador(sys);
+        printf("  --------------------------------------------------------------------\n");
+
+        int por_marca = (sys->memoria.tam_usuario + MARCAS_MAPA - 1) / MARCAS_MAPA;
+        printf("  Mapa de Memoria de Usuario (%d pal por caracter):\n  [", por_marca);
+        for (int inicio = sys->memoria.mem_so; inicio < sys->memoria.tam_memoria; inicio += por_marca) {
+            int usadas = 0, total = 0;
+            for (int i = inicio; i < inicio + por_marca && i < sys->memoria.tam_memoria; i++, total++) {
+                usadas += memoria_ocupada(&sys->memoria, i);
             }
-            printf("] (P:Ocupada, .:Libre)\n");
-            printf("======================================================================\n");
+            printf("%c", usadas == total ? '#' : (usadas > 0 ? '+' : '.'));
+        }
+        printf("]\n  (#:Ocupado, +:En parte, .:Libre)\n");
+        printf("======================================================================\n");
 
-            printf("\n  CONTENIDO DE LA MEMORIA (Volcado Completo):\n");
-            printf("  Dir. |  +0      +1      +2      +3      +4      +5      +6      +7      +8      +9\n");
-            printf("  -----+----------------------------------------------------------------------------\n");
-            
-            for (int i = 0; i < TAM_MEMORIA; i += 10) {
-                // Solo imprimir si hay algo de datos en este bloque de 10 o es el inicio de un area clave
-                int tiene_datos = 0;
-                for(int j=0; j<10 && (i+j)<TAM_MEMORIA; j++) {
-                    if (sys->memoria.datos[i+j] != 0 || sys->memoria.ocupado[i+j]) {
-                        tiene_datos = 1;
-                        break;
-                    }
+        printf("\n  CONTENIDO DE LA MEMORIA (Volcado Completo):\n");
+        printf("  Dir. |  +0      +1      +2      +3      +4      +5      +6      +7      +8      +9\n");
+        printf("  -----+----------------------------------------------------------------------------\n");
+        
+        for (int i = 0; i < sys->memoria.tam_memoria; i += 10) {
+            // Solo imprimir si hay algo de datos en este bloque de 10 o es el inicio de un area clave
+            int tiene_datos = 0;
+            for(int j=0; j<10 && (i+j)<sys->memoria.tam_memoria; j++) {
+                if (sys->memoria.datos[i+j] != 0 || memoria_ocupada(&sys->memoria, i+j)) {
+                    tiene_datos = 1;
+                    break;
                 }
+            }
 
-                if (tiene_datos || i == 0 || i == MEM_SO) {
-                    printf("  %04d |", i);
-                    for (int j = 0; j < 10; j++) {
-                        if (i + j < TAM_MEMORIA) {
-                            printf(" %07d", sys->memoria.datos[i+j]);
-                        }
+            if (tiene_datos || i == 0 || i == sys->memoria.mem_so) {
+                printf("  %04d |", i);
+                for (int j = 0; j < 10; j++) {
+                    if (i + j < sys->memoria.tam_memoria) {
+                        printf(" %07d", palabra_a_sm(sys->memoria.datos[i+j]));
                     }
-                    printf("\n");
-                } else if (i > 0 && (i % 100 == 0)) {
-                    // Un pequeño indicador de bloques vacíos para no perder la noción de la dirección
-                    // pero sin llenar la pantalla de ceros.
-                    // printf("  .... | (bloque vacio hasta %04d)\n", i + 9);
                 }
+                printf("\n");
+            } else if (i > 0 && (i % 100 == 0)) {
+                // Un pequeño indicador de bloques vacíos para no perder la noción de la dirección
+                // pero sin llenar la pantalla de ceros.
+                // printf("  .... | (bloque vacio hasta %04d)\n", i + 9);
             }
-            printf("  ----------------------------------------------------------------------------------\n\n");
-        }
-
-        // Comando para mostrar todos los procesos del sistema.
-        else if (strcmp(token, "ps") == 0) {
-            printf("\n--- Tabla de Procesos ---\n");
-            printf("%-5s | %-12s | %-15s | %-8s | %-8s\n", "PID", "ESTADO", "PROGRAMA", "% ASIG", "% REAL");
-            printf("--------------------------------------------------------------------\n");
-            const char* nombres_estado[] = {"NUEVO", "LISTO", "EJECUCION", "DORMIDO", "TERMINADO"};
-            int encontrados = 0;
-            for(int i = 0; i < MAX_PROCESOS; i++) {
-                if (sys->tabla_procesos[i].pid != 0) {
-                    encontrados++;
-                    float pct_asig = (float)TAM_PARTICION * 100.0f / MEM_USUARIO;
-                    float pct_real = (float)sys->tabla_procesos[i].tamano_real * 100.0f / MEM_USUARIO;
-                    
-                    printf("%-5d | %-12s | %-15s | %6.2f%% | %6.2f%%\n", 
-                           sys->tabla_procesos[i].pid,
-                           nombres_estado[sys->tabla_procesos[i].estado],
-                           sys->tabla_procesos[i].nombre_programa,
-                           pct_asig,
-                           pct_real);
+        }
+        printf("  ----------------------------------------------------------------------------------\n\n");
+    }
+
+    // Comando para mostrar todos los procesos del sistema.
+    else if (strcmp(token, "ps") == 0) {
+        printf("\n--- Tabla de Procesos ---\n");
+        int smp = sys->cant_nucleos > 1;
+        printf("%-5s | %-12s | %-15s | %-8s | %-8s", "PID", "ESTADO", "PROGRAMA", "% ASIG", "% REAL");
+        printf(smp ? " | NUCLEO\n" : "\n");
+        printf("--------------------------------------------------------------------%s\n", smp ? "---------" : "");
+        const char* nombres_estado[] = {"NUEVO", "LISTO", "EJECUCION", "DORMIDO", "TERMINADO"};
+        int encontrados = 0;
+        for(int i = 0; i < sys->tabla_procesos.usados; i++) {
+            if (sistema_bcp(sys, i)->pid != 0) {
+                encontrados++;
+                float pct_asig = (float)sistema_bcp(sys, i)->tam_asignado * 100.0f / sys->memoria.tam_usuario;
+                float pct_real = (float)sistema_bcp(sys, i)->tamano_real * 100.0f / sys->memoria.tam_usuario;
+                char estado[16];
+                snprintf(estado, sizeof(estado), "%s%s", nombres_estado[sistema_bcp(sys, i)->estado],
+                         sistema_bcp(sys, i)->en_disco ? "/DISCO" : "");
+                
+                printf("%-5d | %-12s | %-15s | %6.2f%% | %6.2f%%", 
+                       sistema_bcp(sys, i)->pid,
+                       estado,
+                       sistema_bcp(sys, i)->nombre_programa,
+                       pct_asig,
+                       pct_real);
+                if (smp) {
+                    printf(" | %d", sistema_bcp(sys, i)->nucleo);
                 }
+                printf("\n");
             }
-            if (encontrados == 0) {
-                printf("No hay procesos en el sistema.\n");
-            }
-            printf("\n");
         }
-
-        // Comando para apagar el sistema.
-        else if (strcmp(token, "apagar") == 0) {
-            printf("Apagando el sistema...\n");
-            break; 
+        if (encontrados == 0) {
+            printf("No hay procesos en el sistema.\n");
         }
+        printf("\n");
+    }
 
-        // Comando para reiniciar el sistema.
-        else if (strcmp(token, "reiniciar") == 0) {
-            printf("Reiniciando el sistema...\n");
-            sistema_limpiar(sys);
-            sistema_inicializar(sys);
-        }
+    // Comando para apagar el sistema.
+    else if (strcmp(token, "apagar") == 0) {
+        printf("Apagando el sistema...\n");
+        return CONSOLA_APAGAR;
+    }
 
-        // Comando de ayuda para conocer todos los comandos.
-        else if (strcmp(token, "ayuda") == 0) {
-            printf("\n");
-            printf(" +----------------------------------------------------------------------+\n");
-            printf(" |                    COMANDOS DEL SISTEMA OPERATIVO                    |\n");
-            printf(" +------------------------+---------------------------------------------+\n");
-            printf(" |  COMANDO               |  DESCRIPCION                                |\n");
-            printf(" +------------------------+---------------------------------------------+\n");
-            printf(" |  ejecutar <p1> <pn...>  |  Carga y ejecuta programas en paralelo.     |\n");
-            printf(" |  memestat               |  Estado de Memoria Principal y %% de uso.    |\n");
-            printf(" |  ps                     |  Tabla de Procesos (PID, Estado, RAM).       |\n");
-            printf(" |  reiniciar              |  Limpia memoria y reinicia el simulador.     |\n");
-            printf(" |  apagar                 |  Finaliza la consola y apaga el SO.          |\n");
-            printf(" |  ayuda                  |  Muestra este menu de opciones.              |\n");
-            printf(" +------------------------+---------------------------------------------+\n");
+    // Comando para reiniciar el sistema.
+    else if (strcmp(token, "reiniciar") == 0) {
+        printf("Reiniciando el sistema...\n");
+        int modo_debug = sys->cpu.modo_debug; // El modo debug y el log sobreviven al reinicio
+        sistema_liberar(sys);
+        sistema_preparar(sys);
+        sys->cpu.modo_debug = modo_debug;
+    }
+
+    // Comando de ayuda para conocer todos los comandos.
+    else if (strcmp(token, "ayuda") == 0) {
+        printf("\n");
+        printf(" +----------------------------------------------------------------------+\n");
+        printf(" |                    COMANDOS DEL SISTEMA OPERATIVO                    |\n");
+        printf(" +------------------------+---------------------------------------------+\n");
+        printf(" |  COMANDO               |  DESCRIPCION                                |\n");
+        printf(" +------------------------+---------------------------------------------+\n");
+        printf(" |  ejecutar <p1> <pn...>  |  Carga y ejecuta programas en paralelo.     |\n");
+        printf(" |                         |  <p>:<n> crea n procesos con el programa p.  |\n");
+        printf(" |  memestat               |  Estado de Memoria Principal y %% de uso.    |\n");
+        printf(" |  ps                     |  Tabla de Procesos (PID, Estado, RAM).       |\n");
+        printf(" |  rafaga <n>             |  Ciclos por adquisicion del bus (def. %d).    |\n", RAFAGA_DEFECTO);
+        printf(" |  quantum <n>            |  Ciclos por turno de cada proceso (def. %d).  |\n", QUANTUM_DEFECTO);
+        printf(" |  nucleos <n>            |  CPUs virtuales en paralelo (def. 1).        |\n");
+        printf(" |  ajuste <politica>      |  Asignacion de memoria: primero, mejor o     |\n");
+        printf(" |                         |  siguiente (def. primero).                   |\n");
+        printf(" |  paginacion [activar|.] |  Paginar los procesos nuevos (paginas de %d  |\n", TAM_PAGINA);
+        printf(" |                         |  palabras, por demanda). Def. desactivada.   |\n");
+        printf(" |                         |  compartida: un solo codigo por programa.    |\n");
+        printf(" |  intercambio [lru|...]  |  Con la memoria llena lleva al disco: lru,   |\n");
+        printf(" |                         |  sueno o desactivar (def. lru).              |\n");
+        printf(" |  perfil [activar|...]   |  Conteo por opcode (activar, desactivar,     |\n");
+        printf(" |                         |  reiniciar). Sin argumento lo muestra.       |\n");
+        printf(" |  log [bloquear|...]     |  Con el anillo del log lleno: esperar o      |\n");
+        printf(" |                         |  descartar. Sin argumento muestra el estado. |\n");
+        printf(" |  log nivel <n>          |  error, info, debug o traza.                 |\n");
+        printf(" |  log categorias <c,...> |  todas o cpu, mem, dma, planif, int, sis.    |\n");
+        printf(" |  traza <archivo>|off    |  Traza binaria de cada instruccion (ver     |\n");
+        printf(" |                         |  trazadec). Sin argumento muestra el estado. |\n");
+        printf(" |  reiniciar              |  Limpia memoria y reinicia el simulador.     |\n");
+        printf(" |  apagar                 |  Finaliza la consola y apaga el SO.          |\n");
+        printf(" |  ayuda                  |  Muestra este menu de opciones.              |\n");
+        printf(" +------------------------+---------------------------------------------+\n");
+        printf("\n");
+    }
+    // Comandos para ajustar la planificacion (rafaga <n>, quantum <n>)
+    else if (strcmp(token, "rafaga") == 0 || strcmp(token, "quantum") == 0) {
+        char *arg = strtok_r(NULL, " ", &resto);
+        int valor;
+        if (!arg || !sistema_leer_positivo(arg, &valor)) {
+            printf("Uso: %s <ciclos>  (entero entre 1 y %d)\n", token, INT_MAX);
+            return CONSOLA_ERROR;
+        } else if (strcmp(token, "rafaga") == 0) {
+            sys->tam_rafaga = valor;
+            printf("Rafaga de CPU: hasta %d ciclos por adquisicion del bus\n", valor);
+        } else {
+            sys->quantum = valor;
+            printf("Quantum: %d ciclos\n", valor);
+        }
+    }
+    // Comando para elegir la cantidad de CPUs virtuales (nucleos <n>)
+    else if (strcmp(token, "nucleos") == 0) {
+        char *arg = strtok_r(NULL, " ", &resto);
+        int valor = arg ? atoi(arg) : 0;
+        if (valor < 1 || valor > MAX_NUCLEOS) {
+            printf("Uso: nucleos <n>  (entre 1 y %d)\n", MAX_NUCLEOS);
+            return CONSOLA_ERROR;
+        }
+        sys->cant_nucleos = valor;
+        printf("Nucleos: %d%s\n", valor, valor > 1 ? " (multiprocesador, sin JIT)" : "");
+    }
+    // Comando para el perfil de ejecucion (perfil [activar|desactivar|reiniciar])
+    else if (strcmp(token, "perfil") == 0) {
+        char *arg = strtok_r(NULL, " ", &resto);
+        if (arg == NULL) {
+            sistema_mostrar_perfil();
+        } else if (strcmp(arg, "activar") == 0 || strcmp(arg, "desactivar") == 0) {
+            perfil_cpu.activo = strcmp(arg, "activar") == 0;
+            printf("Perfil de ejecucion %s\n", perfil_cpu.activo ? "ACTIVADO" : "DESACTIVADO");
+        } else if (strcmp(arg, "reiniciar") == 0) {
+            cpu_perfil_reiniciar();
+            printf("Contadores del perfil en cero\n");
+        } else {
+            printf("Uso: perfil [activar|desactivar|reiniciar]\n");
+            return CONSOLA_ERROR;
+        }
+    }
+    // Comando para configurar el log (log [bloquear|descartar], log nivel <n>, log categorias <c,...>)
+    else if (strcmp(token, "log") == 0) {
+        char *arg = strtok_r(NULL, " ", &resto);
+        if (arg == NULL) {
+            sistema_mostrar_log(sys);
+        } else if (strcmp(arg, "bloquear") == 0 || strcmp(arg, "descartar") == 0) {
+            sys->log.politica = strcmp(arg, "descartar") == 0 ? LOG_POLITICA_DESCARTAR : LOG_POLITICA_BLOQUEAR;
+            printf("Con el anillo del log lleno: %s\n", sys->log.politica == LOG_POLITICA_DESCARTAR
+                   ? "se descartan los registros" : "se espera al escritor");
+        } else if (strcmp(arg, "nivel") == 0) {
+            char *nombre = strtok_r(NULL, " ", &resto);
+            int nivel = -1;
+            for (int i = LOG_NIVEL_ERROR; nombre && i <= LOG_NIVEL_TRAZA; i++) {
+                if (strcmp(nombre, log_nombre_nivel(i)) == 0) nivel = i;
+            }
+            if (nivel == -1) {
+                printf("Uso: log nivel <error|info|debug|traza>\n");
+                return CONSOLA_ERROR;
+            }
+            sys->log.nivel = nivel;
+            printf("Nivel del log: %s", log_nombre_nivel(nivel));
+            if (nivel > LOG_NIVEL_COMPILADO) {
+                printf(" (compilado solo hasta %s)", log_nombre_nivel(LOG_NIVEL_COMPILADO));
+            }
             printf("\n");
+        } else if (strcmp(arg, "categorias") == 0) {
+            char *lista = strtok_r(NULL, " ", &resto);
+            unsigned int categorias = 0;
+            char *resto_lista;
+            for (char *c = lista ? strtok_r(lista, ",", &resto_lista) : NULL; c != NULL; c = strtok_r(NULL, ",", &resto_lista)) {
+                unsigned int bit = 0;
+                if (strcmp(c, "todas") == 0) bit = LOG_CAT_TODAS;
+                for (int i = 0; i < LOG_CANT_CATEGORIAS; i++) {
+                    if (strcmp(c, log_nombre_categoria(1u << i)) == 0) bit = 1u << i;
+                }
+                if (bit == 0) {
+                    categorias = 0;
+                    break;
+                }
+                categorias |= bit;
+            }
+            if (categorias == 0) {
+                printf("Uso: log categorias <todas|cpu,mem,dma,planif,int,sis>\n");
+                return CONSOLA_ERROR;
+            }
+            sys->log.categorias = categorias;
+            sistema_mostrar_log(sys);
+        } else {
+            printf("Uso: log [bloquear|descartar|nivel <n>|categorias <c,...>]\n");
+            return CONSOLA_ERROR;
+        }
+    }
+    // Comando para la traza binaria de la ejecucion (traza <archivo>|off)
+    else if (strcmp(token, "traza") == 0) {
+        char *arg = strtok_r(NULL, " ", &resto);
+        if (arg == NULL) {
+            if (traza_activa(&sys->traza)) {
+                printf("Traza activa, %ld registros\n", sys->traza.registros);
+            } else {
+                printf("Traza deshabilitada\n");
+            }
+        } else if (strcmp(arg, "off") == 0) {
+            if (traza_activa(&sys->traza)) {
+                traza_cerrar(&sys->traza);
+                printf("Traza cerrada (%ld registros)\n", sys->traza.registros);
+            }
+        } else {
+            traza_cerrar(&sys->traza);
+            if (traza_abrir(&sys->traza, arg, sys->cant_nucleos, sys->memoria.tam_memoria, sys->memoria.mem_so) != 0) {
+                printf("Error: No se pudo crear el archivo de traza %s\n", arg);
+                return CONSOLA_ERROR;
+            }
+            LOG_INFO(LOG_CAT_SIS, "Traza binaria activada");
+            printf("Traza en %s (rafagas de 1 ciclo mientras este activa)\n", arg);
+        }
+    }
+    // Comando para la politica del asignador de memoria (ajuste [primero|mejor|siguiente])
+    else if (strcmp(token, "ajuste") == 0) {
+        char *arg = strtok_r(NULL, " ", &resto);
+        int politica = -1;
+        for (int i = AJUSTE_PRIMERO; arg && i <= AJUSTE_SIGUIENTE; i++) {
+            if (strcmp(arg, memoria_nombre_ajuste(i)) == 0) politica = i;
         }
-        // Comando para alternar el modo debugger
-        else if (strcmp(token, "debug") == 0) {
-            g_modo_debug = !g_modo_debug;
-            printf("Modo debugger %s\n", g_modo_debug ? "ACTIVADO" : "DESACTIVADO");
+        if (arg != NULL && politica == -1) {
+            printf("Uso: ajuste [primero|mejor|siguiente]\n");
+            return CONSOLA_ERROR;
         }
-        // Si se detecta un comando inválido.
-        else {
-            printf("Comando '%s' no reconocido. Escribe 'ayuda' para ver comandos disponibles.\n", token);
+        if (politica != -1) {
+            pthread_mutex_lock(&sys->mutex_memoria);
+            sys->memoria.politica = politica;
+            pthread_mutex_unlock(&sys->mutex_memoria);
         }
+        printf("Asignacion de memoria: ajuste %s\n", memoria_nombre_ajuste(sys->memoria.politica));
     }
+    // Comando para paginar los procesos que se creen a continuacion (paginacion [activar|compartida|desactivar])
+    else if (strcmp(token, "paginacion") == 0) {
+        char *arg = strtok_r(NULL, " ", &resto);
+        if (arg != NULL && strcmp(arg, "activar") == 0) {
+            sys->paginacion = 1;
+            sys->codigo_compartido = 0;
+        } else if (arg != NULL && strcmp(arg, "compartida") == 0) {
+            sys->paginacion = 1;
+            sys->codigo_compartido = 1;
+        } else if (arg != NULL && strcmp(arg, "desactivar") == 0) {
+            sys->paginacion = 0;
+            sys->codigo_compartido = 0;
+        } else if (arg != NULL) {
+            printf("Uso: paginacion [activar|compartida|desactivar]\n");
+            return CONSOLA_ERROR;
+        }
+        printf("Paginacion %s para los procesos nuevos (paginas de %d palabras, TLB de %d entradas%s)\n",
+               sys->paginacion ? "ACTIVADA" : "DESACTIVADA", TAM_PAGINA, TAM_TLB,
+               sys->codigo_compartido ? ", codigo compartido por programa" : "");
+    }
+    // Comando para la politica de intercambio de procesos (intercambio [lru|sueno|desactivar])
+    else if (strcmp(token, "intercambio") == 0) {
+        char *arg = strtok_r(NULL, " ", &resto);
+        int politica = -1;
+        if (arg != NULL && strcmp(arg, "desactivar") == 0) politica = INTERCAMBIO_NO;
+        for (int i = INTERCAMBIO_LRU; arg && i <= INTERCAMBIO_SUENO; i++) {
+            if (strcmp(arg, sistema_nombre_intercambio(i)) == 0) politica = i;
+        }
+        if (arg != NULL && politica == -1) {
+            printf("Uso: intercambio [lru|sueno|desactivar]\n");
+            return CONSOLA_ERROR;
+        }
+        if (politica != -1) sys->intercambio.politica = politica;
+        printf("Intercambio de procesos: %s (%d sectores de disco, %d procesos en disco)\n",
+               sistema_nombre_intercambio(sys->intercambio.politica), DISCO_SECTORES_INTERCAMBIO,
+               sys->intercambio.en_disco);
+    }
+    // Comando para alternar el modo debugger
+    else if (strcmp(token, "debug") == 0) {
+        sys->cpu.modo_debug = !sys->cpu.modo_debug;
+        printf("Modo debugger %s\n", sys->cpu.modo_debug ? "ACTIVADO" : "DESACTIVADO");
+    }
+    // Si se detecta un comando inválido.
+    else {
+        printf("Comando '%s' no reconocido. Escribe 'ayuda' para ver comandos disponibles.\n", token);
+        return CONSOLA_ERROR;
+    }
+    return CONSOLA_CONTINUAR;
 }
 
-void sistema_limpiar(Sistema_t *sys) {
-    dma_terminar(&sys->dma);
-    pthread_mutex_destroy(&sys->mutex_bus);
-    pthread_mutex_destroy(&sys->mutex_memoria);
-    log_mensaje("Sistema finalizado correctamente");
+void sistema_consola(Sistema_t *sys) {
+
+    char comando[TAM_LINEA_COMANDO];   // Almacenara la linea completa que el usuario escriba.
+        
+    while (1) {
+        
+        printf("sistema> ");
+        
+        // Leemos el comando del usuario.
+        if (fgets(comando, sizeof(comando), stdin) == NULL) break;
+
+        if (sistema_ejecutar_comando(sys, comando) == CONSOLA_APAGAR) break;
+    }
+}
+
+int sistema_ejecutar_script(Sistema_t *sys, const char *archivo) {
+    FILE *f = fopen(archivo, "r");
+    if (!f) {
+        printf("Error: No se pudo abrir el script %s\n", archivo);
+        log_error(LOG_CAT_SIS, "Script no encontrado", 0);
+        return CONSOLA_ERROR;
+    }
+
+    char linea[TAM_LINEA_COMANDO];
+    int resultado = CONSOLA_CONTINUAR;
+    while (fgets(linea, sizeof(linea), f) != NULL) {
+        linea[strcspn(linea, "#")] = 0;
+        int r = sistema_ejecutar_comando(sys, linea);
+        if (r == CONSOLA_ERROR) resultado = CONSOLA_ERROR;
+        if (r == CONSOLA_APAGAR) {
+            if (resultado != CONSOLA_ERROR) resultado = CONSOLA_APAGAR;
+            break;
+        }
+    }
+    fclose(f);
+    return resultado;
+}
+
+void sistema_imprimir_totales(Sistema_t *sys, FILE *salida) {
+    TotalesSistema_t *t = &sys->totales;
+    double mips = t->segundos > 0 ? t->instrucciones / t->segundos / 1e6 : 0.0;
+    fprintf(salida, "{\"ciclos\": %d, \"instrucciones\": %ld, \"cambios_contexto\": %ld, "
+                    "\"procesos\": %d, \"abortados\": %d, \"segundos\": %.6f, \"mips\": %.3f",
+                    sys->ciclos_reloj, t->instrucciones, t->cambios_contexto,
+                    t->procesos_creados, t->procesos_abortados, t->segundos, mips);
+
+    // Con el perfil activo se agregan sus contadores (solo los distintos de cero)
+    if (perfil_cpu.activo) {
+        const char *sep = "";
+        fprintf(salida, ", \"perfil\": {\"opcodes\": {");
+        for (int i = 0; i <= CANT_OPCODES; i++) {
+            if (perfil_cpu.por_opcode[i] == 0) continue;
+            fprintf(salida, "%s\"%s\": %ld", sep, cpu_nombre_opcode(i), perfil_cpu.por_opcode[i]);
+            sep = ", ";
+        }
+        fprintf(salida, "}, \"direccionamiento\": {\"directo\": %ld, \"inmediato\": %ld, \"indexado\": %ld, \"otros\": %ld}",
+                        perfil_cpu.por_direccionamiento[DIR_DIRECTO], perfil_cpu.por_direccionamiento[DIR_INMEDIATO],
+                        perfil_cpu.por_direccionamiento[DIR_INDEXADO], perfil_cpu.por_direccionamiento[3]);
+        sep = "";
+        fprintf(salida, ", \"interrupciones\": {");
+        for (int i = 0; i < CANT_INTERRUPCIONES; i++) {
+            if (perfil_cpu.interrupciones[i] == 0) continue;
+            fprintf(salida, "%s\"%d\": %ld", sep, i, perfil_cpu.interrupciones[i]);
+            sep = ", ";
+        }
+        sep = "";
+        fprintf(salida, "}, \"ns_por_clase\": {");
+        for (int c = 0; c < CANT_CLASES; c++) {
+            if (perfil_cpu.muestras[c] == 0) continue;
+            fprintf(salida, "%s\"%s\": %.1f", sep, cpu_nombre_clase(c), (double)perfil_cpu.ns[c] / perfil_cpu.muestras[c]);
+            sep = ", ";
+        }
+        fprintf(salida, "}}");
+    }
+    fprintf(salida, "}\n");
 }
\ No newline at end of file
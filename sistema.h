@@ -7,43 +7,199 @@
 #include "dma.h"
 #include "interrupciones.h"
 #include "disco.h"
+#include "jit.h"
+#include "traza.h"
+#include "procesos.h"
 #include <pthread.h>
+#include <stdio.h>
 
-// Estructura principal del sistema
+// Planificacion por defecto: quantum de 2 ciclos y una instruccion por adquisicion del bus
+#define QUANTUM_DEFECTO 2
+#define RAFAGA_DEFECTO 1
+
+// Largo maximo de una linea de comandos (consola, scripts y argumentos -c)
+#define TAM_LINEA_COMANDO 1024
+
+// Resultado de sistema_ejecutar_comando
+#define CONSOLA_CONTINUAR 0
+#define CONSOLA_APAGAR 1
+#define CONSOLA_ERROR -1
+
+// Cola de listos del planificador de un nucleo: FIFO intrusiva de indices de la tabla de
+// procesos. Los enlaces van en el BCP (BCP_t.siguiente), asi encolar y sacar son O(1).
+typedef struct {
+    int frente;     // Primer indice (-1: vacia)
+    int fin;        // Ultimo indice
+    int cantidad;
+} ColaProcesos_t;
+
+// Procesos dormidos del planificador (el del sistema y uno por nucleo SMP, cada uno con su
+// reloj): monticulo de minimos de indices de la tabla de procesos, ordenado por ciclo de
+// despertar y por indice en los empates (el mismo orden en que los despertaba el recorrido
+// de la tabla). Ver el tope es O(1) y dormir o despertar un proceso es O(log n). El del
+// sistema crece con la tabla de procesos al crear uno.
+typedef struct {
+    int *indices;
+    int capacidad;
+    int cantidad;
+} MonticuloDormidos_t;
+
+// Multiprocesador simetrico: nucleos maximos (comando "nucleos <n>")
+#define MAX_NUCLEOS 16
+
+// Cola de listos de un nucleo: indices de la tabla de procesos en orden de llegada.
+// El dueño encola al final y toma del frente; otro nucleo sin trabajo roba del final.
+// Es circular, con lugar para toda la tabla de procesos (no se crean procesos en SMP).
+typedef struct {
+    int *indices;
+    int capacidad;
+    int frente;
+    int cantidad;
+    pthread_mutex_t mutex;
+} ColaListos_t;
+
+// Estado de una CPU virtual del modo SMP. Cada nucleo corre en su propio hilo.
 typedef struct {
+    int id;
+    struct Sistema *sistema;
+    CPU_t cpu;
+    int proceso_actual;         // Indice en la tabla de procesos (-1: ocioso)
+    int contador_quantum;
+    ColaListos_t cola;
+    MonticuloDormidos_t dormidos; // Procesos que se durmieron en este nucleo, por ciclo_despertar
+                                // en su reloj (ciclos); solo los toca el, y al despertar
+                                // vuelven a su cola
+    pthread_t hilo;
+
+    long ciclos;                // Ciclos locales del nucleo (ejecutando u ocioso)
+    long instrucciones;
+    long cambios_contexto;
+    long robos;                 // Procesos tomados de la cola de otro nucleo
+    long rafagas;
+    int procesos_abortados;
+    EstadisticasCPU_t estadisticas;
+    int perfil_activo;          // Copia de perfil_cpu.activo del hilo principal
+    PerfilCPU_t perfil;         // Contadores del hilo del nucleo, para sumarlos al terminar
+} Nucleo_t;
+
+// Politicas de victima del intercambio de procesos (comando "intercambio")
+#define INTERCAMBIO_NO 0        // Sin intercambio: si no hay hueco, el proceso no se crea
+#define INTERCAMBIO_LRU 1       // Sale el que hace mas tiempo que no se despacha
+#define INTERCAMBIO_SUENO 2     // Sale el dormido al que mas le falta para despertar (si no hay, LRU)
+
+// Planificador de mediano plazo: con la memoria llena saca procesos LISTO o DORMIDO al area
+// de intercambio del disco (DISCO_PISTA_INTERCAMBIO en adelante) y los trae de vuelta al
+// despacharlos. Los procesos paginados no se intercambian.
+typedef struct {
+    int politica;
+    unsigned char ocupado[DISCO_SECTORES_INTERCAMBIO]; // Sectores del area en uso
+    long reloj;                 // Cuenta de despachos: BCP_t.ultimo_uso
+    int en_disco;               // Procesos intercambiados ahora
+    int pico_en_disco;
+    long salidas;               // Procesos llevados al disco
+    long entradas;              // Procesos traidos de vuelta
+    long palabras_salida;
+    long palabras_entrada;
+    double segundos_salida;     // Tiempo total de las transferencias (y de elegir victimas)
+    double segundos_entrada;
+} Intercambio_t;
+
+// Totales acumulados desde que se inicializo el sistema (para el resumen por lotes)
+typedef struct {
+    long instrucciones;       // Ciclos en los que la CPU ejecuto una instruccion de un proceso
+    long cambios_contexto;    // Contextos cargados en la CPU por el despachador
+    int procesos_creados;
+    int procesos_abortados;   // Terminados por direccionamiento invalido o PC fuera de rango
+    double segundos;          // Tiempo real dentro de sistema_iniciar_ejecucion
+} TotalesSistema_t;
+
+// Estructura principal del sistema
+typedef struct Sistema {
     CPU_t cpu;
     Memoria_t memoria;
     SimuladorDisco_t disco;
     ControladorDMA_t dma;
     VectorInterrupciones_t vector_int;
 
-    pthread_mutex_t mutex_bus;
+    pthread_rwlock_t cerrojo_bus;     // Las CPUs lo toman como lectoras y el DMA como escritor
     pthread_mutex_t mutex_memoria;
+    pthread_mutex_t mutex_procesos;   // Transiciones de estado en la tabla de procesos
 
     //
-    BCP_t tabla_procesos[MAX_PROCESOS];
-    int proceso_actual;  
+    TablaProcesos_t tabla_procesos;
+    int proceso_actual;               // PID del proceso en la CPU (-1: ninguno)
+    int indice_actual;                // Su indice en la tabla de procesos
+    ColaProcesos_t listos;            // Procesos LISTO en orden de llegada (un solo nucleo)
+    MonticuloDormidos_t dormidos;     // Procesos DORMIDO por ciclo de despertar (un solo nucleo)
+    int procesos_vivos;               // Procesos creados y sin terminar
 
     int contador_quantum;
+    int quantum;         // Ciclos de CPU por turno antes de replanificar
+    int tam_rafaga;      // Ciclos maximos que la CPU ejecuta por cada adquisicion del bus
     int contador_pids;
 
     int ejecutando;
     int ciclos_reloj;
     int periodo_reloj;
     int pico_memoria; // Pico maximo de memoria de usuario ocupada
+    int paginacion;   // Los procesos nuevos se paginan (comando paginacion)
+    int codigo_compartido; // Y comparten las paginas de codigo de su programa (paginacion compartida)
+    SegmentoCodigo_t segmentos_codigo[MAX_PROGRAMAS]; // Codigo compartido de cada programa del disco
+    Intercambio_t intercambio;
+
+    EstadisticasCPU_t estadisticas_cpu; // Despachos del interprete en la ejecucion actual
+    long rafagas;                       // Adquisiciones del bus por la CPU en la ejecucion actual
+    MotorJIT_t *jit;                    // NULL si se compilo sin JIT=1
+    Logger_t log;                       // Log propio de esta instancia
+    Traza_t traza;                      // Traza binaria (comando traza), sobrevive a reiniciar
+    TotalesSistema_t totales;
+
+    int cant_nucleos;                   // 1: planificador de un solo nucleo (sistema_ciclo)
+    Nucleo_t nucleos[MAX_NUCLEOS];
 } Sistema_t;
 
-// Busca un espacio vacío en la tabla y crea un proceso.
+// BCP del indice dado de la tabla de procesos
+static inline BCP_t *sistema_bcp(Sistema_t *sys, int indice) {
+    return procesos_bcp(&sys->tabla_procesos, indice);
+}
+
+// Toma un lugar de la tabla de procesos (virgen, reciclado o de un bloque nuevo) y crea un
+// proceso.
 int sistema_crear_proceso(Sistema_t *sys, const char *archivo);
 
 // Realiza el cambio de contexto entre procesos
 void sistema_planificar(Sistema_t *sys);
 
-// Registra los cambios en el archivo .log
-void sistema_log(int pid, Estado_t anterior, Estado_t nuevo);
+// Pone el proceso del indice dado al final de la cola de listos
+void sistema_encolar_listo(Sistema_t *sys, int indice);
+
+// Saca el primer proceso de la cola de listos. Retorna su indice o -1 si esta vacia.
+int sistema_sacar_listo(Sistema_t *sys);
+
+// Monticulo de dormidos, el del sistema o el de un nucleo SMP: agrega el proceso del indice
+// dado (con su ciclo_despertar ya puesto) o saca el del tope y retorna su indice
+void sistema_agregar_dormido(Sistema_t *sys, MonticuloDormidos_t *m, int indice);
+int sistema_sacar_dormido(Sistema_t *sys, MonticuloDormidos_t *m);
 
-// Inicializa el sistema
-void sistema_inicializar(Sistema_t *sys);
+// Pasa el proceso del indice dado de EJECUCION a TERMINADO y lo descuenta de los vivos.
+// En SMP se llama con mutex_procesos tomado.
+void sistema_terminar_proceso(Sistema_t *sys, int indice);
+
+// Registra los cambios en el archivo .log (y en la traza si esta activa)
+void sistema_log(Sistema_t *sys, int pid, Estado_t anterior, Estado_t nuevo);
+
+// Agrega a la traza la instruccion que acaba de ejecutar cpu, que empezo en pc con
+// ac_antes en el acumulador. Solo se llama con la traza activa.
+void sistema_trazar_instruccion(Sistema_t *sys, const CPU_t *cpu, int nucleo, long ciclo, int pid,
+                                int pc, palabra_t ac_antes);
+
+// Agrega a la traza una interrupcion atendida por cpu
+void sistema_trazar_interrupcion(Sistema_t *sys, const CPU_t *cpu, int nucleo, long ciclo, int pid, int codigo);
+
+// Inicializa el sistema y abre su log en ruta_log (NULL: sin log). El hilo que llama
+// queda registrando en ese log. La memoria toma la geometria de geometria_memoria.
+// Retorna -1 (sin nada que limpiar) si no se pudo reservar la memoria simulada.
+int sistema_inicializar(Sistema_t *sys, const char *ruta_log);
 
 // Iniciar ejecución
 void sistema_iniciar_ejecucion(Sistema_t *sys);
@@ -51,10 +207,52 @@ void sistema_iniciar_ejecucion(Sistema_t *sys);
 // Ciclo principal de ejecucion
 void sistema_ciclo(Sistema_t *sys);
 
-// Limpia recursos del sistema
+// Limpia recursos del sistema y cierra su log
 void sistema_limpiar(Sistema_t *sys);
 
+// Resultado de sistema_atender_syscall
+#define SYSCALL_CONTINUA 0   // El proceso sigue en la CPU
+#define SYSCALL_TERMINA 1    // El proceso termino (quedo TERMINADO)
+#define SYSCALL_DUERME 2     // El proceso quedo DORMIDO con su contexto guardado
+
+// Atiende la llamada al sistema del proceso en el indice dado de la tabla, que corre
+// en cpu. Solo actualiza su BCP: replanificar queda a cargo de quien llama.
+int sistema_atender_syscall(Sistema_t *sys, CPU_t *cpu, int indice);
+
+// Carga en un marco libre la pagina que fallo en cpu (dir_fallo) para reintentar la
+// instruccion. Retorna el marco o -1 si no hay marcos libres.
+int sistema_atender_fallo_pagina(Sistema_t *sys, CPU_t *cpu);
+
+// Intercambio de procesos con el disco (intercambio.c). En SMP se llaman con mutex_procesos.
+
+// Asigna el bloque de un proceso sin paginacion como memoria_asignar_espacio, debajo de
+// memoria_tope_contiguo; si no hay hueco, lleva al disco victimas segun la politica hasta
+// que lo haya. Retorna la base o -1.
+int sistema_asignar_con_intercambio(Sistema_t *sys, int tam_requerido, int *tam_asignado);
+
+// Trae del disco el proceso del indice dado a su misma base (la pila guarda direcciones
+// fisicas), llevando antes al disco a los que ocupan ese rango. Retorna 0 o -1 si no se
+// pudo: el proceso sigue en el disco.
+int sistema_traer_de_disco(Sistema_t *sys, int indice);
+
+// Nombre de la politica de intercambio (para la consola)
+const char *sistema_nombre_intercambio(int politica);
+
+// Ejecuta los procesos listos en sys->cant_nucleos hilos con robo de trabajo (smp.c)
+void sistema_ejecutar_smp(Sistema_t *sys);
+
+// Ejecuta una linea de la consola (se modifica al separar los tokens).
+// Retorna CONSOLA_CONTINUAR, CONSOLA_APAGAR o CONSOLA_ERROR.
+int sistema_ejecutar_comando(Sistema_t *sys, char *comando);
+
 // Consola interactiva
 void sistema_consola(Sistema_t *sys);
 
+// Ejecuta los comandos de un archivo, una linea por comando ('#' inicia un comentario).
+// Retorna CONSOLA_ERROR si no se pudo abrir o si algun comando fallo.
+int sistema_ejecutar_script(Sistema_t *sys, const char *archivo);
+
+// Escribe en salida, en una sola linea JSON, los totales del sistema para el modo por lotes
+void sistema_imprimir_totales(Sistema_t *sys, FILE *salida);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,365 @@
+#include "sistema.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+// Modo multiprocesador simetrico (comando "nucleos <n>").
+// Cada nucleo es un hilo con su propia CPU, proceso actual, quantum e interrupciones
+// pendientes (la linea de interrupciones esta en n->cpu). Comparten la memoria y la
+// tabla de procesos: las transiciones de estado se hacen con mutex_procesos y el bus se
+// toma como lector, asi los nucleos avanzan en paralelo y el DMA los excluye a todos.
+// Cada nucleo tiene su cola de listos; si la suya esta vacia roba de la de otro.
+// El JIT no se usa en este modo: su cache de traducciones es de un solo hilo.
+
+//------------------------------------------------------COLAS DE LISTOS---------------------------------------------------------------------------------------------
+
+static int smp_cola_inicializar(ColaListos_t *cola, int capacidad) {
+    cola->indices = malloc(capacidad * sizeof(int));
+    cola->capacidad = capacidad;
+    cola->frente = 0;
+    cola->cantidad = 0;
+    pthread_mutex_init(&cola->mutex, NULL);
+    return cola->indices ? 0 : -1;
+}
+
+static void smp_cola_encolar(ColaListos_t *cola, int indice) {
+    pthread_mutex_lock(&cola->mutex);
+    cola->indices[(cola->frente + cola->cantidad) % cola->capacidad] = indice;
+    cola->cantidad++;
+    pthread_mutex_unlock(&cola->mutex);
+}
+
+// El dueño toma del frente (round robin)
+static int smp_cola_tomar(ColaListos_t *cola) {
+    int indice = -1;
+    pthread_mutex_lock(&cola->mutex);
+    if (cola->cantidad > 0) {
+        indice = cola->indices[cola->frente];
+        cola->frente = (cola->frente + 1) % cola->capacidad;
+        cola->cantidad--;
+    }
+    pthread_mutex_unlock(&cola->mutex);
+    return indice;
+}
+
+// Otro nucleo roba del final, lo mas lejano a lo que el dueño va a tomar
+static int smp_cola_robar(ColaListos_t *cola) {
+    int indice = -1;
+    pthread_mutex_lock(&cola->mutex);
+    if (cola->cantidad > 0) {
+        cola->cantidad--;
+        indice = cola->indices[(cola->frente + cola->cantidad) % cola->capacidad];
+    }
+    pthread_mutex_unlock(&cola->mutex);
+    return indice;
+}
+
+static int smp_cola_vacia(ColaListos_t *cola) {
+    pthread_mutex_lock(&cola->mutex);
+    int vacia = cola->cantidad == 0;
+    pthread_mutex_unlock(&cola->mutex);
+    return vacia;
+}
+
+//------------------------------------------------------PLANIFICACION POR NUCLEO------------------------------------------------------------------------------------
+
+static int smp_buscar_proceso(Sistema_t *sys, Nucleo_t *n) {
+    int indice = smp_cola_tomar(&n->cola);
+    if (indice != -1) return indice;
+
+    // Robo de trabajo: se recorre el resto de los nucleos empezando por el siguiente
+    for (int k = 1; k < sys->cant_nucleos; k++) {
+        Nucleo_t *victima = &sys->nucleos[(n->id + k) % sys->cant_nucleos];
+        indice = smp_cola_robar(&victima->cola);
+        if (indice != -1) {
+            n->robos++;
+            LOG_DEBUG(LOG_CAT_PLANIF, "Nucleo %d: roba PID %d de la cola del nucleo %d",
+                      n->id, sistema_bcp(sys, indice)->pid, victima->id);
+            return indice;
+        }
+    }
+    return -1;
+}
+
+// Retorna -1 si el proceso esta intercambiado y todavia no se lo puede traer del disco
+static int smp_despachar(Sistema_t *sys, Nucleo_t *n, int indice) {
+    BCP_t *proceso = sistema_bcp(sys, indice);
+
+    pthread_mutex_lock(&sys->mutex_procesos);
+    if (proceso->en_disco && sistema_traer_de_disco(sys, indice) != 0) {
+        pthread_mutex_unlock(&sys->mutex_procesos);
+        return -1;
+    }
+    cpu_cargar_contexto(&n->cpu, &proceso->contexto);
+    proceso->ultimo_uso = ++sys->intercambio.reloj;
+    proceso->estado = EJECUCION;
+    proceso->nucleo = n->id;
+    sistema_log(sys, proceso->pid, LISTO, EJECUCION);
+    pthread_mutex_unlock(&sys->mutex_procesos);
+
+    n->proceso_actual = indice;
+    n->contador_quantum = 0;
+    n->cambios_contexto++;
+
+    LOG_INFO(LOG_CAT_PLANIF, "Nucleo %d: despacho PID %d", n->id, proceso->pid);
+    return 0;
+}
+
+// Quantum agotado con otros procesos esperando: vuelve al final de la cola del nucleo
+static void smp_expropiar(Sistema_t *sys, Nucleo_t *n) {
+    BCP_t *proceso = sistema_bcp(sys, n->proceso_actual);
+
+    pthread_mutex_lock(&sys->mutex_procesos);
+    proceso->contexto = n->cpu;
+    proceso->estado = LISTO;
+    sistema_log(sys, proceso->pid, EJECUCION, LISTO);
+    pthread_mutex_unlock(&sys->mutex_procesos);
+
+    smp_cola_encolar(&n->cola, n->proceso_actual);
+    n->proceso_actual = -1;
+}
+
+static void smp_abortar(Sistema_t *sys, Nucleo_t *n) {
+    pthread_mutex_lock(&sys->mutex_procesos);
+    sistema_terminar_proceso(sys, n->proceso_actual);
+    pthread_mutex_unlock(&sys->mutex_procesos);
+
+    n->procesos_abortados++;
+    n->proceso_actual = -1;
+}
+
+// Encola los procesos dormidos del nucleo que llegaron a su ciclo en el reloj del nucleo
+static void smp_despertar_dormidos(Sistema_t *sys, Nucleo_t *n) {
+    while (n->dormidos.cantidad > 0 &&
+           sistema_bcp(sys, n->dormidos.indices[0])->ciclo_despertar <= n->ciclos) {
+        int indice = sistema_sacar_dormido(sys, &n->dormidos);
+        BCP_t *proceso = sistema_bcp(sys, indice);
+        pthread_mutex_lock(&sys->mutex_procesos);
+        proceso->estado = LISTO;
+        sistema_log(sys, proceso->pid, DORMIDO, LISTO);
+        pthread_mutex_unlock(&sys->mutex_procesos);
+
+        smp_cola_encolar(&n->cola, indice);
+    }
+}
+
+// Igual que sistema_ciclos_rafaga pero con el quantum y el monticulo de dormidos del nucleo
+static int smp_ciclos_rafaga(Sistema_t *sys, Nucleo_t *n) {
+    int ciclos = sys->tam_rafaga;
+    if (traza_activa(&sys->traza)) return 1;
+    if (sys->quantum - n->contador_quantum < ciclos) {
+        ciclos = sys->quantum - n->contador_quantum;
+    }
+    if (n->dormidos.cantidad > 0) {
+        long faltan = sistema_bcp(sys, n->dormidos.indices[0])->ciclo_despertar - n->ciclos;
+        if (faltan < ciclos) ciclos = faltan;
+    }
+    return ciclos < 1 ? 1 : ciclos;
+}
+
+// Pid del proceso en el nucleo para la traza (0, el del SO, si no tiene ninguno)
+static int smp_pid_actual(Sistema_t *sys, Nucleo_t *n) {
+    return n->proceso_actual == -1 ? 0 : sistema_bcp(sys, n->proceso_actual)->pid;
+}
+
+// Atiende en orden de prioridad las interrupciones pendientes del nucleo. Si el proceso
+// termina, se duerme o se aborta, las que quedan (de dispositivos) siguen pendientes y se
+// atienden con el proximo proceso que se despache: sin proceso no hay pila donde salvar
+// el contexto.
+static void smp_atender_interrupciones(Sistema_t *sys, Nucleo_t *n) {
+    unsigned int pendientes = atomic_load(&n->cpu.interrupciones_pendientes);
+    while (pendientes && n->proceso_actual != -1) {
+        int codigo = interrupciones_siguiente(pendientes);
+        pendientes &= ~INT_BIT(codigo);
+        if (traza_activa(&sys->traza)) {
+            sistema_trazar_interrupcion(sys, &n->cpu, n->id, sys->ciclos_reloj + n->ciclos,
+                                        smp_pid_actual(sys, n), codigo);
+        }
+
+        if (sys->vector_int.manejadores[codigo] != 0 ||
+            (codigo != INT_SYSCALL && codigo != INT_DIR_INVALIDA && codigo != INT_FALLO_PAGINA)) {
+            procesar_interrupcion(&n->cpu, &sys->memoria, &sys->vector_int, codigo);
+        } else if (codigo == INT_SYSCALL) {
+            int indice = n->proceso_actual;
+            interrupciones_quitar(&n->cpu, INT_BIT(INT_SYSCALL));
+            int resultado = sistema_atender_syscall(sys, &n->cpu, indice);
+            if (resultado == SYSCALL_DUERME) {
+                // Despierta al terminar la primera rafaga que complete sus tics
+                BCP_t *proceso = sistema_bcp(sys, indice);
+                proceso->ciclo_despertar = n->ciclos + proceso->tics_dormido;
+                sistema_agregar_dormido(sys, &n->dormidos, indice);
+            }
+            if (resultado != SYSCALL_CONTINUA) {
+                n->proceso_actual = -1; // Durmio o termino (ya descontado de los vivos)
+            }
+        } else if (codigo == INT_FALLO_PAGINA && sistema_atender_fallo_pagina(sys, &n->cpu) != -1) {
+            interrupciones_quitar(&n->cpu, INT_BIT(INT_FALLO_PAGINA));
+        } else {
+            if (codigo == INT_FALLO_PAGINA) {
+                log_error(LOG_CAT_MEM, "Fallo de pagina sin marcos libres", n->cpu.dir_fallo);
+                printf("\nERROR: Sin marcos libres para la pagina %d del PID %d (nucleo %d). Terminando proceso.\n",
+                       n->cpu.dir_fallo / TAM_PAGINA, sistema_bcp(sys, n->proceso_actual)->pid, n->id);
+            } else {
+                log_error(LOG_CAT_MEM, "Violacion de limites de memoria", n->cpu.PSW.pc);
+                printf("\nERROR: Direccionamiento invalido en PID %d (nucleo %d). Terminando proceso.\n",
+                       sistema_bcp(sys, n->proceso_actual)->pid, n->id);
+            }
+            // Los demas fallos pendientes eran del proceso abortado
+            interrupciones_quitar(&n->cpu, INT_MASCARA_SINCRONAS);
+            pendientes &= ~INT_MASCARA_SINCRONAS;
+            smp_abortar(sys, n);
+        }
+    }
+}
+
+static void *smp_nucleo(void *arg) {
+    Nucleo_t *n = (Nucleo_t *)arg;
+    Sistema_t *sys = n->sistema;
+
+    log_usar(&sys->log);
+    cpu_perfil_reiniciar();
+    perfil_cpu.activo = n->perfil_activo;
+
+    while (sys->ejecutando && __atomic_load_n(&sys->procesos_vivos, __ATOMIC_SEQ_CST) > 0) {
+        if (n->proceso_actual == -1) {
+            int indice = smp_buscar_proceso(sys, n);
+            if (indice == -1) {
+                // Ocioso: el reloj del nucleo sigue corriendo para sus procesos dormidos
+                if (n->dormidos.cantidad > 0) {
+                    n->ciclos++;
+                    smp_despertar_dormidos(sys, n);
+                } else {
+                    sched_yield();
+                }
+                continue;
+            }
+            if (smp_despachar(sys, n, indice) != 0) {
+                // Su base esta ocupada por procesos en ejecucion: vuelve al final de la cola
+                smp_cola_encolar(&n->cola, indice);
+                sched_yield();
+                continue;
+            }
+        }
+
+        int ciclos = smp_ciclos_rafaga(sys, n);
+        int pc = n->cpu.PSW.pc;
+        palabra_t ac = n->cpu.AC;
+        pthread_rwlock_rdlock(&sys->cerrojo_bus);
+        ciclos = cpu_ejecutar_rafaga(&n->cpu, &sys->memoria, &sys->dma, ciclos, &n->estadisticas);
+        pthread_rwlock_unlock(&sys->cerrojo_bus);
+        if (traza_activa(&sys->traza)) {
+            sistema_trazar_instruccion(sys, &n->cpu, n->id, sys->ciclos_reloj + n->ciclos,
+                                       smp_pid_actual(sys, n), pc, ac);
+        }
+
+        n->rafagas++;
+        n->ciclos += ciclos;
+        n->instrucciones += ciclos;
+        n->contador_quantum += ciclos;
+        smp_despertar_dormidos(sys, n);
+
+        if (n->cpu.interrupciones_pendientes) {
+            smp_atender_interrupciones(sys, n);
+        }
+
+        if (n->proceso_actual != -1 && (n->cpu.PSW.pc >= sys->memoria.tam_memoria || n->cpu.PSW.pc < 0)) {
+            printf("\nProceso %d finalizado (PC fuera de rango: %d)\n",
+                   sistema_bcp(sys, n->proceso_actual)->pid, n->cpu.PSW.pc);
+            smp_abortar(sys, n);
+        }
+
+        if (n->proceso_actual != -1 && n->contador_quantum >= sys->quantum) {
+            // Si no hay nadie mas en la cola del nucleo, el proceso sigue con otro quantum
+            n->contador_quantum = 0;
+            if (!smp_cola_vacia(&n->cola)) {
+                smp_expropiar(sys, n);
+            }
+        }
+    }
+
+    n->perfil = perfil_cpu;
+    return NULL;
+}
+
+//------------------------------------------------------EJECUCION----------------------------------------------------------------------------------------------------
+
+static void smp_liberar_nucleos(Sistema_t *sys) {
+    for (int i = 0; i < sys->cant_nucleos; i++) {
+        pthread_mutex_destroy(&sys->nucleos[i].cola.mutex);
+        free(sys->nucleos[i].cola.indices);
+        free(sys->nucleos[i].dormidos.indices);
+    }
+}
+
+void sistema_ejecutar_smp(Sistema_t *sys) {
+    // Los procesos de la cola de listos se reparten en orden entre las colas de los nucleos.
+    // Durante la ejecucion no se crean procesos: cada cola y cada monticulo de dormidos
+    // tiene lugar para toda la tabla.
+    int sin_memoria = 0;
+    for (int i = 0; i < sys->cant_nucleos; i++) {
+        Nucleo_t *n = &sys->nucleos[i];
+        memset(n, 0, sizeof(Nucleo_t));
+        n->id = i;
+        n->sistema = sys;
+        n->proceso_actual = -1;
+        n->cpu.modo_debug = sys->cpu.modo_debug;
+        n->perfil_activo = perfil_cpu.activo;
+        n->dormidos.indices = malloc(sys->tabla_procesos.capacidad * sizeof(int));
+        n->dormidos.capacidad = sys->tabla_procesos.capacidad;
+        if (smp_cola_inicializar(&n->cola, sys->tabla_procesos.capacidad) != 0 || !n->dormidos.indices) sin_memoria = 1;
+    }
+    if (sin_memoria) {
+        printf("Error: No hay memoria para las colas de los nucleos\n");
+        sys->ejecutando = 0;
+        smp_liberar_nucleos(sys);
+        return;
+    }
+
+    int siguiente = 0;
+    for (int i = sistema_sacar_listo(sys); i != -1; i = sistema_sacar_listo(sys)) {
+        smp_cola_encolar(&sys->nucleos[siguiente].cola, i);
+        siguiente = (siguiente + 1) % sys->cant_nucleos;
+    }
+
+    // Durante la ejecucion no se asigna memoria: el pico se toma al empezar
+    if (sys->memoria.ocupadas_usuario > sys->pico_memoria) sys->pico_memoria = sys->memoria.ocupadas_usuario;
+
+    LOG_INFO(LOG_CAT_SIS, "SMP: %d procesos en %d nucleos", sys->procesos_vivos, sys->cant_nucleos);
+
+    // Los nucleos comparten el bloque de la traza mientras corren
+    sys->traza.compartida = 1;
+
+    int creados = 0;
+    for (int i = 0; i < sys->cant_nucleos; i++) {
+        if (pthread_create(&sys->nucleos[i].hilo, NULL, smp_nucleo, &sys->nucleos[i]) != 0) {
+            log_error(LOG_CAT_SIS, "Error al crear el hilo del nucleo", i);
+            printf("Error: No se pudo crear el hilo del nucleo %d\n", i);
+            sys->ejecutando = 0;
+            break;
+        }
+        creados++;
+    }
+
+    // Al terminar, los contadores de los nucleos se suman a los del sistema. El reloj del
+    // sistema avanza lo que avanzo el nucleo mas ocupado.
+    long max_ciclos = 0;
+    for (int i = 0; i < creados; i++) {
+        Nucleo_t *n = &sys->nucleos[i];
+        pthread_join(n->hilo, NULL);
+
+        if (n->ciclos > max_ciclos) max_ciclos = n->ciclos;
+        sys->totales.instrucciones += n->instrucciones;
+        sys->totales.cambios_contexto += n->cambios_contexto;
+        sys->totales.procesos_abortados += n->procesos_abortados;
+        sys->estadisticas_cpu.despachos_fusionados += n->estadisticas.despachos_fusionados;
+        sys->estadisticas_cpu.despachos_simples += n->estadisticas.despachos_simples;
+        sys->rafagas += n->rafagas;
+        cpu_perfil_acumular(&perfil_cpu, &n->perfil);
+    }
+    sys->ciclos_reloj += max_ciclos;
+    sys->traza.compartida = 0;
+
+    smp_liberar_nucleos(sys);
+}
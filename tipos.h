@@ -2,17 +2,32 @@
 #define TIPOS_H
 
 #include <stdint.h>
+#include <stdatomic.h>
 
 // Tamaño de palabra: 8 digitos decimales
 #define TAM_PALABRA 8
 #define TAM_PILA 50 // Tamanio reservado para la pila
-#define TAM_MEMORIA 2000 // Tamanio de la memoria ram es de 2000 posiciones
-#define MEM_SO 300       //300 posiciones reservadas para el SO
-#define MEM_USUARIO (TAM_MEMORIA - MEM_SO)    // Posiciones disponibles para el usuario
-
-// Cantidad máxima de Procesos en la memoria
-#define MAX_PROCESOS 20
-#define TAM_PARTICION (MEM_USUARIO / MAX_PROCESOS) // 1700 / 20 = 85 particiones estáticas
+// Geometria de la memoria por defecto; se puede cambiar al arrancar (opcion -m)
+#define TAM_MEMORIA_DEFECTO 2000 // Tamanio de la memoria ram es de 2000 posiciones
+#define MEM_SO_DEFECTO 300       //300 posiciones reservadas para el SO
+// Tope de la opcion -m: una direccion fisica tiene que caber en la magnitud de una palabra
+// (7 digitos, unos 40 bytes del host por palabra)
+#define TAM_MEMORIA_MAXIMA 10000000
+// Al salvar el contexto el PC se empaqueta en los 5 digitos bajos de la PSW. El codigo del SO
+// (debajo de mem_so) y el bloque de un proceso sin paginacion, cuyo PC es fisico, tienen que
+// quedar debajo de esta direccion; con paginacion el PC es virtual y los marcos van a cualquiera.
+#define LIMITE_PC_PSW 100000
+
+// Cantidad de codigos de operacion del repertorio (00 a 33)
+#define CANT_OPCODES 34
+
+// Superinstrucciones: secuencias de opcodes adyacentes que se ejecutan con un solo despacho
+#define FUSION_NINGUNA 0
+#define FUSION_LOADI_PSH 1      // LOAD inmediato + PSH
+#define FUSION_LOAD_ARIT_STR 2  // LOAD + SUM/RES/MULT + STR
+#define FUSION_COMP_SALTO 3     // COMP + JMPE/JMPNE/JMPLT/JMPGT
+#define FUSION_PSH_SALTO 4      // PSH + J/JMPE/JMPNE/JMPLT/JMPGT
+#define CANT_FUSIONES 5
 
 // El procesador tiene dos modos de ejecucion:
 #define MODO_USUARIO 0
@@ -28,6 +43,8 @@
 #define INT_DIR_INVALIDA 6
 #define INT_UNDERFLOW 7
 #define INT_OVERFLOW 8
+#define INT_FALLO_PAGINA 9      // La pagina de la direccion no esta en memoria (paginacion)
+#define CANT_INTERRUPCIONES 10
 
 // Estados de interrupciones
 #define INT_DESHABILITADAS 0
@@ -58,6 +75,11 @@
 #define DISCO_SECTORES 100
 #define TAM_SECTOR 9
 
+// Desde esta pista el disco queda para el intercambio de procesos: la E/S de los programas
+// no puede usarla. Cada sector guarda una palabra.
+#define DISCO_PISTA_INTERCAMBIO 5
+#define DISCO_SECTORES_INTERCAMBIO ((DISCO_PISTAS - DISCO_PISTA_INTERCAMBIO) * DISCO_CILINDROS * DISCO_SECTORES)
+
 // Tipo para representar una palabra de 8 digitos
 typedef int32_t palabra_t;
 
@@ -78,6 +100,43 @@ typedef enum {
     TERMINADO
 } Estado_t;
 
+// Memoria virtual paginada (comando "paginacion"): el espacio del proceso va de 0 a RL y
+// cada pagina de TAM_PAGINA palabras se ubica en cualquier marco libre del area de usuario
+#define TAM_PAGINA 10
+#define MAX_PAGINAS 64      // Cubre el programa mas grande que admite el disco mas su pila
+#define TAM_TLB 16          // Entradas de la TLB, de correspondencia directa por pagina
+
+// Codigo de un programa compartido por todos los procesos que lo ejecutan (comando
+// "paginacion compartida"). Sus paginas completas de codigo se cargan una sola vez y los
+// marcos se liberan cuando termina el ultimo proceso que las usa.
+typedef struct {
+    int marcos[MAX_PAGINAS];        // Marco de cada pagina de codigo (-1: no cargada todavia)
+    int cant_paginas;               // Paginas llenas de codigo (la que sigue tiene la pila: es privada)
+    int referencias;                // Procesos vivos que lo usan
+} SegmentoCodigo_t;
+
+// Tabla de paginas de un proceso (vive en su BCP)
+typedef struct {
+    int marcos[MAX_PAGINAS];        // Direccion fisica del marco de cada pagina (-1: no cargada)
+    int cant_paginas;
+    const palabra_t *imagen;        // Codigo en el disco (Signo-Magnitud): se carga por demanda
+    int tam_imagen;
+    SegmentoCodigo_t *segmento;     // Codigo compartido (NULL: todas las paginas son propias)
+    unsigned char compartida[MAX_PAGINAS]; // Usa el marco del segmento: solo lectura
+} TablaPaginas_t;
+
+typedef struct {
+    int pagina;                     // -1: entrada vacia
+    int marco;
+} EntradaTLB_t;
+
+// TLB por software delante de la tabla de paginas. Se vacia en cada cambio de contexto.
+typedef struct {
+    EntradaTLB_t entradas[TAM_TLB];
+    long aciertos;
+    long fallos;
+} TLB_t;
+
 // Estructura de la CPU
 typedef struct {
     palabra_t AC;       // Acumulador
@@ -89,6 +148,14 @@ typedef struct {
     palabra_t RX;       // Registro base de pila
     palabra_t SP;       // Apuntador de pila
     PSW_t PSW;          // Palabra de estado del sistema
+    TablaPaginas_t *paginas; // NULL: reubicacion con RB; si no, direcciones virtuales paginadas
+
+    // Estado propio de la CPU: no forma parte del contexto de un proceso. Va al final,
+    // cpu_cargar_contexto copia solo los campos anteriores
+    atomic_uint interrupciones_pendientes; // Bit c: interrupcion c pendiente (ver interrupciones.h)
+    int modo_debug;                        // Imprime cada instruccion ejecutada (comando debug)
+    int dir_fallo;                         // Direccion virtual del ultimo INT_FALLO_PAGINA
+    TLB_t tlb;
 } CPU_t;
 
 // Estructura del BCP
@@ -99,8 +166,18 @@ typedef struct {
     CPU_t contexto;         // Copia fiel de los registros cuando el proceso no está en CPU
     int tiempo_inicio;      // Para estadísticas y logs
     uint32_t base_disco;    // Dirección donde reside en el disco duro
-    int tics_dormido;       // Tics restantes para despertar
+    int tics_dormido;       // Tics pedidos en la llamada Dormir
+    int ciclo_despertar;    // Ciclo en que despierta: del reloj del sistema o, en SMP, del nucleo
     int tamano_real;        // Cantidad de palabras reales (codigo + pila)
+    int base_memoria;       // Primera palabra del bloque de memoria asignado
+    int tam_asignado;       // Palabras del bloque (tamano_real mas el sobrante)
+    TablaPaginas_t tabla_paginas; // Con paginacion: sus marcos (contexto.paginas apunta aqui)
+    int en_disco;           // Intercambiado: su bloque esta en el area de intercambio del disco
+    int sector_intercambio; // Primer sector de esa copia (contando desde DISCO_PISTA_INTERCAMBIO)
+    long ultimo_uso;        // Orden de su ultimo despacho (victima LRU del intercambio)
+    int nucleo;             // Ultimo nucleo que lo ejecuto (-1: ninguno todavia)
+    int siguiente;          // Enlace de la cola de listos o de los indices para reciclar (-1: ultimo)
+    int siguiente_pid;      // Enlace de su cadena en la tabla hash de pids (-1: ultimo)
 } BCP_t;
 
 // Estructura del DMA
@@ -126,4 +203,10 @@ typedef struct {
     int valor;              // 5 digitos
 } Instruccion_t;
 
+// Contadores del interprete
+typedef struct {
+    long despachos_fusionados;  // Superinstrucciones ejecutadas con un solo despacho
+    long despachos_simples;     // Instrucciones despachadas de una en una
+} EstadisticasCPU_t;
+
 #endif
@@ -0,0 +1,66 @@
+#include "traza.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void traza_escribir_bloque(Traza_t *traza) {
+    if (traza->cantidad == 0) return;
+
+    CabeceraBloque_t cabecera = { TRAZA_MARCA_BLOQUE, (uint32_t)traza->cantidad };
+    fwrite(&cabecera, sizeof(cabecera), 1, traza->archivo);
+    fwrite(traza->bloque, sizeof(RegistroTraza_t), traza->cantidad, traza->archivo);
+    traza->cantidad = 0;
+}
+
+int traza_abrir(Traza_t *traza, const char *ruta, int nucleos, int tam_memoria, int mem_so) {
+    traza->archivo = fopen(ruta, "wb");
+    if (!traza->archivo) return -1;
+
+    traza->bloque = malloc(TRAZA_REGISTROS_BLOQUE * sizeof(RegistroTraza_t));
+    if (!traza->bloque) {
+        fclose(traza->archivo);
+        traza->archivo = NULL;
+        return -1;
+    }
+    // Los bloques ya se juntan en memoria: el buffer de stdio sobraria
+    setvbuf(traza->archivo, NULL, _IONBF, 0);
+    traza->compartida = 0;
+    traza->cantidad = 0;
+    traza->registros = 0;
+    pthread_mutex_init(&traza->mutex, NULL);
+
+    CabeceraTraza_t cabecera;
+    memset(&cabecera, 0, sizeof(cabecera));
+    memcpy(cabecera.marca, TRAZA_MARCA, sizeof(TRAZA_MARCA));
+    cabecera.version = TRAZA_VERSION;
+    cabecera.tam_registro = sizeof(RegistroTraza_t);
+    cabecera.tam_memoria = tam_memoria;
+    cabecera.mem_so = mem_so;
+    cabecera.nucleos = nucleos;
+    cabecera.inicio = time(NULL);
+    fwrite(&cabecera, sizeof(cabecera), 1, traza->archivo);
+    return 0;
+}
+
+void traza_cerrar(Traza_t *traza) {
+    if (!traza->archivo) return;
+
+    traza_escribir_bloque(traza);
+    fclose(traza->archivo);
+    traza->archivo = NULL;
+    free(traza->bloque);
+    traza->bloque = NULL;
+    pthread_mutex_destroy(&traza->mutex);
+}
+
+void traza_registrar(Traza_t *traza, const RegistroTraza_t *registro) {
+    if (traza->compartida) pthread_mutex_lock(&traza->mutex);
+
+    traza->bloque[traza->cantidad++] = *registro;
+    traza->registros++;
+    if (traza->cantidad == TRAZA_REGISTROS_BLOQUE) {
+        traza_escribir_bloque(traza);
+    }
+
+    if (traza->compartida) pthread_mutex_unlock(&traza->mutex);
+}
@@ -0,0 +1,81 @@
+#ifndef TRAZA_H
+#define TRAZA_H
+
+#include "tipos.h"
+#include <stdio.h>
+#include <pthread.h>
+
+// Traza binaria de la ejecucion (comando "traza <archivo>"). Cada evento es un registro
+// de tamaño fijo; se juntan en un bloque en memoria y se escriben con un solo fwrite
+// cuando el bloque se llena. El archivo empieza con una CabeceraTraza_t y sigue con
+// bloques: una CabeceraBloque_t y 'cantidad' registros. Los enteros van en el orden de
+// bytes del host (la cabecera lo delata si se lee en otra maquina).
+// El decodificador fuera de linea es trazadec (texto, CSV o estadisticas por PID).
+
+#define TRAZA_MARCA "SOTRAZA"           // 8 bytes con el terminador
+#define TRAZA_VERSION 2                 // 2: PC y tamaño de memoria de 32 bits
+#define TRAZA_MARCA_BLOQUE 0x51424C4Bu  // "KLBQ" leido como entero del host
+#define TRAZA_REGISTROS_BLOQUE 4096     // Registros por bloque (112 KiB)
+
+// Tipos de registro
+#define TRAZA_INSTRUCCION 0     // Una instruccion ejecutada
+#define TRAZA_INTERRUPCION 1    // Una interrupcion atendida
+#define TRAZA_ESTADO 2          // Cambio de estado de un proceso (sistema_log)
+
+#define TRAZA_SIN_INTERRUPCION 0xFF
+
+typedef struct {
+    char marca[8];              // TRAZA_MARCA
+    uint16_t version;
+    uint16_t tam_registro;      // sizeof(RegistroTraza_t)
+    uint16_t nucleos;           // Nucleos configurados al abrir la traza
+    uint16_t reservado;         // En cero
+    uint32_t tam_memoria;       // Palabras de la RAM simulada
+    uint32_t mem_so;            // Palabras del area del SO
+    int64_t inicio;             // time(NULL) al abrir la traza
+} CabeceraTraza_t;
+
+typedef struct {
+    uint32_t marca;             // TRAZA_MARCA_BLOQUE
+    uint32_t cantidad;          // Registros que siguen
+} CabeceraBloque_t;
+
+// 28 bytes. Los campos que no aplican a un tipo de registro van en cero.
+typedef struct {
+    uint32_t ciclo;             // Reloj del sistema (en SMP, el del nucleo)
+    uint32_t pc;                // PC antes de la instruccion
+    int32_t ir;                 // Instruccion ejecutada (Signo-Magnitud, como en el programa)
+    int32_t ac_antes;           // AC en Signo-Magnitud
+    int32_t ac_despues;
+    uint16_t pid;
+    uint16_t reservado;         // En cero
+    uint8_t tipo;               // TRAZA_INSTRUCCION, TRAZA_INTERRUPCION o TRAZA_ESTADO
+    uint8_t nucleo;
+    uint8_t interrupcion;       // Codigo atendido o pendiente (TRAZA_SIN_INTERRUPCION)
+    uint8_t estado;             // Cambio de estado: anterior << 4 | nuevo (0xF: creado)
+} RegistroTraza_t;
+
+typedef struct {
+    FILE *archivo;              // NULL: traza deshabilitada
+    int compartida;             // Varios nucleos registran a la vez: se usa el mutex
+    pthread_mutex_t mutex;
+    RegistroTraza_t *bloque;
+    int cantidad;               // Registros en el bloque sin escribir
+    long registros;             // Total escrito o en el bloque
+} Traza_t;
+
+// Abre el archivo y escribe la cabecera con la geometria de la memoria. Retorna 0 si se
+// pudo abrir.
+int traza_abrir(Traza_t *traza, const char *ruta, int nucleos, int tam_memoria, int mem_so);
+
+// Escribe el bloque pendiente y cierra el archivo (sin efecto si no esta abierta)
+void traza_cerrar(Traza_t *traza);
+
+// Agrega un registro al bloque; lo escribe al llenarse
+void traza_registrar(Traza_t *traza, const RegistroTraza_t *registro);
+
+static inline int traza_activa(const Traza_t *traza) {
+    return traza->archivo != NULL;
+}
+
+#endif
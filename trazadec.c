@@ -0,0 +1,232 @@
+#include "traza.h"
+#include "cpu.h"
+#include "interrupciones.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Decodificador de la traza binaria del simulador (comando "traza <archivo>").
+//   trazadec [-f texto|csv|pids] <archivo>
+// texto: un evento por linea; csv: una fila por registro; pids: resumen por proceso.
+
+#define FORMATO_TEXTO 0
+#define FORMATO_CSV 1
+#define FORMATO_PIDS 2
+
+#define MAX_PIDS_TRAZA 256
+
+static const char *nombres_estado[] = {"NUEVO", "LISTO", "EJECUCION", "DORMIDO", "TERMINADO"};
+
+// Resumen de un proceso para el formato pids
+typedef struct {
+    int pid;
+    long instrucciones;
+    long interrupciones;
+    long cambios_estado;
+    uint32_t primer_ciclo;
+    uint32_t ultimo_ciclo;
+    long por_opcode[CANT_OPCODES + 1];  // El ultimo cuenta los opcodes invalidos
+    int estado_final;
+} ResumenPid_t;
+
+typedef struct {
+    int formato;
+    ResumenPid_t pids[MAX_PIDS_TRAZA];
+    int cant_pids;
+    long registros;
+} Decodificador_t;
+
+static const char *trazadec_estado(int estado) {
+    if (estado == 0xF) return "CREADO";
+    return (estado >= 0 && estado <= TERMINADO) ? nombres_estado[estado] : "?";
+}
+
+static int trazadec_opcode(int32_t ir) {
+    int codigo = ir / 1000000;
+    return (codigo >= 0 && codigo < CANT_OPCODES) ? codigo : CANT_OPCODES;
+}
+
+static ResumenPid_t *trazadec_resumen(Decodificador_t *dec, int pid) {
+    for (int i = 0; i < dec->cant_pids; i++) {
+        if (dec->pids[i].pid == pid) return &dec->pids[i];
+    }
+    if (dec->cant_pids == MAX_PIDS_TRAZA) return NULL;
+
+    ResumenPid_t *r = &dec->pids[dec->cant_pids++];
+    memset(r, 0, sizeof(ResumenPid_t));
+    r->pid = pid;
+    r->estado_final = -1;
+    return r;
+}
+
+//------------------------------------------------------FORMATOS----------------------------------------------------------------------------------------------------
+
+static void trazadec_texto(const RegistroTraza_t *r) {
+    printf("%010u N%-2u PID %-5u ", r->ciclo, r->nucleo, r->pid);
+    switch (r->tipo) {
+        case TRAZA_INSTRUCCION:
+            printf("PC %05u  IR %08d %-10s AC %08d -> %08d", r->pc, r->ir,
+                   cpu_nombre_opcode(trazadec_opcode(r->ir)), r->ac_antes, r->ac_despues);
+            if (r->interrupcion != TRAZA_SIN_INTERRUPCION) printf("  [INT %u]", r->interrupcion);
+            printf("\n");
+            break;
+        case TRAZA_INTERRUPCION:
+            printf("PC %05u  INT %u %s\n", r->pc, r->interrupcion, obtener_nombre_interrupcion(r->interrupcion));
+            break;
+        case TRAZA_ESTADO:
+            printf("ESTADO %s -> %s\n", trazadec_estado(r->estado >> 4), trazadec_estado(r->estado & 0xF));
+            break;
+        default:
+            printf("REGISTRO DESCONOCIDO (tipo %u)\n", r->tipo);
+            break;
+    }
+}
+
+static void trazadec_csv(const RegistroTraza_t *r) {
+    static const char *tipos[] = {"instruccion", "interrupcion", "estado"};
+    printf("%u,%u,%u,%s,", r->ciclo, r->nucleo, r->pid, r->tipo <= TRAZA_ESTADO ? tipos[r->tipo] : "?");
+    if (r->tipo == TRAZA_INSTRUCCION) {
+        printf("%u,%d,%s,%d,%d,", r->pc, r->ir, cpu_nombre_opcode(trazadec_opcode(r->ir)), r->ac_antes, r->ac_despues);
+    } else if (r->tipo == TRAZA_INTERRUPCION) {
+        printf("%u,,,%d,%d,", r->pc, r->ac_antes, r->ac_despues);
+    } else {
+        printf(",,,,,");
+    }
+    if (r->interrupcion != TRAZA_SIN_INTERRUPCION && r->tipo != TRAZA_ESTADO) printf("%u", r->interrupcion);
+    if (r->tipo == TRAZA_ESTADO) {
+        printf(",%s,%s\n", trazadec_estado(r->estado >> 4), trazadec_estado(r->estado & 0xF));
+    } else {
+        printf(",,\n");
+    }
+}
+
+static void trazadec_acumular(Decodificador_t *dec, const RegistroTraza_t *r) {
+    ResumenPid_t *p = trazadec_resumen(dec, r->pid);
+    if (!p) return;
+
+    if (p->instrucciones + p->interrupciones + p->cambios_estado == 0) p->primer_ciclo = r->ciclo;
+    if (r->ciclo > p->ultimo_ciclo) p->ultimo_ciclo = r->ciclo;
+
+    if (r->tipo == TRAZA_INSTRUCCION) {
+        p->instrucciones++;
+        p->por_opcode[trazadec_opcode(r->ir)]++;
+    } else if (r->tipo == TRAZA_INTERRUPCION) {
+        p->interrupciones++;
+    } else if (r->tipo == TRAZA_ESTADO) {
+        p->cambios_estado++;
+        p->estado_final = r->estado & 0xF;
+    }
+}
+
+static void trazadec_mostrar_pids(Decodificador_t *dec) {
+    printf("%-5s | %12s | %10s | %10s | %10s | %8s | %-10s | %-10s\n", "PID", "INSTRUCC.",
+           "PRIMER CIC", "ULTIMO CIC", "INTERRUP.", "ESTADOS", "OPCODE MAX", "ESTADO FIN");
+    printf("-----------------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < dec->cant_pids; i++) {
+        ResumenPid_t *p = &dec->pids[i];
+        int mas_usado = 0;
+        for (int op = 1; op <= CANT_OPCODES; op++) {
+            if (p->por_opcode[op] > p->por_opcode[mas_usado]) mas_usado = op;
+        }
+        printf("%-5d | %12ld | %10u | %10u | %10ld | %8ld | %-10s | %-10s\n", p->pid, p->instrucciones,
+               p->primer_ciclo, p->ultimo_ciclo, p->interrupciones, p->cambios_estado,
+               p->instrucciones ? cpu_nombre_opcode(mas_usado) : "-",
+               p->estado_final >= 0 ? trazadec_estado(p->estado_final) : "-");
+    }
+    printf("\nRegistros: %ld\n", dec->registros);
+}
+
+//------------------------------------------------------LECTURA-----------------------------------------------------------------------------------------------------
+
+// Lee la cabecera y los bloques. Retorna 0 si el archivo se leyo completo.
+static int trazadec_leer(FILE *archivo, Decodificador_t *dec) {
+    CabeceraTraza_t cabecera;
+    if (fread(&cabecera, sizeof(cabecera), 1, archivo) != 1 ||
+        memcmp(cabecera.marca, TRAZA_MARCA, sizeof(TRAZA_MARCA)) != 0) {
+        fprintf(stderr, "Error: El archivo no es una traza del simulador\n");
+        return -1;
+    }
+    if (cabecera.version != TRAZA_VERSION || cabecera.tam_registro != sizeof(RegistroTraza_t)) {
+        fprintf(stderr, "Error: Traza version %u con registros de %u bytes (se esperaba version %d, %zu bytes)\n",
+                cabecera.version, cabecera.tam_registro, TRAZA_VERSION, sizeof(RegistroTraza_t));
+        return -1;
+    }
+
+    if (dec->formato == FORMATO_CSV) {
+        printf("ciclo,nucleo,pid,tipo,pc,ir,opcode,ac_antes,ac_despues,interrupcion,estado_anterior,estado_nuevo\n");
+    } else if (dec->formato == FORMATO_TEXTO) {
+        time_t inicio = (time_t)cabecera.inicio;
+        printf("# Traza del %s# Memoria %u palabras (%u del SO), %u nucleos\n", ctime(&inicio),
+               cabecera.tam_memoria, cabecera.mem_so, cabecera.nucleos);
+    }
+
+    RegistroTraza_t *bloque = malloc(TRAZA_REGISTROS_BLOQUE * sizeof(RegistroTraza_t));
+    if (!bloque) return -1;
+
+    int resultado = 0;
+    CabeceraBloque_t cab_bloque;
+    while (fread(&cab_bloque, sizeof(cab_bloque), 1, archivo) == 1) {
+        if (cab_bloque.marca != TRAZA_MARCA_BLOQUE || cab_bloque.cantidad > TRAZA_REGISTROS_BLOQUE) {
+            fprintf(stderr, "Error: Bloque corrupto despues de %ld registros\n", dec->registros);
+            resultado = -1;
+            break;
+        }
+        size_t leidos = fread(bloque, sizeof(RegistroTraza_t), cab_bloque.cantidad, archivo);
+        for (size_t i = 0; i < leidos; i++) {
+            if (dec->formato == FORMATO_TEXTO) trazadec_texto(&bloque[i]);
+            else if (dec->formato == FORMATO_CSV) trazadec_csv(&bloque[i]);
+            else trazadec_acumular(dec, &bloque[i]);
+        }
+        dec->registros += leidos;
+        if (leidos != cab_bloque.cantidad) {
+            // El simulador termino sin cerrar la traza
+            fprintf(stderr, "Aviso: Traza truncada despues de %ld registros\n", dec->registros);
+            resultado = -1;
+            break;
+        }
+    }
+    free(bloque);
+    return resultado;
+}
+
+int main(int argc, char *argv[]) {
+    Decodificador_t *dec = calloc(1, sizeof(Decodificador_t));
+    const char *ruta = NULL;
+    int uso_invalido = 0;
+    dec->formato = FORMATO_TEXTO;
+
+    for (int i = 1; i < argc && !uso_invalido; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            const char *formato = argv[++i];
+            if (strcmp(formato, "texto") == 0) dec->formato = FORMATO_TEXTO;
+            else if (strcmp(formato, "csv") == 0) dec->formato = FORMATO_CSV;
+            else if (strcmp(formato, "pids") == 0) dec->formato = FORMATO_PIDS;
+            else uso_invalido = 1;
+        } else if (ruta == NULL && argv[i][0] != '-') {
+            ruta = argv[i];
+        } else {
+            uso_invalido = 1;
+        }
+    }
+    if (ruta == NULL || uso_invalido) {
+        fprintf(stderr, "Uso: %s [-f texto|csv|pids] <archivo de traza>\n", argv[0]);
+        free(dec);
+        return 2;
+    }
+
+    FILE *archivo = fopen(ruta, "rb");
+    if (!archivo) {
+        fprintf(stderr, "Error: No se pudo abrir %s\n", ruta);
+        free(dec);
+        return 1;
+    }
+    int resultado = trazadec_leer(archivo, dec);
+    fclose(archivo);
+
+    if (dec->formato == FORMATO_PIDS && dec->registros > 0) {
+        trazadec_mostrar_pids(dec);
+    }
+    free(dec);
+    return resultado == 0 ? 0 : 1;
+}